@@ -0,0 +1,94 @@
+# hornetseye-dc1394 - Capture from DC1394 compatible firewire camera
+# Copyright (C) 2010 Jan Wedekind
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# Benchmarks of the capture pipeline
+#
+# Native stages are timed with +DC1394Bench+ at common resolutions. The
+# end-to-end read loops capture from simulated cameras. Each result is printed
+# as one line of JSON with the frames per second, the time per pixel, and the
+# number of Ruby objects allocated per frame. Native results also list the
+# instruction set extensions used by the colour conversions.
+#
+# Run with +rake bench+. Set +BENCH_SECONDS+ to change the duration of each
+# benchmark.
+require 'json'
+require 'hornetseye_dc1394'
+include Hornetseye
+
+SECONDS = ( ENV[ 'BENCH_SECONDS' ] || 0.5 ).to_f
+RESOLUTIONS = [ [ 640, 480 ], [ 1024, 768 ], [ 1280, 960 ], [ 1600, 1200 ] ]
+READS = [ { :name => 'read_mono8', :type => [ UBYTE, 640, 480 ],
+            :frame_rate => DC1394Input::FRAMERATE_60 },
+          { :name => 'read_uyvy', :type => [ UYVY, 640, 480 ],
+            :frame_rate => DC1394Input::FRAMERATE_30 },
+          { :name => 'read_uyvy_rgb', :type => [ UYVY, 640, 480 ],
+            :output => UBYTERGB, :frame_rate => DC1394Input::FRAMERATE_30 },
+          { :name => 'read_uyvy_grey', :type => [ UYVY, 1024, 768 ],
+            :output => UBYTE, :frame_rate => DC1394Input::FRAMERATE_15 } ]
+
+def report( suite, result )
+  puts JSON.generate( { :suite => suite, :threads => DC1394.threads }.
+                        merge( result ) )
+  STDOUT.flush
+end
+
+# Native stages
+DC1394Bench.benchmarks.each do |name|
+  RESOLUTIONS.each do |width, height|
+    # Estimate the number of frames which can be processed in the given time.
+    probe = DC1394Bench.run name, width, height, 1
+    frames = [ ( SECONDS * probe[ :fps ] ).ceil, 1 ].max
+    report 'native', DC1394Bench.run( name, width, height, frames ).
+                       merge( :simd => DC1394Bench.simd )
+  end
+end
+
+# End-to-end read loops
+DC1394Input.simulate :modes => [ [ DC1394Input::MODE_MONO8, 640, 480 ],
+                                 [ DC1394Input::MODE_YUV422, 640, 480 ],
+                                 [ DC1394Input::MODE_YUV422, 1024, 768 ] ],
+                     :frame_rates => [ DC1394Input::FRAMERATE_15,
+                                       DC1394Input::FRAMERATE_30,
+                                       DC1394Input::FRAMERATE_60 ]
+READS.each do |config|
+  input = DC1394Input.new( 0, DC1394Input::SPEED_400, config[ :frame_rate ] ) do
+    config[ :type ]
+  end
+  begin
+    input.output = config[ :output ] if config[ :output ]
+    input.read
+    frames = 0
+    allocated = GC.stat :total_allocated_objects
+    cpu = Process.clock_gettime Process::CLOCK_PROCESS_CPUTIME_ID
+    start = Process.clock_gettime Process::CLOCK_MONOTONIC
+    while Process.clock_gettime( Process::CLOCK_MONOTONIC ) < start + SECONDS
+      input.read
+      frames += 1
+    end
+    seconds = Process.clock_gettime( Process::CLOCK_MONOTONIC ) - start
+    cpu = Process.clock_gettime( Process::CLOCK_PROCESS_CPUTIME_ID ) - cpu
+    width, height = input.width, input.height
+    # Reads block until the next simulated frame, so the time per pixel is
+    # measured as processor time.
+    report 'read', :name => config[ :name ], :width => width, :height => height,
+           :frames => frames, :fps => frames / seconds,
+           :ns_per_pixel => cpu * 1.0e+9 / ( width * height * frames ),
+           :allocations_per_frame =>
+             ( GC.stat( :total_allocated_objects ) - allocated ).to_f / frames
+  ensure
+    input.close
+  end
+end
@@ -17,8 +17,13 @@
 #ifndef NDEBUG
 #include <iostream>
 #endif
+#include <iomanip>
 #include "rubytools.hh"
 #include "dc1394.hh"
+#include "dc1394native.hh"
+#include "dc1394plan.hh"
+#include "dc1394pool.hh"
+#include "dc1394simulator.hh"
 
 using namespace boost;
 using namespace std;
@@ -26,10 +31,13 @@ using namespace std;
 VALUE DC1394::cRubyClass = Qnil;
 
 DC1394::DC1394(void) throw (Error):
-  m_dc1394(NULL)
+  m_backend( new DC1394Native ), m_enumerated(false)
+{
+}
+
+DC1394::DC1394( DC1394BackendPtr backend ):
+  m_backend( backend ), m_enumerated(false)
 {
-  m_dc1394 = dc1394_new();
-  ERRORMACRO( m_dc1394 != NULL, Error, , "Error initialising DC1394 library" );
 }
 
 DC1394::~DC1394(void)
@@ -39,23 +47,171 @@ DC1394::~DC1394(void)
 
 void DC1394::close(void)
 {
-  if ( m_dc1394 != NULL ) {
-    dc1394_free( m_dc1394 );
-    m_dc1394 = NULL;
+  if ( m_backend.get() != NULL ) {
+    freeParked();
+    // Open cameras keep the backend until they are closed.
+    m_backend.reset();
+    m_cameras.clear();
+    m_enumerated = false;
+  };
+}
+
+DC1394BackendPtr DC1394::backend(void) throw (Error)
+{
+  ERRORMACRO( m_backend.get() != NULL, Error, , "DC1394 device is closed. Did you "
+              "call \"close\" before?" );
+  return m_backend;
+}
+
+const vector< DC1394::Camera > &DC1394::cameras(void) throw (Error)
+{
+  if ( !m_enumerated ) refresh();
+  return m_cameras;
+}
+
+const DC1394::Camera &DC1394::camera( unsigned int node ) throw (Error)
+{
+  // Enumerate again if the camera could have been connected in the meantime.
+  if ( node >= cameras().size() ) refresh();
+  ERRORMACRO( !m_cameras.empty(), Error, , "Could not find a single digital camera "
+              "on the firewire bus. Please check, whether the kernel modules "
+              "'ieee1394','raw1394' and 'ohci1394' are loaded and whether you "
+              "have read/write permission on \"/dev/raw1394\". Also make sure "
+              "that the camera is connected and powered up." );
+  ERRORMACRO( node < m_cameras.size(), Error, ,
+              "Camera node number " << node << " out of range. The range is "
+              "[ 0; " << m_cameras.size() << " )" );
+  return m_cameras[ node ];
+}
+
+DC1394::Camera DC1394::info( dc1394camera_t *camera )
+{
+  for ( vector< Camera >::const_iterator i = m_cameras.begin(); i != m_cameras.end();
+        i++ )
+    // The camera might have been busy when it was enumerated.
+    if ( i->guid == camera->guid && i->unit == camera->unit && !i->modes.empty() )
+      return *i;
+  return probe( camera );
+}
+
+void DC1394::refresh(void) throw (Error)
+{
+  dc1394camera_list_t *list = NULL;
+  DC1394BackendPtr backend( this->backend() );
+  dc1394error_t err = backend->cameraEnumerate( &list );
+  ERRORMACRO( err == DC1394_SUCCESS, Error, , "Failed to enumerate cameras: "
+              << dc1394_error_get_string( err ) );
+  vector< Camera > cameras;
+  for ( unsigned int i=0; i<list->num; i++ ) {
+    uint64_t guid = list->ids[i].guid;
+    int unit = list->ids[i].unit;
+    // Parked cameras are still open and do not have to be probed again.
+    dc1394camera_t *camera = NULL;
+    for ( vector< dc1394camera_t * >::iterator j = m_parked.begin();
+          j != m_parked.end(); j++ )
+      if ( (*j)->guid == guid && (*j)->unit == unit ) camera = *j;
+    if ( camera != NULL )
+      cameras.push_back( probe( camera ) );
+    else {
+      camera = backend->cameraNewUnit( guid, unit );
+      if ( camera != NULL ) {
+        cameras.push_back( probe( camera ) );
+        backend->cameraFree( camera );
+      } else {
+        // The camera might be in use by another process.
+        Camera info;
+        info.guid = guid;
+        info.unit = unit;
+        info.vendorId = 0;
+        info.modelId = 0;
+        cameras.push_back( info );
+      };
+    };
   };
+  backend->cameraFreeList( list );
+  m_cameras = cameras;
+  m_enumerated = true;
 }
 
-dc1394_t *DC1394::get(void) throw (Error)
+dc1394camera_t *DC1394::openCamera( uint64_t guid, int unit ) throw (Error)
 {
-  ERRORMACRO( m_dc1394 != NULL, Error, , "DC1394 device is closed. Did you call "
-              "\"close\" before?" );
-  return m_dc1394;
+  dc1394camera_t *retVal = NULL;
+  // A negative unit number selects the first unit with the given GUID.
+  for ( vector< dc1394camera_t * >::iterator i = m_parked.begin();
+        i != m_parked.end(); i++ )
+    if ( (*i)->guid == guid && ( unit < 0 || (*i)->unit == unit ) ) {
+      retVal = *i;
+      m_parked.erase( i );
+      break;
+    };
+  if ( retVal == NULL ) {
+    retVal = backend()->cameraNewUnit( guid, unit );
+    ERRORMACRO( retVal != NULL, Error, , "Failed to initialise camera with guid 0x"
+                << setfill( '0' ) << setw( 16 ) << setbase( 16 ) << guid
+                << setbase( 10 ) << setfill( ' ' ) << " (unit " << unit
+                << "). Please check that the camera is connected and not in use "
+                "by another program" );
+  };
+  return retVal;
+}
+
+void DC1394::park( dc1394camera_t *camera )
+{
+  // Callers free the camera themselves if the handle is closed already.
+  if ( m_backend.get() != NULL ) m_parked.push_back( camera );
+}
+
+void DC1394::started( dc1394camera_t *camera, uint32_t bandwidth )
+{
+  m_running[ camera ] = bandwidth;
+}
+
+void DC1394::stopped( dc1394camera_t *camera )
+{
+  m_running.erase( camera );
+}
+
+DC1394::Camera DC1394::probe( dc1394camera_t *camera )
+{
+  Camera retVal;
+  retVal.guid = camera->guid;
+  retVal.unit = camera->unit;
+  retVal.vendor = camera->vendor != NULL ? camera->vendor : "";
+  retVal.model = camera->model != NULL ? camera->model : "";
+  retVal.vendorId = camera->vendor_id;
+  retVal.modelId = camera->model_id;
+  dc1394video_modes_t videoModes;
+  if ( m_backend->videoGetSupportedModes( camera, &videoModes ) == DC1394_SUCCESS )
+    for ( unsigned int i=0; i<videoModes.num; i++ ) {
+      Mode mode;
+      mode.mode = videoModes.modes[i];
+      m_backend->getColorCodingFromVideoMode( camera, mode.mode, &mode.coding );
+      m_backend->getImageSizeFromVideoMode( camera, mode.mode, &mode.width,
+                                            &mode.height );
+      dc1394framerates_t frameRates;
+      if ( !dc1394_is_video_mode_scalable( mode.mode ) &&
+           m_backend->videoGetSupportedFramerates( camera, mode.mode, &frameRates ) ==
+           DC1394_SUCCESS )
+        mode.frameRates.assign( frameRates.framerates,
+                                frameRates.framerates + frameRates.num );
+      retVal.modes.push_back( mode );
+    };
+  return retVal;
+}
+
+void DC1394::freeParked(void)
+{
+  for ( vector< dc1394camera_t * >::iterator i = m_parked.begin();
+        i != m_parked.end(); i++ )
+    m_backend->cameraFree( *i );
+  m_parked.clear();
 }
 
 string DC1394::inspect(void) const
 {
   ostringstream s;
-  s << "DC1394()";
+  s << ( m_backend.get() != NULL && m_backend->simulated() ? "DC1394( simulated )" :
+         "DC1394()" );
   return s.str();
 }
 
@@ -64,7 +220,21 @@ VALUE DC1394::registerRubyClass( VALUE module )
   cRubyClass = rb_define_class_under( module, "DC1394", rb_cObject );
   rb_define_singleton_method( cRubyClass, "new",
                               RUBY_METHOD_FUNC( wrapNew ), 0 );
+  rb_define_singleton_method( cRubyClass, "simulate",
+                              RUBY_METHOD_FUNC( wrapSimulate ), 1 );
+  rb_define_singleton_method( cRubyClass, "threads",
+                              RUBY_METHOD_FUNC( wrapThreads ), 0 );
+  rb_define_singleton_method( cRubyClass, "threads=",
+                              RUBY_METHOD_FUNC( wrapSetThreads ), 1 );
+  rb_define_singleton_method( cRubyClass, "affinity",
+                              RUBY_METHOD_FUNC( wrapAffinity ), 0 );
+  rb_define_singleton_method( cRubyClass, "affinity=",
+                              RUBY_METHOD_FUNC( wrapSetAffinity ), 1 );
   rb_define_method( cRubyClass, "close", RUBY_METHOD_FUNC( wrapClose ), 0 );
+  rb_define_method( cRubyClass, "simulated?", RUBY_METHOD_FUNC( wrapSimulated ), 0 );
+  rb_define_method( cRubyClass, "cameras", RUBY_METHOD_FUNC( wrapCameras ), 0 );
+  rb_define_method( cRubyClass, "refresh", RUBY_METHOD_FUNC( wrapRefresh ), 0 );
+  rb_define_method( cRubyClass, "plan", RUBY_METHOD_FUNC( wrapPlan ), 3 );
   return cRubyClass;
 }
 
@@ -86,6 +256,21 @@ VALUE DC1394::wrapNew( VALUE rbClass )
   return retVal;
 }
 
+VALUE DC1394::wrapSimulate( VALUE rbClass, VALUE rbOptions )
+{
+  VALUE retVal = Qnil;
+  try {
+    DC1394BackendPtr backend
+      ( new DC1394Simulator( DC1394Simulator::config( rbOptions ) ) );
+    DC1394Ptr ptr( new DC1394( backend ) );
+    retVal = Data_Wrap_Struct( rbClass, 0, deleteRubyObject,
+                               new DC1394Ptr( ptr ) );
+  } catch ( std::exception &e ) {
+    rb_raise( rb_eRuntimeError, "%s", e.what() );
+  };
+  return retVal;
+}
+
 VALUE DC1394::wrapClose( VALUE rbSelf )
 {
   DC1394Ptr *self; Data_Get_Struct( rbSelf, DC1394Ptr, self );
@@ -93,3 +278,149 @@ VALUE DC1394::wrapClose( VALUE rbSelf )
   return rbSelf;
 }
 
+VALUE DC1394::wrapSimulated( VALUE rbSelf )
+{
+  DC1394Ptr *self; Data_Get_Struct( rbSelf, DC1394Ptr, self );
+  return (*self)->status() && (*self)->backend()->simulated() ? Qtrue : Qfalse;
+}
+
+VALUE DC1394::wrapCameras( VALUE rbSelf )
+{
+  VALUE rbRetVal = Qnil;
+  try {
+    DC1394Ptr *self; Data_Get_Struct( rbSelf, DC1394Ptr, self );
+    const vector< Camera > &cameras = (*self)->cameras();
+    rbRetVal = rb_ary_new();
+    for ( vector< Camera >::const_iterator i = cameras.begin(); i != cameras.end();
+          i++ ) {
+      VALUE rbModes = rb_ary_new();
+      for ( vector< Mode >::const_iterator j = i->modes.begin(); j != i->modes.end();
+            j++ ) {
+        VALUE rbFrameRates = rb_ary_new();
+        for ( vector< dc1394framerate_t >::const_iterator k = j->frameRates.begin();
+              k != j->frameRates.end(); k++ )
+          rb_ary_push( rbFrameRates, INT2NUM( *k ) );
+        VALUE rbMode = rb_hash_new();
+        rb_hash_aset( rbMode, ID2SYM( rb_intern( "mode" ) ), INT2NUM( j->mode ) );
+        rb_hash_aset( rbMode, ID2SYM( rb_intern( "coding" ) ), INT2NUM( j->coding ) );
+        rb_hash_aset( rbMode, ID2SYM( rb_intern( "width" ) ), UINT2NUM( j->width ) );
+        rb_hash_aset( rbMode, ID2SYM( rb_intern( "height" ) ), UINT2NUM( j->height ) );
+        rb_hash_aset( rbMode, ID2SYM( rb_intern( "frame_rates" ) ), rbFrameRates );
+        rb_ary_push( rbModes, rbMode );
+      };
+      VALUE rbCamera = rb_hash_new();
+      rb_hash_aset( rbCamera, ID2SYM( rb_intern( "guid" ) ), ULL2NUM( i->guid ) );
+      rb_hash_aset( rbCamera, ID2SYM( rb_intern( "unit" ) ), INT2NUM( i->unit ) );
+      rb_hash_aset( rbCamera, ID2SYM( rb_intern( "vendor" ) ),
+                    rb_str_new2( i->vendor.c_str() ) );
+      rb_hash_aset( rbCamera, ID2SYM( rb_intern( "model" ) ),
+                    rb_str_new2( i->model.c_str() ) );
+      rb_hash_aset( rbCamera, ID2SYM( rb_intern( "vendor_id" ) ),
+                    UINT2NUM( i->vendorId ) );
+      rb_hash_aset( rbCamera, ID2SYM( rb_intern( "model_id" ) ),
+                    UINT2NUM( i->modelId ) );
+      rb_hash_aset( rbCamera, ID2SYM( rb_intern( "modes" ) ), rbModes );
+      rb_ary_push( rbRetVal, rbCamera );
+    };
+  } catch ( std::exception &e ) {
+    rb_raise( rb_eRuntimeError, "%s", e.what() );
+  };
+  return rbRetVal;
+}
+
+VALUE DC1394::wrapRefresh( VALUE rbSelf )
+{
+  try {
+    DC1394Ptr *self; Data_Get_Struct( rbSelf, DC1394Ptr, self );
+    (*self)->refresh();
+  } catch ( std::exception &e ) {
+    rb_raise( rb_eRuntimeError, "%s", e.what() );
+  };
+  return rbSelf;
+}
+
+VALUE DC1394::wrapPlan( VALUE rbSelf, VALUE rbRequests, VALUE rbSpeed,
+                        VALUE rbBudget )
+{
+  VALUE rbRetVal = Qnil;
+  try {
+    DC1394Ptr *self; Data_Get_Struct( rbSelf, DC1394Ptr, self );
+    ERRORMACRO( TYPE( rbRequests ) == T_ARRAY, Error, , "Requests must be an array" );
+    vector< DC1394Plan::Request > requests;
+    for ( int i=0; i<RARRAY_LEN( rbRequests ); i++ ) {
+      VALUE rbRequest = rb_ary_entry( rbRequests, i );
+      ERRORMACRO( TYPE( rbRequest ) == T_HASH, Error, , "Each request must be a "
+                  "hash" );
+      VALUE rbGUID = rb_hash_aref( rbRequest, ID2SYM( rb_intern( "guid" ) ) ),
+        rbUnit = rb_hash_aref( rbRequest, ID2SYM( rb_intern( "unit" ) ) ),
+        rbNode = rb_hash_aref( rbRequest, ID2SYM( rb_intern( "node" ) ) );
+      DC1394Plan::Request request;
+      if ( !NIL_P( rbGUID ) ) {
+        request.guid = NUM2ULL( rbGUID );
+        request.unit = NIL_P( rbUnit ) ? -1 : NUM2INT( rbUnit );
+      } else {
+        const Camera &camera =
+          (*self)->camera( NIL_P( rbNode ) ? 0 : NUM2UINT( rbNode ) );
+        request.guid = camera.guid;
+        request.unit = camera.unit;
+      };
+      DC1394Select select;
+      select.setPolicy( rbRequest );
+      request.policy = select.policy();
+      requests.push_back( request );
+    };
+    vector< DC1394Plan::Entry > plan =
+      DC1394Plan::make( *self, requests, (dc1394speed_t)NUM2INT( rbSpeed ),
+                        NIL_P( rbBudget ) ? DC1394Plan::BUS_BANDWIDTH :
+                        NUM2UINT( rbBudget ) );
+    rbRetVal = rb_ary_new();
+    for ( vector< DC1394Plan::Entry >::const_iterator i = plan.begin();
+          i != plan.end(); i++ ) {
+      VALUE rbEntry = rb_hash_new();
+      rb_hash_aset( rbEntry, ID2SYM( rb_intern( "guid" ) ), ULL2NUM( i->guid ) );
+      rb_hash_aset( rbEntry, ID2SYM( rb_intern( "unit" ) ), INT2NUM( i->unit ) );
+      rb_hash_aset( rbEntry, ID2SYM( rb_intern( "mode" ) ), INT2NUM( i->mode ) );
+      rb_hash_aset( rbEntry, ID2SYM( rb_intern( "coding" ) ), INT2NUM( i->coding ) );
+      rb_hash_aset( rbEntry, ID2SYM( rb_intern( "width" ) ), UINT2NUM( i->width ) );
+      rb_hash_aset( rbEntry, ID2SYM( rb_intern( "height" ) ), UINT2NUM( i->height ) );
+      rb_hash_aset( rbEntry, ID2SYM( rb_intern( "frame_rate" ) ),
+                    i->frameRate >= 0 ? INT2NUM( i->frameRate ) : Qnil );
+      rb_hash_aset( rbEntry, ID2SYM( rb_intern( "fps" ) ), rb_float_new( i->fps ) );
+      rb_hash_aset( rbEntry, ID2SYM( rb_intern( "packet_size" ) ),
+                    UINT2NUM( i->packetSize ) );
+      rb_hash_aset( rbEntry, ID2SYM( rb_intern( "bandwidth" ) ),
+                    UINT2NUM( i->bandwidth ) );
+      rb_ary_push( rbRetVal, rbEntry );
+    };
+  } catch ( std::exception &e ) {
+    rb_raise( rb_eRuntimeError, "%s", e.what() );
+  };
+  return rbRetVal;
+}
+
+VALUE DC1394::wrapThreads( VALUE rbClass )
+{
+  return INT2NUM( DC1394Pool::threads() );
+}
+
+VALUE DC1394::wrapSetThreads( VALUE rbClass, VALUE rbThreads )
+{
+  int threads = NUM2INT( rbThreads );
+  if ( threads < 0 )
+    rb_raise( rb_eArgError, "Number of threads must not be negative (but was %d)",
+              threads );
+  DC1394Pool::setThreads( threads );
+  return rbThreads;
+}
+
+VALUE DC1394::wrapAffinity( VALUE rbClass )
+{
+  return DC1394Pool::affinity() ? Qtrue : Qfalse;
+}
+
+VALUE DC1394::wrapSetAffinity( VALUE rbClass, VALUE rbAffinity )
+{
+  DC1394Pool::setAffinity( RTEST( rbAffinity ) );
+  return rbAffinity;
+}
+
@@ -16,25 +16,78 @@
 #ifndef HORNETSEYE_DC1394_HH
 #define HORNETSEYE_DC1394_HH
 
+#include <map>
+#include <string>
+#include <vector>
 #include <boost/smart_ptr.hpp>
 #include <dc1394/dc1394.h>
 #include "error.hh"
+#include "dc1394backend.hh"
 
 class DC1394
 {
 public:
+  struct Mode
+  {
+    dc1394video_mode_t mode;
+    dc1394color_coding_t coding;
+    unsigned int width;
+    unsigned int height;
+    std::vector< dc1394framerate_t > frameRates;
+  };
+  struct Camera
+  {
+    uint64_t guid;
+    int unit;
+    std::string vendor;
+    std::string model;
+    uint32_t vendorId;
+    uint32_t modelId;
+    std::vector< Mode > modes;
+  };
   DC1394(void) throw (Error);
+  DC1394( DC1394BackendPtr backend );
   virtual ~DC1394(void);
   std::string inspect(void) const;
   void close(void);
-  dc1394_t *get(void) throw (Error);
+  bool status(void) const { return m_backend.get() != NULL; }
+  DC1394BackendPtr backend(void) throw (Error);
+  const std::vector< Camera > &cameras(void) throw (Error);
+  const Camera &camera( unsigned int node ) throw (Error);
+  Camera info( dc1394camera_t *camera );
+  void refresh(void) throw (Error);
+  dc1394camera_t *openCamera( uint64_t guid, int unit ) throw (Error);
+  void park( dc1394camera_t *camera );
+  void started( dc1394camera_t *camera, uint32_t bandwidth );
+  void stopped( dc1394camera_t *camera );
+  typedef std::map< dc1394camera_t *, uint32_t > BandwidthMap;
+  const BandwidthMap &running(void) const { return m_running; }
+  Camera probe( dc1394camera_t *camera );
   static VALUE cRubyClass;
   static VALUE registerRubyClass( VALUE module );
   static void deleteRubyObject( void *ptr );
   static VALUE wrapNew( VALUE rbClass );
+  static VALUE wrapSimulate( VALUE rbClass, VALUE rbOptions );
   static VALUE wrapClose( VALUE rbSelf );
+  static VALUE wrapSimulated( VALUE rbSelf );
+  static VALUE wrapCameras( VALUE rbSelf );
+  static VALUE wrapRefresh( VALUE rbSelf );
+  static VALUE wrapPlan( VALUE rbSelf, VALUE rbRequests, VALUE rbSpeed,
+                         VALUE rbBudget );
+  static VALUE wrapThreads( VALUE rbClass );
+  static VALUE wrapSetThreads( VALUE rbClass, VALUE rbThreads );
+  static VALUE wrapAffinity( VALUE rbClass );
+  static VALUE wrapSetAffinity( VALUE rbClass, VALUE rbAffinity );
 protected:
-  dc1394_t *m_dc1394;
+  void freeParked(void);
+  DC1394BackendPtr m_backend;
+  bool m_enumerated;
+  std::vector< Camera > m_cameras;
+  // Cameras closed with "close( true )" stay powered and are reused when
+  // opened again.
+  std::vector< dc1394camera_t * > m_parked;
+  // Isochronous bandwidth units used by cameras capturing with this handle.
+  BandwidthMap m_running;
 };
   
 typedef boost::shared_ptr< DC1394 > DC1394Ptr;
@@ -0,0 +1,171 @@
+/* HornetsEye - Computer Vision with Ruby
+   Copyright (C) 2006, 2007, 2008, 2009, 2010 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef HORNETSEYE_DC1394BACKEND_HH
+#define HORNETSEYE_DC1394BACKEND_HH
+
+#include <boost/smart_ptr.hpp>
+#include <dc1394/dc1394.h>
+
+// Interface to the cameras of one DC1394 handle. The methods correspond to the
+// libdc1394 functions with the same name. "DC1394Native" forwards to
+// libdc1394 and "DC1394Simulator" emulates cameras without firewire hardware.
+class DC1394Backend
+{
+public:
+  virtual ~DC1394Backend(void) {}
+  virtual bool simulated(void) const = 0;
+  virtual dc1394error_t cameraEnumerate( dc1394camera_list_t **list ) = 0;
+  virtual void cameraFreeList( dc1394camera_list_t *list ) = 0;
+  virtual dc1394camera_t *cameraNewUnit( uint64_t guid, int unit ) = 0;
+  virtual void cameraFree( dc1394camera_t *camera ) = 0;
+  virtual dc1394error_t cameraSetPower( dc1394camera_t *camera,
+                                        dc1394switch_t power ) = 0;
+  virtual dc1394error_t videoGetSupportedModes( dc1394camera_t *camera,
+                                                dc1394video_modes_t *modes ) = 0;
+  virtual dc1394error_t videoGetSupportedFramerates( dc1394camera_t *camera,
+                                                     dc1394video_mode_t mode,
+                                                     dc1394framerates_t *rates ) = 0;
+  virtual dc1394error_t videoSetMode( dc1394camera_t *camera,
+                                      dc1394video_mode_t mode ) = 0;
+  virtual dc1394error_t videoGetMode( dc1394camera_t *camera,
+                                      dc1394video_mode_t *mode ) = 0;
+  virtual dc1394error_t videoSetFramerate( dc1394camera_t *camera,
+                                           dc1394framerate_t rate ) = 0;
+  virtual dc1394error_t videoGetFramerate( dc1394camera_t *camera,
+                                           dc1394framerate_t *rate ) = 0;
+  virtual dc1394error_t videoSetIsoSpeed( dc1394camera_t *camera,
+                                          dc1394speed_t speed ) = 0;
+  virtual dc1394error_t videoGetIsoSpeed( dc1394camera_t *camera,
+                                          dc1394speed_t *speed ) = 0;
+  virtual dc1394error_t videoSetOperationMode( dc1394camera_t *camera,
+                                               dc1394operation_mode_t mode ) = 0;
+  virtual dc1394error_t videoGetOperationMode( dc1394camera_t *camera,
+                                               dc1394operation_mode_t *mode ) = 0;
+  virtual dc1394error_t videoSetTransmission( dc1394camera_t *camera,
+                                              dc1394switch_t power ) = 0;
+  virtual dc1394error_t videoGetBandwidthUsage( dc1394camera_t *camera,
+                                                uint32_t *units ) = 0;
+  virtual dc1394error_t getColorCodingFromVideoMode( dc1394camera_t *camera,
+                                                     dc1394video_mode_t mode,
+                                                     dc1394color_coding_t *coding ) = 0;
+  virtual dc1394error_t getImageSizeFromVideoMode( dc1394camera_t *camera,
+                                                   dc1394video_mode_t mode,
+                                                   uint32_t *width,
+                                                   uint32_t *height ) = 0;
+  virtual dc1394error_t format7GetMaxImageSize( dc1394camera_t *camera,
+                                                dc1394video_mode_t mode,
+                                                uint32_t *width,
+                                                uint32_t *height ) = 0;
+  virtual dc1394error_t format7GetUnitSize( dc1394camera_t *camera,
+                                            dc1394video_mode_t mode,
+                                            uint32_t *width, uint32_t *height ) = 0;
+  virtual dc1394error_t format7GetUnitPosition( dc1394camera_t *camera,
+                                                dc1394video_mode_t mode,
+                                                uint32_t *left, uint32_t *top ) = 0;
+  virtual dc1394error_t format7GetPacketParameters( dc1394camera_t *camera,
+                                                    dc1394video_mode_t mode,
+                                                    uint32_t *unitBytes,
+                                                    uint32_t *maxBytes ) = 0;
+  virtual dc1394error_t format7GetPacketSize( dc1394camera_t *camera,
+                                              dc1394video_mode_t mode,
+                                              uint32_t *packetSize ) = 0;
+  virtual dc1394error_t format7SetPacketSize( dc1394camera_t *camera,
+                                              dc1394video_mode_t mode,
+                                              uint32_t packetSize ) = 0;
+  virtual dc1394error_t format7GetTotalBytes( dc1394camera_t *camera,
+                                              dc1394video_mode_t mode,
+                                              uint64_t *totalBytes ) = 0;
+  virtual dc1394error_t format7GetColorCodings( dc1394camera_t *camera,
+                                                dc1394video_mode_t mode,
+                                                dc1394color_codings_t *codings ) = 0;
+  virtual dc1394error_t format7GetColorFilter( dc1394camera_t *camera,
+                                               dc1394video_mode_t mode,
+                                               dc1394color_filter_t *filter ) = 0;
+  virtual dc1394error_t format7GetFrameInterval( dc1394camera_t *camera,
+                                                 dc1394video_mode_t mode,
+                                                 float *interval ) = 0;
+  virtual dc1394error_t format7GetRoi( dc1394camera_t *camera,
+                                       dc1394video_mode_t mode,
+                                       dc1394color_coding_t *coding,
+                                       uint32_t *packetSize, uint32_t *left,
+                                       uint32_t *top, uint32_t *width,
+                                       uint32_t *height ) = 0;
+  virtual dc1394error_t format7SetRoi( dc1394camera_t *camera,
+                                       dc1394video_mode_t mode,
+                                       dc1394color_coding_t coding,
+                                       int32_t packetSize, int32_t left, int32_t top,
+                                       int32_t width, int32_t height ) = 0;
+  virtual dc1394error_t captureSetup( dc1394camera_t *camera, uint32_t numBuffers,
+                                      uint32_t flags ) = 0;
+  virtual dc1394error_t captureStop( dc1394camera_t *camera ) = 0;
+  virtual int captureGetFileno( dc1394camera_t *camera ) = 0;
+  virtual dc1394error_t captureDequeue( dc1394camera_t *camera,
+                                        dc1394capture_policy_t policy,
+                                        dc1394video_frame_t **frame ) = 0;
+  virtual dc1394error_t captureEnqueue( dc1394camera_t *camera,
+                                        dc1394video_frame_t *frame ) = 0;
+  virtual dc1394bool_t captureIsFrameCorrupt( dc1394camera_t *camera,
+                                              dc1394video_frame_t *frame ) = 0;
+  virtual dc1394error_t featureGet( dc1394camera_t *camera,
+                                    dc1394feature_info_t *feature ) = 0;
+  virtual dc1394error_t featureGetAll( dc1394camera_t *camera,
+                                       dc1394featureset_t *features ) = 0;
+  virtual dc1394error_t featureGetValue( dc1394camera_t *camera,
+                                         dc1394feature_t feature,
+                                         uint32_t *value ) = 0;
+  virtual dc1394error_t featureSetValue( dc1394camera_t *camera,
+                                         dc1394feature_t feature,
+                                         uint32_t value ) = 0;
+  virtual dc1394error_t featureIsPresent( dc1394camera_t *camera,
+                                          dc1394feature_t feature,
+                                          dc1394bool_t *value ) = 0;
+  virtual dc1394error_t featureIsReadable( dc1394camera_t *camera,
+                                           dc1394feature_t feature,
+                                           dc1394bool_t *value ) = 0;
+  virtual dc1394error_t featureIsSwitchable( dc1394camera_t *camera,
+                                             dc1394feature_t feature,
+                                             dc1394bool_t *value ) = 0;
+  virtual dc1394error_t featureGetPower( dc1394camera_t *camera,
+                                         dc1394feature_t feature,
+                                         dc1394switch_t *value ) = 0;
+  virtual dc1394error_t featureSetPower( dc1394camera_t *camera,
+                                         dc1394feature_t feature,
+                                         dc1394switch_t value ) = 0;
+  virtual dc1394error_t featureGetModes( dc1394camera_t *camera,
+                                         dc1394feature_t feature,
+                                         dc1394feature_modes_t *modes ) = 0;
+  virtual dc1394error_t featureGetMode( dc1394camera_t *camera,
+                                        dc1394feature_t feature,
+                                        dc1394feature_mode_t *mode ) = 0;
+  virtual dc1394error_t featureSetMode( dc1394camera_t *camera,
+                                        dc1394feature_t feature,
+                                        dc1394feature_mode_t mode ) = 0;
+  virtual dc1394error_t externalTriggerSetMode( dc1394camera_t *camera,
+                                                dc1394trigger_mode_t mode ) = 0;
+  virtual dc1394error_t externalTriggerSetSource( dc1394camera_t *camera,
+                                                  dc1394trigger_source_t source ) = 0;
+  virtual dc1394error_t externalTriggerSetPolarity( dc1394camera_t *camera,
+                                                    dc1394trigger_polarity_t
+                                                    polarity ) = 0;
+  virtual dc1394error_t externalTriggerSetPower( dc1394camera_t *camera,
+                                                 dc1394switch_t power ) = 0;
+  virtual dc1394error_t softwareTriggerSetPower( dc1394camera_t *camera,
+                                                 dc1394switch_t power ) = 0;
+};
+
+typedef boost::shared_ptr< DC1394Backend > DC1394BackendPtr;
+
+#endif
@@ -0,0 +1,341 @@
+/* HornetsEye - Computer Vision with Ruby
+   Copyright (C) 2006, 2007, 2008, 2009, 2010 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include <vector>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "dc1394bayer.hh"
+
+using namespace std;
+
+// Position of red, green (upper row), green (lower row), and blue pixel in a
+// 2x2 block for each of the Bayer patterns RGGB, GBRG, GRBG, and BGGR.
+// Positions are numbered 0 = top left, 1 = top right, 2 = bottom left,
+// 3 = bottom right.
+static const int layouts[4][4] = {
+  { 0, 1, 2, 3 },
+  { 2, 0, 3, 1 },
+  { 1, 0, 3, 2 },
+  { 3, 1, 2, 0 }
+};
+
+#if defined(__AVX2__)
+
+// Pixels are widened to 16 or 32 bits so that sums of four neighbours do not
+// overflow.
+struct ByteSIMD
+{
+  typedef __m256i V;
+  enum { N = 16 };
+  static V load( const uint8_t *p )
+  { return _mm256_cvtepu8_epi16( _mm_loadu_si128( (const __m128i *)p ) ); }
+  static void store( uint8_t *p, V v )
+  {
+    _mm_storeu_si128( (__m128i *)p,
+                      _mm_packus_epi16( _mm256_castsi256_si128( v ),
+                                        _mm256_extracti128_si256( v, 1 ) ) );
+  }
+  static V add( V a, V b ) { return _mm256_add_epi16( a, b ); }
+  static V sub( V a, V b ) { return _mm256_sub_epi16( a, b ); }
+  static V half( V a ) { return _mm256_srli_epi16( a, 1 ); }
+  static V quarter( V a ) { return _mm256_srli_epi16( a, 2 ); }
+  static V abs( V a ) { return _mm256_abs_epi16( a ); }
+  static V less( V a, V b ) { return _mm256_cmpgt_epi16( b, a ); }
+  static V select( V m, V a, V b ) { return _mm256_blendv_epi8( b, a, m ); }
+  static V lanes( int parity )
+  { return _mm256_set1_epi32( parity ? (int)0xFFFF0000 : 0x0000FFFF ); }
+};
+
+struct ShortSIMD
+{
+  typedef __m256i V;
+  enum { N = 8 };
+  static V load( const uint16_t *p )
+  { return _mm256_cvtepu16_epi32( _mm_loadu_si128( (const __m128i *)p ) ); }
+  static void store( uint16_t *p, V v )
+  {
+    _mm_storeu_si128( (__m128i *)p,
+                      _mm_packus_epi32( _mm256_castsi256_si128( v ),
+                                        _mm256_extracti128_si256( v, 1 ) ) );
+  }
+  static V add( V a, V b ) { return _mm256_add_epi32( a, b ); }
+  static V sub( V a, V b ) { return _mm256_sub_epi32( a, b ); }
+  static V half( V a ) { return _mm256_srli_epi32( a, 1 ); }
+  static V quarter( V a ) { return _mm256_srli_epi32( a, 2 ); }
+  static V abs( V a ) { return _mm256_abs_epi32( a ); }
+  static V less( V a, V b ) { return _mm256_cmpgt_epi32( b, a ); }
+  static V select( V m, V a, V b ) { return _mm256_blendv_epi8( b, a, m ); }
+  static V lanes( int parity )
+  {
+    return _mm256_set1_epi64x( parity ? (long long)0xFFFFFFFF00000000ULL :
+                               (long long)0x00000000FFFFFFFFULL );
+  }
+};
+
+#define HAVE_SIMD
+
+#elif defined(__SSE2__)
+
+struct ByteSIMD
+{
+  typedef __m128i V;
+  enum { N = 8 };
+  static V load( const uint8_t *p )
+  {
+    return _mm_unpacklo_epi8( _mm_loadl_epi64( (const __m128i *)p ),
+                              _mm_setzero_si128() );
+  }
+  static void store( uint8_t *p, V v )
+  { _mm_storel_epi64( (__m128i *)p, _mm_packus_epi16( v, v ) ); }
+  static V add( V a, V b ) { return _mm_add_epi16( a, b ); }
+  static V sub( V a, V b ) { return _mm_sub_epi16( a, b ); }
+  static V half( V a ) { return _mm_srli_epi16( a, 1 ); }
+  static V quarter( V a ) { return _mm_srli_epi16( a, 2 ); }
+  static V abs( V a ) { return _mm_max_epi16( a, _mm_sub_epi16( _mm_setzero_si128(), a ) ); }
+  static V less( V a, V b ) { return _mm_cmplt_epi16( a, b ); }
+  static V select( V m, V a, V b )
+  { return _mm_or_si128( _mm_and_si128( m, a ), _mm_andnot_si128( m, b ) ); }
+  static V lanes( int parity )
+  { return _mm_set1_epi32( parity ? (int)0xFFFF0000 : 0x0000FFFF ); }
+};
+
+struct ShortSIMD
+{
+  typedef __m128i V;
+  enum { N = 4 };
+  static V load( const uint16_t *p )
+  {
+    return _mm_unpacklo_epi16( _mm_loadl_epi64( (const __m128i *)p ),
+                               _mm_setzero_si128() );
+  }
+  static void store( uint16_t *p, V v )
+  {
+    // SSE2 only has a signed saturating pack. Shifting the range avoids it.
+    V s = _mm_packs_epi32( _mm_sub_epi32( v, _mm_set1_epi32( 0x8000 ) ),
+                           _mm_setzero_si128() );
+    _mm_storel_epi64( (__m128i *)p, _mm_xor_si128( s, _mm_set1_epi16( (short)0x8000 ) ) );
+  }
+  static V add( V a, V b ) { return _mm_add_epi32( a, b ); }
+  static V sub( V a, V b ) { return _mm_sub_epi32( a, b ); }
+  static V half( V a ) { return _mm_srli_epi32( a, 1 ); }
+  static V quarter( V a ) { return _mm_srli_epi32( a, 2 ); }
+  static V abs( V a )
+  {
+    V s = _mm_srai_epi32( a, 31 );
+    return _mm_sub_epi32( _mm_xor_si128( a, s ), s );
+  }
+  static V less( V a, V b ) { return _mm_cmplt_epi32( a, b ); }
+  static V select( V m, V a, V b )
+  { return _mm_or_si128( _mm_and_si128( m, a ), _mm_andnot_si128( m, b ) ); }
+  static V lanes( int parity )
+  { return parity ? _mm_set_epi32( -1, 0, -1, 0 ) : _mm_set_epi32( 0, -1, 0, -1 ); }
+};
+
+#define HAVE_SIMD
+
+#endif
+
+#ifdef HAVE_SIMD
+
+// Interpolate the colour planes of one row starting with column 1. Returns the
+// first column which was not processed.
+template< typename S, typename T >
+static int rowSIMD( const T *above, const T *row, const T *below, T *r, T *g, T *b,
+                    int width, int greenParity, bool redRow, bool edge )
+{
+  typedef typename S::V V;
+  // Column x + i is green if ( x + i ) % 2 == greenParity where x is odd.
+  V green = S::lanes( greenParity ^ 1 );
+  int x = 1;
+  for ( ; x + S::N < width; x += S::N ) {
+    V left = S::load( row + x - 1 ), centre = S::load( row + x ),
+      right = S::load( row + x + 1 ), up = S::load( above + x ),
+      down = S::load( below + x );
+    V horizontal = S::add( left, right ), vertical = S::add( up, down );
+    V diagonal = S::quarter( S::add( S::add( S::load( above + x - 1 ),
+                                             S::load( above + x + 1 ) ),
+                                     S::add( S::load( below + x - 1 ),
+                                             S::load( below + x + 1 ) ) ) );
+    V cross = S::quarter( S::add( horizontal, vertical ) );
+    horizontal = S::half( horizontal );
+    vertical = S::half( vertical );
+    if ( edge ) {
+      // Interpolate along the direction with the smaller gradient.
+      V dh = S::abs( S::sub( left, right ) ), dv = S::abs( S::sub( up, down ) );
+      cross = S::select( S::less( dh, dv ), horizontal,
+                         S::select( S::less( dv, dh ), vertical, cross ) );
+    };
+    V same = S::select( green, horizontal, centre ),
+      other = S::select( green, vertical, diagonal );
+    S::store( g + x, S::select( green, centre, cross ) );
+    S::store( r + x, redRow ? same : other );
+    S::store( b + x, redRow ? other : same );
+  };
+  return x;
+}
+
+static int simdRow( const uint8_t *above, const uint8_t *row, const uint8_t *below,
+                    uint8_t *r, uint8_t *g, uint8_t *b, int width, int greenParity,
+                    bool redRow, bool edge )
+{
+  return rowSIMD< ByteSIMD >( above, row, below, r, g, b, width, greenParity,
+                              redRow, edge );
+}
+
+static int simdRow( const uint16_t *above, const uint16_t *row, const uint16_t *below,
+                    uint16_t *r, uint16_t *g, uint16_t *b, int width, int greenParity,
+                    bool redRow, bool edge )
+{
+  return rowSIMD< ShortSIMD >( above, row, below, r, g, b, width, greenParity,
+                               redRow, edge );
+}
+
+#else
+
+template< typename T >
+static int simdRow( const T *, const T *, const T *, T *, T *, T *, int, int, bool, bool )
+{
+  return 1;
+}
+
+#endif
+
+// Interpolate the colour planes of one pixel. Neighbours outside of the image
+// are mirrored which preserves the Bayer pattern.
+template< typename T >
+static inline void pixel( const T *above, const T *row, const T *below, int x,
+                          int width, int greenParity, bool redRow, bool edge,
+                          T *r, T *g, T *b )
+{
+  int xl = x > 0 ? x - 1 : x + 1, xr = x < width - 1 ? x + 1 : x - 1;
+  uint32_t left = row[ xl ], centre = row[ x ], right = row[ xr ],
+    up = above[ x ], down = below[ x ];
+  uint32_t same, other;
+  if ( ( x & 1 ) == greenParity ) {
+    g[ x ] = centre;
+    same = ( left + right ) >> 1;
+    other = ( up + down ) >> 1;
+  } else {
+    uint32_t green = ( left + right + up + down ) >> 2;
+    if ( edge ) {
+      uint32_t dh = left > right ? left - right : right - left,
+        dv = up > down ? up - down : down - up;
+      if ( dh < dv )
+        green = ( left + right ) >> 1;
+      else if ( dv < dh )
+        green = ( up + down ) >> 1;
+    };
+    g[ x ] = green;
+    same = centre;
+    other = ( above[ xl ] + above[ xr ] + below[ xl ] + below[ xr ] ) >> 2;
+  };
+  r[ x ] = redRow ? same : other;
+  b[ x ] = redRow ? other : same;
+}
+
+template< typename T >
+static void nearest( const T *src, T *dst, int width, int begin, int end,
+                     const int *layout )
+{
+  for ( int y=begin; y<end; y+=2 ) {
+    const T *p = src + y * width;
+    T *q = dst + 3 * ( y - begin ) * width;
+    for ( int x=0; x<width; x+=2 ) {
+      T block[4] = { p[ x ], p[ x + 1 ], p[ x + width ], p[ x + width + 1 ] };
+      T red = block[ layout[0] ], upper = block[ layout[1] ],
+        lower = block[ layout[2] ], blue = block[ layout[3] ];
+      T *t = q + 3 * x, *u = t + 3 * width;
+      t[0] = red; t[1] = upper; t[2] = blue; t[3] = red; t[4] = upper; t[5] = blue;
+      u[0] = red; u[1] = lower; u[2] = blue; u[3] = red; u[4] = lower; u[5] = blue;
+    };
+  };
+}
+
+template< typename T >
+static void interpolate( const T *src, T *dst, int width, int height, int begin,
+                         int end, const int *layout, bool edge )
+{
+  vector< T > planes( 3 * width );
+  T *r = &planes[0], *g = r + width, *b = g + width;
+  for ( int y=begin; y<end; y++ ) {
+    const T *row = src + y * width,
+      *above = src + ( y > 0 ? y - 1 : y + 1 ) * width,
+      *below = src + ( y < height - 1 ? y + 1 : y - 1 ) * width;
+    int greenParity = ( layout[1] + y ) & 1;
+    bool redRow = ( layout[0] < 2 ) != ( ( y & 1 ) != 0 );
+    pixel( above, row, below, 0, width, greenParity, redRow, edge, r, g, b );
+    for ( int x=simdRow( above, row, below, r, g, b, width, greenParity, redRow,
+                         edge ); x<width; x++ )
+      pixel( above, row, below, x, width, greenParity, redRow, edge, r, g, b );
+    T *q = dst + 3 * ( y - begin ) * width;
+    for ( int x=0; x<width; x++ ) {
+      q[ 3 * x     ] = r[ x ];
+      q[ 3 * x + 1 ] = g[ x ];
+      q[ 3 * x + 2 ] = b[ x ];
+    };
+  };
+}
+
+template< typename T >
+static void demosaicAny( const T *src, T *dst, int width, int height,
+                         dc1394color_filter_t pattern, DC1394Bayer::Method method,
+                         int begin, int end )
+  throw (Error)
+{
+  ERRORMACRO( pattern >= DC1394_COLOR_FILTER_RGGB &&
+              pattern <= DC1394_COLOR_FILTER_BGGR, Error, ,
+              "Unknown Bayer pattern " << pattern );
+  ERRORMACRO( width >= 2 && height >= 2 && width % 2 == 0 && height % 2 == 0,
+              Error, , "Bayer image size must be even (but was " << width << 'x'
+              << height << ")" );
+  if ( end < 0 ) end = height;
+  ERRORMACRO( begin >= 0 && begin % 2 == 0 && begin <= end && end <= height &&
+              ( end % 2 == 0 ), Error, , "Rows " << begin << " to " << end
+              << " must be an even range within the image" );
+  const int *layout = layouts[ pattern - DC1394_COLOR_FILTER_RGGB ];
+  switch ( method ) {
+  case DC1394Bayer::NEAREST:
+    nearest( src, dst, width, begin, end, layout );
+    break;
+  case DC1394Bayer::BILINEAR:
+    interpolate( src, dst, width, height, begin, end, layout, false );
+    break;
+  case DC1394Bayer::EDGE_AWARE:
+    interpolate( src, dst, width, height, begin, end, layout, true );
+    break;
+  default:
+    ERRORMACRO( false, Error, , "Unknown demosaicing method " << method );
+  };
+}
+
+void DC1394Bayer::demosaic( const uint8_t *src, uint8_t *dst, int width, int height,
+                            dc1394color_filter_t pattern, Method method,
+                            int begin, int end )
+  throw (Error)
+{
+  demosaicAny( src, dst, width, height, pattern, method, begin, end );
+}
+
+void DC1394Bayer::demosaic( const uint16_t *src, uint16_t *dst, int width, int height,
+                            dc1394color_filter_t pattern, Method method,
+                            int begin, int end )
+  throw (Error)
+{
+  demosaicAny( src, dst, width, height, pattern, method, begin, end );
+}
+
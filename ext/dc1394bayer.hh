@@ -0,0 +1,43 @@
+/* HornetsEye - Computer Vision with Ruby
+   Copyright (C) 2006, 2007, 2008, 2009, 2010 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef HORNETSEYE_DC1394BAYER_HH
+#define HORNETSEYE_DC1394BAYER_HH
+
+#include <stdint.h>
+#include <dc1394/dc1394.h>
+#include "error.hh"
+
+// Conversion of raw Bayer images to interleaved RGB images. The inner loops
+// use AVX2 or SSE2 depending on the instruction set the extension was
+// compiled for. Rows begin to end (an even range) are written to dst so that
+// parts of the image can be converted in parallel. By default the whole image
+// is converted.
+class DC1394Bayer
+{
+public:
+  enum Method { NEAREST = 0, BILINEAR, EDGE_AWARE };
+  static void demosaic( const uint8_t *src, uint8_t *dst, int width, int height,
+                        dc1394color_filter_t pattern, Method method,
+                        int begin = 0, int end = -1 )
+    throw (Error);
+  static void demosaic( const uint16_t *src, uint16_t *dst, int width, int height,
+                        dc1394color_filter_t pattern, Method method,
+                        int begin = 0, int end = -1 )
+    throw (Error);
+};
+
+#endif
+
@@ -0,0 +1,218 @@
+/* HornetsEye - Computer Vision with Ruby
+ Copyright (C) 2006, 2007, 2008, 2009, 2010 Jan Wedekind
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <time.h>
+#include "rubyinc.hh"
+#include "dc1394bench.hh"
+#include "dc1394convert.hh"
+#include "dc1394unpack.hh"
+#include "frame.hh"
+
+using namespace std;
+
+// Colour conversions timed by the benchmark with source coding and target type.
+static const struct
+{
+  const char *name;
+  dc1394color_coding_t coding;
+  const char *typecode;
+} KERNELS[] = {
+  { "yuv411_uyvy", DC1394_COLOR_CODING_YUV411, "UYVY" },
+  { "yuv411_rgb", DC1394_COLOR_CODING_YUV411, "UBYTERGB" },
+  { "yuv411_grey", DC1394_COLOR_CODING_YUV411, "UBYTE" },
+  { "uyvy_rgb", DC1394_COLOR_CODING_YUV422, "UBYTERGB" },
+  { "uyvy_grey", DC1394_COLOR_CODING_YUV422, "UBYTE" },
+  { "yuv444_rgb", DC1394_COLOR_CODING_YUV444, "UBYTERGB" },
+  { "yuv444_grey", DC1394_COLOR_CODING_YUV444, "UBYTE" },
+  { "rgb_grey", DC1394_COLOR_CODING_RGB8, "UBYTE" },
+  { "grey_rgb", DC1394_COLOR_CODING_MONO8, "UBYTERGB" },
+  { "bayer8_rgb", DC1394_COLOR_CODING_RAW8, "UBYTERGB" },
+  { "bayer8_grey", DC1394_COLOR_CODING_RAW8, "UBYTE" },
+  { "bayer16_rgb", DC1394_COLOR_CODING_RAW16, "USINTRGB" }
+};
+
+static const int NUM_KERNELS = sizeof( KERNELS ) / sizeof( KERNELS[0] );
+
+VALUE DC1394Bench::cRubyClass = Qnil;
+
+DC1394Bench::Result DC1394Bench::run( const string &name, int width, int height,
+                                      int frames ) throw (Error)
+{
+  ERRORMACRO( width > 0 && height > 0, Error, , "Benchmark image size must be "
+              "positive (but was " << width << 'x' << height << ")" );
+  ERRORMACRO( frames > 0, Error, , "Number of benchmark frames must be positive "
+              "(but was " << frames << ")" );
+  if ( name == "storage_size" ) return storageSize( width, height, frames );
+  if ( name == "wrap" ) return wrap( width, height, frames, false );
+  if ( name == "copy" ) return wrap( width, height, frames, true );
+  if ( name == "swap" ) return swap( width, height, frames );
+  for ( int i=0; i<NUM_KERNELS; i++ )
+    if ( name == KERNELS[i].name )
+      return convert( KERNELS[i].coding, KERNELS[i].typecode, width, height, frames );
+  ERRORMACRO( false, Error, , "Unknown benchmark \"" << name << "\"" );
+}
+
+double DC1394Bench::now(void)
+{
+  struct timespec t;
+  clock_gettime( CLOCK_MONOTONIC, &t );
+  return t.tv_sec + t.tv_nsec * 1.0e-9;
+}
+
+size_t DC1394Bench::allocations(void)
+{
+  return rb_gc_stat( ID2SYM( rb_intern( "total_allocated_objects" ) ) );
+}
+
+DC1394Bench::Result DC1394Bench::storageSize( int width, int height, int frames )
+{
+  VALUE rbTypecode = Frame::rubyTypecode( "UBYTERGB" );
+  Result retVal;
+  retVal.frames = frames;
+  size_t allocated = allocations();
+  double start = now();
+  for ( int i=0; i<frames; i++ )
+    Frame::storageSize( rbTypecode, width, height );
+  retVal.seconds = now() - start;
+  retVal.allocations = allocations() - allocated;
+  return retVal;
+}
+
+DC1394Bench::Result DC1394Bench::wrap( int width, int height, int frames,
+                                       bool copy )
+{
+  VALUE rbTypecode = Frame::rubyTypecode( "UBYTERGB" );
+  int size = Frame::storageSize( rbTypecode, width, height );
+  vector< char > buffer( size, 0 );
+  Result retVal;
+  retVal.frames = frames;
+  size_t allocated = allocations();
+  double start = now();
+  for ( int i=0; i<frames; i++ ) {
+    if ( copy ) {
+      // Like reading into a Ruby owned frame when no DMA buffer can be leased.
+      Frame frame( rbTypecode, width, height, size );
+      memcpy( frame.data(), &buffer[0], size );
+    } else
+      Frame frame( rbTypecode, width, height, size, &buffer[0] );
+  };
+  retVal.seconds = now() - start;
+  retVal.allocations = allocations() - allocated;
+  return retVal;
+}
+
+DC1394Bench::Result DC1394Bench::swap( int width, int height, int frames )
+{
+  vector< uint16_t > data( width * height );
+  for ( int i=0; i<(signed)data.size(); i++ )
+    data[i] = (uint16_t)rand();
+  Result retVal;
+  retVal.frames = frames;
+  size_t allocated = allocations();
+  double start = now();
+  for ( int i=0; i<frames; i++ )
+    DC1394Unpack::swapBytes( &data[0], data.size() );
+  retVal.seconds = now() - start;
+  retVal.allocations = allocations() - allocated;
+  return retVal;
+}
+
+DC1394Bench::Result DC1394Bench::convert( dc1394color_coding_t coding,
+                                          const string &typecode, int width,
+                                          int height, int frames ) throw (Error)
+{
+  DC1394Convert conversion;
+  conversion.setSource( coding, width, height );
+  conversion.setTypecode( typecode );
+  uint32_t bits;
+  dc1394_get_color_coding_bit_size( coding, &bits );
+  // Random input keeps branches and the cache from favouring any kernel.
+  vector< uint8_t > src( (size_t)width * height * bits / 8 );
+  for ( int i=0; i<(signed)src.size(); i++ )
+    src[i] = (uint8_t)rand();
+  vector< uint8_t > dst( Frame::storageSize( typecode, width, height ) );
+  conversion.convert( &src[0], &dst[0] );
+  Result retVal;
+  retVal.frames = frames;
+  size_t allocated = allocations();
+  double start = now();
+  for ( int i=0; i<frames; i++ )
+    conversion.convert( &src[0], &dst[0] );
+  retVal.seconds = now() - start;
+  retVal.allocations = allocations() - allocated;
+  return retVal;
+}
+
+VALUE DC1394Bench::registerRubyClass( VALUE module )
+{
+  cRubyClass = rb_define_class_under( module, "DC1394Bench", rb_cObject );
+  rb_undef_alloc_func( cRubyClass );
+  rb_define_singleton_method( cRubyClass, "benchmarks",
+                              RUBY_METHOD_FUNC( wrapBenchmarks ), 0 );
+  rb_define_singleton_method( cRubyClass, "run", RUBY_METHOD_FUNC( wrapRun ), 4 );
+  rb_define_singleton_method( cRubyClass, "simd", RUBY_METHOD_FUNC( wrapSIMD ), 0 );
+  return cRubyClass;
+}
+
+VALUE DC1394Bench::wrapBenchmarks( VALUE rbClass )
+{
+  VALUE rbRetVal = rb_ary_new();
+  rb_ary_push( rbRetVal, rb_str_new2( "storage_size" ) );
+  rb_ary_push( rbRetVal, rb_str_new2( "wrap" ) );
+  rb_ary_push( rbRetVal, rb_str_new2( "copy" ) );
+  rb_ary_push( rbRetVal, rb_str_new2( "swap" ) );
+  for ( int i=0; i<NUM_KERNELS; i++ )
+    rb_ary_push( rbRetVal, rb_str_new2( KERNELS[i].name ) );
+  return rbRetVal;
+}
+
+VALUE DC1394Bench::wrapSIMD( VALUE rbClass )
+{
+  // Instruction set of the colour conversion kernels selected at runtime.
+  VALUE rbRetVal = rb_ary_new();
+  if ( DC1394Unpack::ssse3() ) rb_ary_push( rbRetVal, rb_str_new2( "ssse3" ) );
+  if ( DC1394Unpack::avx2() ) rb_ary_push( rbRetVal, rb_str_new2( "avx2" ) );
+  return rbRetVal;
+}
+
+VALUE DC1394Bench::wrapRun( VALUE rbClass, VALUE rbName, VALUE rbWidth,
+                            VALUE rbHeight, VALUE rbFrames )
+{
+  VALUE rbRetVal = Qnil;
+  try {
+    int width = NUM2INT( rbWidth ), height = NUM2INT( rbHeight );
+    Result result = run( StringValuePtr( rbName ), width, height,
+                         NUM2INT( rbFrames ) );
+    double pixels = (double)width * height * result.frames;
+    rbRetVal = rb_hash_new();
+    rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "name" ) ), rbName );
+    rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "width" ) ), INT2NUM( width ) );
+    rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "height" ) ), INT2NUM( height ) );
+    rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "frames" ) ),
+                  INT2NUM( result.frames ) );
+    rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "fps" ) ),
+                  rb_float_new( result.frames / result.seconds ) );
+    rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "ns_per_pixel" ) ),
+                  rb_float_new( result.seconds * 1.0e+9 / pixels ) );
+    rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "allocations_per_frame" ) ),
+                  rb_float_new( (double)result.allocations / result.frames ) );
+  } catch ( std::exception &e ) {
+    rb_raise( rb_eRuntimeError, "%s", e.what() );
+  };
+  return rbRetVal;
+}
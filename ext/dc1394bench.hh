@@ -0,0 +1,52 @@
+/* HornetsEye - Computer Vision with Ruby
+ Copyright (C) 2006, 2007, 2008, 2009, 2010 Jan Wedekind
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef HORNETSEYE_DC1394BENCH_HH
+#define HORNETSEYE_DC1394BENCH_HH
+
+#include <string>
+#include <dc1394/dc1394.h>
+#include "rubyinc.hh"
+#include "error.hh"
+
+// Microbenchmarks of the native stages of the capture pipeline.
+class DC1394Bench
+{
+public:
+  struct Result
+  {
+    int frames;
+    double seconds;
+    size_t allocations;
+  };
+  static Result run( const std::string &name, int width, int height, int frames )
+    throw (Error);
+  static VALUE cRubyClass;
+  static VALUE registerRubyClass( VALUE module );
+  static VALUE wrapBenchmarks( VALUE rbClass );
+  static VALUE wrapSIMD( VALUE rbClass );
+  static VALUE wrapRun( VALUE rbClass, VALUE rbName, VALUE rbWidth, VALUE rbHeight,
+                        VALUE rbFrames );
+protected:
+  static double now(void);
+  static size_t allocations(void);
+  static Result storageSize( int width, int height, int frames );
+  static Result wrap( int width, int height, int frames, bool copy );
+  static Result swap( int width, int height, int frames );
+  static Result convert( dc1394color_coding_t coding, const std::string &typecode,
+                         int width, int height, int frames ) throw (Error);
+};
+
+#endif
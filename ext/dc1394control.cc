@@ -0,0 +1,207 @@
+/* HornetsEye - Computer Vision with Ruby
+ Copyright (C) 2006, 2007, 2008, 2009, 2010 Jan Wedekind
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include <cstring>
+#include <time.h>
+#include "dc1394control.hh"
+
+using namespace std;
+
+// Maximum number of completed batches waiting to be paired with a frame.
+static const unsigned int MAX_APPLIED = 64;
+
+static uint64_t realtime(void)
+{
+  // Frame timestamps are based on the wall clock.
+  struct timespec t;
+  clock_gettime( CLOCK_REALTIME, &t );
+  return (uint64_t)t.tv_sec * 1000000 + t.tv_nsec / 1000;
+}
+
+DC1394Control::DC1394Control( DC1394BackendPtr backend, dc1394camera_t *camera,
+                              pthread_mutex_t *bus ) throw (Error):
+  m_backend( backend ), m_camera( camera ), m_bus( bus ), m_quit( false ),
+  m_busy( false ), m_interrupted( false ), m_serial( 0 ), m_effective( 0 ),
+  m_error( DC1394_SUCCESS ), m_errorSerial( 0 )
+{
+  pthread_mutex_init( &m_mutex, NULL );
+  pthread_cond_init( &m_cond, NULL );
+  int err = pthread_create( &m_thread, NULL, controlThread, this );
+  if ( err != 0 ) {
+    pthread_cond_destroy( &m_cond );
+    pthread_mutex_destroy( &m_mutex );
+    ERRORMACRO( false, Error, , "Error starting feature control thread: "
+                << strerror( err ) );
+  };
+}
+
+DC1394Control::~DC1394Control(void)
+{
+  // Pending writes are applied before the thread terminates.
+  pthread_mutex_lock( &m_mutex );
+  m_quit = true;
+  pthread_cond_broadcast( &m_cond );
+  pthread_mutex_unlock( &m_mutex );
+  // The garbage collector must not release the GVL while it is running.
+  if ( rb_during_gc() )
+    pthread_join( m_thread, NULL );
+  else
+    rb_thread_call_without_gvl( joinWithoutGVL, this, NULL, NULL );
+  pthread_cond_destroy( &m_cond );
+  pthread_mutex_destroy( &m_mutex );
+}
+
+uint32_t DC1394Control::submit( dc1394feature_t feature, Command command,
+                                uint32_t value )
+{
+  pthread_mutex_lock( &m_mutex );
+  Write &write = m_pending[ make_pair( (int)feature, (int)command ) ];
+  write.value = value;
+  write.serial = ++m_serial;
+  uint32_t retVal = m_serial;
+  pthread_cond_broadcast( &m_cond );
+  pthread_mutex_unlock( &m_mutex );
+  return retVal;
+}
+
+bool DC1394Control::flush(void) throw (Error)
+{
+  m_interrupted = false;
+  rb_thread_call_without_gvl( flushWithoutGVL, this, interruptFlush, this );
+  pthread_mutex_lock( &m_mutex );
+  bool retVal = !m_interrupted;
+  dc1394error_t err = m_error;
+  uint32_t serial = m_errorSerial;
+  // Errors are reported once only.
+  if ( retVal ) m_error = DC1394_SUCCESS;
+  pthread_mutex_unlock( &m_mutex );
+  ERRORMACRO( !retVal || err == DC1394_SUCCESS, Error, , "Error writing feature "
+              "(serial number " << serial << "): "
+              << dc1394_error_get_string( err ) );
+  return retVal;
+}
+
+uint32_t DC1394Control::effective( uint64_t timestamp )
+{
+  pthread_mutex_lock( &m_mutex );
+  while ( !m_applied.empty() && m_applied.front().second <= timestamp ) {
+    m_effective = m_applied.front().first;
+    m_applied.pop_front();
+  };
+  uint32_t retVal = m_effective;
+  pthread_mutex_unlock( &m_mutex );
+  return retVal;
+}
+
+void DC1394Control::written( ValueMap &values )
+{
+  values.clear();
+  pthread_mutex_lock( &m_mutex );
+  values.swap( m_written );
+  pthread_mutex_unlock( &m_mutex );
+}
+
+void DC1394Control::run(void)
+{
+  pthread_mutex_lock( &m_mutex );
+  while ( true ) {
+    while ( m_pending.empty() && !m_quit )
+      pthread_cond_wait( &m_cond, &m_mutex );
+    if ( m_pending.empty() ) break;
+    WriteMap batch;
+    batch.swap( m_pending );
+    m_busy = true;
+    pthread_mutex_unlock( &m_mutex );
+    dc1394error_t err = DC1394_SUCCESS;
+    uint32_t serial = 0, errorSerial = 0;
+    ValueMap values;
+    for ( WriteMap::const_iterator i=batch.begin(); i!=batch.end(); i++ ) {
+      dc1394error_t e = apply( (dc1394feature_t)i->first.first,
+                               (Command)i->first.second, i->second.value );
+      if ( e == DC1394_SUCCESS )
+        values[ i->first ] = i->second.value;
+      else if ( err == DC1394_SUCCESS ) {
+        err = e;
+        errorSerial = i->second.serial;
+      };
+      if ( i->second.serial > serial ) serial = i->second.serial;
+    };
+    uint64_t time = realtime();
+    pthread_mutex_lock( &m_mutex );
+    for ( ValueMap::const_iterator i=values.begin(); i!=values.end(); i++ )
+      m_written[ i->first ] = i->second;
+    m_busy = false;
+    if ( m_error == DC1394_SUCCESS ) {
+      m_error = err;
+      m_errorSerial = errorSerial;
+    };
+    // Batches which were not paired with a frame are discarded eventually.
+    if ( m_applied.size() >= MAX_APPLIED ) m_applied.pop_front();
+    m_applied.push_back( make_pair( serial, time ) );
+    pthread_cond_broadcast( &m_cond );
+  };
+  pthread_mutex_unlock( &m_mutex );
+}
+
+dc1394error_t DC1394Control::apply( dc1394feature_t feature, Command command,
+                                    uint32_t value )
+{
+  DC1394BusLock lock( m_bus );
+  dc1394error_t retVal;
+  switch ( command ) {
+  case SET_MODE:
+    retVal = m_backend->featureSetMode( m_camera, feature,
+                                        (dc1394feature_mode_t)value );
+    break;
+  case SET_POWER:
+    retVal = m_backend->featureSetPower( m_camera, feature, (dc1394switch_t)value );
+    break;
+  default:
+    retVal = m_backend->featureSetValue( m_camera, feature, value );
+    break;
+  };
+  return retVal;
+}
+
+void *DC1394Control::controlThread( void *ptr )
+{
+  ((DC1394Control *)ptr)->run();
+  return NULL;
+}
+
+void *DC1394Control::flushWithoutGVL( void *ptr )
+{
+  DC1394Control *self = (DC1394Control *)ptr;
+  pthread_mutex_lock( &self->m_mutex );
+  while ( ( !self->m_pending.empty() || self->m_busy ) && !self->m_interrupted )
+    pthread_cond_wait( &self->m_cond, &self->m_mutex );
+  pthread_mutex_unlock( &self->m_mutex );
+  return NULL;
+}
+
+void DC1394Control::interruptFlush( void *ptr )
+{
+  DC1394Control *self = (DC1394Control *)ptr;
+  pthread_mutex_lock( &self->m_mutex );
+  self->m_interrupted = true;
+  pthread_cond_broadcast( &self->m_cond );
+  pthread_mutex_unlock( &self->m_mutex );
+}
+
+void *DC1394Control::joinWithoutGVL( void *ptr )
+{
+  pthread_join( ((DC1394Control *)ptr)->m_thread, NULL );
+  return NULL;
+}
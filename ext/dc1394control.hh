@@ -0,0 +1,92 @@
+/* HornetsEye - Computer Vision with Ruby
+ Copyright (C) 2006, 2007, 2008, 2009, 2010 Jan Wedekind
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef HORNETSEYE_DC1394CONTROL_HH
+#define HORNETSEYE_DC1394CONTROL_HH
+
+#include <pthread.h>
+#include <deque>
+#include <map>
+#include <boost/smart_ptr.hpp>
+#include <dc1394/dc1394.h>
+#include "error.hh"
+#include "dc1394backend.hh"
+#include "rubyinc.hh"
+
+// Holds the mutex which serialises the register transactions with a camera.
+// libdc1394 camera handles must not be used by two threads at the same time.
+class DC1394BusLock
+{
+public:
+  DC1394BusLock( pthread_mutex_t *mutex ): m_mutex( mutex )
+  { pthread_mutex_lock( m_mutex ); }
+  ~DC1394BusLock(void) { pthread_mutex_unlock( m_mutex ); }
+protected:
+  pthread_mutex_t *m_mutex;
+};
+
+// Writes feature registers in a background thread. Pending writes to the same
+// feature are coalesced so that only the most recent value reaches the camera.
+class DC1394Control
+{
+public:
+  // Writes to one feature are applied in this order.
+  enum Command { SET_MODE = 0, SET_POWER, SET_VALUE };
+  DC1394Control( DC1394BackendPtr backend, dc1394camera_t *camera,
+                 pthread_mutex_t *bus ) throw (Error);
+  virtual ~DC1394Control(void);
+  uint32_t submit( dc1394feature_t feature, Command command, uint32_t value );
+  bool flush(void) throw (Error);
+  uint32_t effective( uint64_t timestamp );
+  // Most recent value successfully written to each feature and command.
+  typedef std::map< std::pair< int, int >, uint32_t > ValueMap;
+  void written( ValueMap &values );
+protected:
+  struct Write
+  {
+    uint32_t value;
+    uint32_t serial;
+  };
+  typedef std::map< std::pair< int, int >, Write > WriteMap;
+  void run(void);
+  dc1394error_t apply( dc1394feature_t feature, Command command, uint32_t value );
+  static void *controlThread( void *ptr );
+  static void *flushWithoutGVL( void *ptr );
+  static void interruptFlush( void *ptr );
+  static void *joinWithoutGVL( void *ptr );
+  DC1394BackendPtr m_backend;
+  dc1394camera_t *m_camera;
+  // Mutex of the camera handle shared with the thread owning the camera.
+  pthread_mutex_t *m_bus;
+  pthread_t m_thread;
+  pthread_mutex_t m_mutex;
+  pthread_cond_t m_cond;
+  bool m_quit;
+  bool m_busy;
+  bool m_interrupted;
+  WriteMap m_pending;
+  uint32_t m_serial;
+  // Serial number of the last write of each batch and the time it completed.
+  std::deque< std::pair< uint32_t, uint64_t > > m_applied;
+  uint32_t m_effective;
+  ValueMap m_written;
+  // First failed write since the last flush and its serial number.
+  dc1394error_t m_error;
+  uint32_t m_errorSerial;
+};
+
+typedef boost::shared_ptr< DC1394Control > DC1394ControlPtr;
+
+#endif
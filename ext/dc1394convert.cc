@@ -0,0 +1,219 @@
+/* HornetsEye - Computer Vision with Ruby
+   Copyright (C) 2006, 2007, 2008, 2009, 2010 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include "dc1394convert.hh"
+#include "dc1394pool.hh"
+#include "dc1394unpack.hh"
+
+using namespace std;
+
+// Minimum number of pixels converted by one thread of the pool.
+static const int STRIPE_PIXELS = 1 << 16;
+
+struct DC1394Job
+{
+  const DC1394Convert *convert;
+  const uint8_t *src;
+  uint8_t *dst;
+};
+
+DC1394Convert::DC1394Convert(void):
+  m_coding( DC1394_COLOR_CODING_MONO8 ), m_typecode( "UBYTE" ), m_kernel( COPY ),
+  m_width( 0 ), m_height( 0 ), m_bayerPattern( DC1394_COLOR_FILTER_RGGB ),
+  m_demosaic( DC1394Bayer::BILINEAR )
+{
+}
+
+void DC1394Convert::setSource( dc1394color_coding_t coding, int width, int height )
+  throw (Error)
+{
+  string typecode = nativeTypecode( coding );
+  if ( coding == DC1394_COLOR_CODING_RAW8 || coding == DC1394_COLOR_CODING_RAW16 )
+    ERRORMACRO( width % 2 == 0 && height % 2 == 0, Error, , "Size of raw Bayer "
+                "image must be even (but was " << width << 'x' << height << ")" );
+  if ( coding == DC1394_COLOR_CODING_YUV411 )
+    ERRORMACRO( width % 4 == 0, Error, , "Width of YUV411 image must be a "
+                "multiple of 4 (but was " << width << ")" );
+  m_coding = coding;
+  m_width = width;
+  m_height = height;
+  m_typecode = typecode;
+  m_kernel = kernel( coding, typecode );
+}
+
+void DC1394Convert::setTypecode( const string &typecode ) throw (Error)
+{
+  Kernel k = kernel( m_coding, typecode );
+  ERRORMACRO( k != NONE, Error, , "Conversion from DC1394 colorspace " << m_coding
+              << " to " << typecode << " is not supported" );
+  m_typecode = typecode;
+  m_kernel = k;
+}
+
+void DC1394Convert::setBayerPattern( dc1394color_filter_t pattern ) throw (Error)
+{
+  ERRORMACRO( pattern >= DC1394_COLOR_FILTER_RGGB &&
+              pattern <= DC1394_COLOR_FILTER_BGGR, Error, ,
+              "Unknown Bayer pattern " << pattern );
+  m_bayerPattern = pattern;
+}
+
+void DC1394Convert::setDemosaic( DC1394Bayer::Method method ) throw (Error)
+{
+  ERRORMACRO( method >= DC1394Bayer::NEAREST && method <= DC1394Bayer::EDGE_AWARE,
+              Error, , "Unknown demosaicing method " << method );
+  m_demosaic = method;
+}
+
+void DC1394Convert::convert( const uint8_t *src, uint8_t *dst ) const
+{
+  DC1394Job job;
+  job.convert = this;
+  job.src = src;
+  job.dst = dst;
+  // Stripes have an even number of rows because of the Bayer pattern.
+  int rows = ( STRIPE_PIXELS / max( m_width, 1 ) + 2 ) & ~1;
+  DC1394Pool::run( convertStripe, &job, m_height, rows );
+}
+
+void DC1394Convert::convert( const uint8_t *src, uint8_t *dst, int begin, int end )
+  const
+{
+  int size = ( end - begin ) * m_width, offset = begin * m_width;
+  switch ( m_kernel ) {
+  case YUV411_UYVY:
+    DC1394Unpack::yuv411ToUYVY( src + offset * 3 / 2, dst + offset * 2, size );
+    break;
+  case YUV411_RGB:
+    DC1394Unpack::yuv411ToRGB( src + offset * 3 / 2, dst + offset * 3, size );
+    break;
+  case YUV411_GREY:
+    DC1394Unpack::yuv411ToGrey( src + offset * 3 / 2, dst + offset, size );
+    break;
+  case UYVY_RGB:
+    DC1394Unpack::uyvyToRGB( src + offset * 2, dst + offset * 3, size );
+    break;
+  case UYVY_GREY:
+    DC1394Unpack::uyvyToGrey( src + offset * 2, dst + offset, size );
+    break;
+  case YUV444_RGB:
+    DC1394Unpack::yuv444ToRGB( src + offset * 3, dst + offset * 3, size );
+    break;
+  case YUV444_GREY:
+    DC1394Unpack::yuv444ToGrey( src + offset * 3, dst + offset, size );
+    break;
+  case RGB_GREY:
+    DC1394Unpack::rgbToGrey( src + offset * 3, dst + offset, size );
+    break;
+  case GREY_RGB:
+    DC1394Unpack::greyToRGB( src + offset, dst + offset * 3, size );
+    break;
+  case BAYER8_RGB:
+    DC1394Bayer::demosaic( src, dst + offset * 3, m_width, m_height, m_bayerPattern,
+                           m_demosaic, begin, end );
+    break;
+  case BAYER8_GREY: {
+    // Demosaic two rows at a time so that the RGB values stay in the cache.
+    vector< uint8_t > rgb( 6 * m_width );
+    for ( int y=begin; y<end; y+=2 ) {
+      DC1394Bayer::demosaic( src, &rgb[0], m_width, m_height, m_bayerPattern,
+                             m_demosaic, y, y + 2 );
+      DC1394Unpack::rgbToGrey( &rgb[0], dst + y * m_width, 2 * m_width );
+    };
+    break; }
+  case BAYER16_RGB:
+    DC1394Bayer::demosaic( (const uint16_t *)src, (uint16_t *)dst + offset * 3,
+                           m_width, m_height, m_bayerPattern, m_demosaic, begin, end );
+    break;
+  default:
+    break;
+  };
+}
+
+string DC1394Convert::nativeTypecode( dc1394color_coding_t coding ) throw (Error)
+{
+  string retVal;
+  switch ( coding ) {
+  case DC1394_COLOR_CODING_MONO8:
+    retVal = "UBYTE";
+    break;
+  case DC1394_COLOR_CODING_YUV411:
+  case DC1394_COLOR_CODING_YUV422:
+    retVal = "UYVY";
+    break;
+  case DC1394_COLOR_CODING_YUV444:
+  case DC1394_COLOR_CODING_RGB8:
+  case DC1394_COLOR_CODING_RAW8:
+    retVal = "UBYTERGB";
+    break;
+  case DC1394_COLOR_CODING_MONO16:
+    retVal = "USINT";
+    break;
+  case DC1394_COLOR_CODING_RGB16:
+  case DC1394_COLOR_CODING_RAW16:
+    retVal = "USINTRGB";
+    break;
+  case DC1394_COLOR_CODING_MONO16S:
+    retVal = "SINT";
+    break;
+  case DC1394_COLOR_CODING_RGB16S:
+    retVal = "SINTRGB";
+    break;
+  default:
+    ERRORMACRO( false, Error, , "Conversion for DC1394 colorspace " << coding
+                << " not implemented yet" );
+  };
+  return retVal;
+}
+
+DC1394Convert::Kernel DC1394Convert::kernel( dc1394color_coding_t coding,
+                                             const string &typecode )
+{
+  bool rgb = typecode == "UBYTERGB", grey = typecode == "UBYTE",
+    uyvy = typecode == "UYVY";
+  switch ( coding ) {
+  case DC1394_COLOR_CODING_MONO8:
+    return grey ? COPY : ( rgb ? GREY_RGB : NONE );
+  case DC1394_COLOR_CODING_YUV411:
+    return uyvy ? YUV411_UYVY : ( rgb ? YUV411_RGB : ( grey ? YUV411_GREY : NONE ) );
+  case DC1394_COLOR_CODING_YUV422:
+    return uyvy ? COPY : ( rgb ? UYVY_RGB : ( grey ? UYVY_GREY : NONE ) );
+  case DC1394_COLOR_CODING_YUV444:
+    return rgb ? YUV444_RGB : ( grey ? YUV444_GREY : NONE );
+  case DC1394_COLOR_CODING_RGB8:
+    return rgb ? COPY : ( grey ? RGB_GREY : NONE );
+  case DC1394_COLOR_CODING_RAW8:
+    return rgb ? BAYER8_RGB : ( grey ? BAYER8_GREY : NONE );
+  case DC1394_COLOR_CODING_RAW16:
+    return typecode == "USINTRGB" ? BAYER16_RGB : NONE;
+  case DC1394_COLOR_CODING_MONO16:
+  case DC1394_COLOR_CODING_RGB16:
+  case DC1394_COLOR_CODING_MONO16S:
+  case DC1394_COLOR_CODING_RGB16S:
+    return typecode == nativeTypecode( coding ) ? COPY : NONE;
+  default:
+    return NONE;
+  };
+}
+
+void DC1394Convert::convertStripe( void *data, int begin, int end )
+{
+  DC1394Job *job = (DC1394Job *)data;
+  job->convert->convert( job->src, job->dst, begin, end );
+}
+
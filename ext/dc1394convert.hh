@@ -0,0 +1,58 @@
+/* HornetsEye - Computer Vision with Ruby
+   Copyright (C) 2006, 2007, 2008, 2009, 2010 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef HORNETSEYE_DC1394CONVERT_HH
+#define HORNETSEYE_DC1394CONVERT_HH
+
+#include <string>
+#include <dc1394/dc1394.h>
+#include "error.hh"
+#include "dc1394bayer.hh"
+
+// Conversion of DMA buffers to the desired Hornetseye typecode in a single
+// pass. Large images are split into stripes of rows converted by the worker
+// pool.
+class DC1394Convert
+{
+public:
+  DC1394Convert(void);
+  void setSource( dc1394color_coding_t coding, int width, int height ) throw (Error);
+  void setTypecode( const std::string &typecode ) throw (Error);
+  const std::string &typecode(void) const { return m_typecode; }
+  bool required(void) const { return m_kernel != COPY; }
+  dc1394color_filter_t bayerPattern(void) const { return m_bayerPattern; }
+  void setBayerPattern( dc1394color_filter_t pattern ) throw (Error);
+  DC1394Bayer::Method demosaic(void) const { return m_demosaic; }
+  void setDemosaic( DC1394Bayer::Method method ) throw (Error);
+  void convert( const uint8_t *src, uint8_t *dst ) const;
+  void convert( const uint8_t *src, uint8_t *dst, int begin, int end ) const;
+  static std::string nativeTypecode( dc1394color_coding_t coding ) throw (Error);
+protected:
+  enum Kernel { NONE = -1, COPY = 0, YUV411_UYVY, YUV411_RGB, YUV411_GREY,
+                UYVY_RGB, UYVY_GREY, YUV444_RGB, YUV444_GREY, RGB_GREY,
+                GREY_RGB, BAYER8_RGB, BAYER8_GREY, BAYER16_RGB };
+  static Kernel kernel( dc1394color_coding_t coding, const std::string &typecode );
+  static void convertStripe( void *data, int begin, int end );
+  dc1394color_coding_t m_coding;
+  std::string m_typecode;
+  Kernel m_kernel;
+  int m_width;
+  int m_height;
+  dc1394color_filter_t m_bayerPattern;
+  DC1394Bayer::Method m_demosaic;
+};
+
+#endif
+
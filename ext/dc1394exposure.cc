@@ -0,0 +1,258 @@
+/* HornetsEye - Computer Vision with Ruby
+ Copyright (C) 2006, 2007, 2008, 2009, 2010 Jan Wedekind
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "dc1394exposure.hh"
+#include "dc1394unpack.hh"
+
+using namespace std;
+
+// Largest correction in one step in stops (factors of two).
+static const double MAX_STOPS = 4.0;
+
+// Count sampled values in four histograms so that consecutive increments of
+// the same bin do not wait for each other.
+static inline void count( const uint8_t *row, int size, int step,
+                          uint32_t bins[][ DC1394Exposure::NUM_BINS ] )
+{
+  int i = 0;
+  for ( ; i + 3 * step < size; i += 4 * step ) {
+    bins[0][ row[ i ] ]++;
+    bins[1][ row[ i + step ] ]++;
+    bins[2][ row[ i + 2 * step ] ]++;
+    bins[3][ row[ i + 3 * step ] ]++;
+  };
+  for ( ; i < size; i += step )
+    bins[0][ row[ i ] ]++;
+}
+
+static inline uint32_t clamp( double value, uint32_t min, uint32_t max )
+{
+  return value <= min ? min : ( value >= max ? max : (uint32_t)floor( value + 0.5 ) );
+}
+
+DC1394Exposure::DC1394Exposure( const Config &config, uint32_t shutter,
+                                uint32_t gain ):
+  m_config( config ), m_shutter( shutter ), m_gain( gain ), m_mean( 0 ),
+  m_errors( 0 )
+{
+  memset( m_histogram, 0, sizeof(m_histogram) );
+}
+
+DC1394Exposure::Config DC1394Exposure::config( VALUE rbOptions,
+                                               const dc1394feature_info_t &shutter,
+                                               const dc1394feature_info_t &gain )
+  throw (Error)
+{
+  if ( NIL_P( rbOptions ) ) rbOptions = rb_hash_new();
+  ERRORMACRO( TYPE( rbOptions ) == T_HASH, Error, , "Exposure control options "
+              "must be a hash" );
+  VALUE rbTarget = rb_hash_aref( rbOptions, ID2SYM( rb_intern( "target" ) ) ),
+    rbTolerance = rb_hash_aref( rbOptions, ID2SYM( rb_intern( "tolerance" ) ) ),
+    rbDamping = rb_hash_aref( rbOptions, ID2SYM( rb_intern( "damping" ) ) ),
+    rbStep = rb_hash_aref( rbOptions, ID2SYM( rb_intern( "step" ) ) ),
+    rbROI = rb_hash_aref( rbOptions, ID2SYM( rb_intern( "roi" ) ) ),
+    rbShutterMin = rb_hash_aref( rbOptions, ID2SYM( rb_intern( "shutter_min" ) ) ),
+    rbShutterMax = rb_hash_aref( rbOptions, ID2SYM( rb_intern( "shutter_max" ) ) ),
+    rbGainMin = rb_hash_aref( rbOptions, ID2SYM( rb_intern( "gain_min" ) ) ),
+    rbGainMax = rb_hash_aref( rbOptions, ID2SYM( rb_intern( "gain_max" ) ) ),
+    rbGainPerStop = rb_hash_aref( rbOptions, ID2SYM( rb_intern( "gain_per_stop" ) ) );
+  Config retVal;
+  retVal.target = NIL_P( rbTarget ) ? 110.0 : NUM2DBL( rbTarget );
+  retVal.tolerance = NIL_P( rbTolerance ) ? 8.0 : NUM2DBL( rbTolerance );
+  retVal.damping = NIL_P( rbDamping ) ? 0.5 : NUM2DBL( rbDamping );
+  retVal.step = NIL_P( rbStep ) ? 4 : NUM2INT( rbStep );
+  ERRORMACRO( retVal.target > 0 && retVal.target < NUM_BINS - 1, Error, ,
+              "Value of :target must be between 0 and " << NUM_BINS - 1
+              << " (but was " << retVal.target << ")" );
+  ERRORMACRO( retVal.tolerance >= 0, Error, , "Value of :tolerance must not be "
+              "negative (but was " << retVal.tolerance << ")" );
+  ERRORMACRO( retVal.damping >= 0 && retVal.damping < 1, Error, , "Value of "
+              ":damping must be in [0, 1) (but was " << retVal.damping << ")" );
+  ERRORMACRO( retVal.step >= 1, Error, , "Value of :step must be at least 1 (but "
+              "was " << retVal.step << ")" );
+  retVal.left = 0;
+  retVal.top = 0;
+  retVal.width = 0;
+  retVal.height = 0;
+  if ( !NIL_P( rbROI ) ) {
+    ERRORMACRO( TYPE( rbROI ) == T_ARRAY && RARRAY_LEN( rbROI ) == 4, Error, ,
+                "Value of :roi must be an array with left, top, width, and "
+                "height" );
+    retVal.left = NUM2UINT( rb_ary_entry( rbROI, 0 ) );
+    retVal.top = NUM2UINT( rb_ary_entry( rbROI, 1 ) );
+    retVal.width = NUM2UINT( rb_ary_entry( rbROI, 2 ) );
+    retVal.height = NUM2UINT( rb_ary_entry( rbROI, 3 ) );
+    ERRORMACRO( retVal.width > 0 && retVal.height > 0, Error, , "Region of "
+                "interest must not be empty" );
+  };
+  retVal.shutterMin = NIL_P( rbShutterMin ) ? shutter.min : NUM2UINT( rbShutterMin );
+  retVal.shutterMax = NIL_P( rbShutterMax ) ? shutter.max : NUM2UINT( rbShutterMax );
+  ERRORMACRO( retVal.shutterMin <= retVal.shutterMax, Error, , "Shutter range "
+              << retVal.shutterMin << " to " << retVal.shutterMax << " is empty" );
+  if ( gain.available != DC1394_FALSE ) {
+    retVal.gainMin = NIL_P( rbGainMin ) ? gain.min : NUM2UINT( rbGainMin );
+    retVal.gainMax = NIL_P( rbGainMax ) ? gain.max : NUM2UINT( rbGainMax );
+    ERRORMACRO( retVal.gainMin <= retVal.gainMax, Error, , "Gain range "
+                << retVal.gainMin << " to " << retVal.gainMax << " is empty" );
+  } else {
+    // Without a gain feature only the shutter is controlled.
+    retVal.gainMin = 0;
+    retVal.gainMax = 0;
+  };
+  // By default the whole gain range amounts to four stops.
+  retVal.gainPerStop = NIL_P( rbGainPerStop ) ?
+    max( ( retVal.gainMax - retVal.gainMin ) / 4.0, 1.0 ) : NUM2DBL( rbGainPerStop );
+  ERRORMACRO( retVal.gainPerStop > 0, Error, , "Value of :gain_per_stop must be "
+              "positive (but was " << retVal.gainPerStop << ")" );
+  return retVal;
+}
+
+bool DC1394Exposure::supported( dc1394color_coding_t coding )
+{
+  switch ( coding ) {
+  case DC1394_COLOR_CODING_MONO8:
+  case DC1394_COLOR_CODING_RAW8:
+  case DC1394_COLOR_CODING_YUV411:
+  case DC1394_COLOR_CODING_YUV422:
+  case DC1394_COLOR_CODING_YUV444:
+  case DC1394_COLOR_CODING_RGB8:
+  case DC1394_COLOR_CODING_MONO16:
+  case DC1394_COLOR_CODING_RAW16:
+    return true;
+  default:
+    return false;
+  };
+}
+
+double DC1394Exposure::measure( const dc1394video_frame_t *frame,
+                                dc1394color_coding_t coding, unsigned int width,
+                                unsigned int height )
+{
+  unsigned int left = 0, top = 0, w = width, h = height;
+  if ( m_config.width > 0 && m_config.height > 0 ) {
+    left = min( m_config.left, width );
+    top = min( m_config.top, height );
+    w = min( m_config.width, width - left );
+    h = min( m_config.height, height - top );
+  };
+  if ( w == 0 || h == 0 ) return m_mean;
+  // Packed pixels are only unpacked from the start of a group.
+  if ( coding == DC1394_COLOR_CODING_YUV411 )
+    left &= ~3u;
+  else if ( coding == DC1394_COLOR_CODING_YUV422 )
+    left &= ~1u;
+  uint32_t bits;
+  dc1394_get_color_coding_bit_size( coding, &bits );
+  size_t stride = frame->stride > 0 ? frame->stride : (size_t)width * bits / 8;
+  // The most significant bits of 16 bit pixels are used.
+  int shift = frame->data_depth > 8 ? frame->data_depth - 8 : 8;
+  if ( m_row.size() < w ) m_row.resize( w );
+  uint32_t bins[4][ NUM_BINS ];
+  memset( bins, 0, sizeof(bins) );
+  for ( unsigned int y=top; y<top+h; y+=m_config.step ) {
+    const uint8_t *row = frame->image + y * stride, *luma = &m_row[0];
+    // Luminance is extracted for the whole row by the unpack kernels which use
+    // SSSE3 if the processor supports it.
+    switch ( coding ) {
+    case DC1394_COLOR_CODING_YUV411:
+      DC1394Unpack::yuv411ToGrey( row + left * 3 / 2, &m_row[0], w );
+      break;
+    case DC1394_COLOR_CODING_YUV422:
+      DC1394Unpack::uyvyToGrey( row + left * 2, &m_row[0], w );
+      break;
+    case DC1394_COLOR_CODING_YUV444:
+      DC1394Unpack::yuv444ToGrey( row + left * 3, &m_row[0], w );
+      break;
+    case DC1394_COLOR_CODING_RGB8:
+      DC1394Unpack::rgbToGrey( row + left * 3, &m_row[0], w );
+      break;
+    case DC1394_COLOR_CODING_MONO16:
+    case DC1394_COLOR_CODING_RAW16:
+      // 16 bit pixels are in host byte order at this point.
+      DC1394Unpack::shortToGrey( (const uint16_t *)row + left, &m_row[0], w, shift );
+      break;
+    default:
+      // Raw Bayer values are used as they are.
+      luma = row + left;
+      break;
+    };
+    count( luma, w, m_config.step, bins );
+  };
+  uint64_t total = 0, sum = 0;
+  for ( int i=0; i<NUM_BINS; i++ ) {
+    m_histogram[i] = bins[0][i] + bins[1][i] + bins[2][i] + bins[3][i];
+    total += m_histogram[i];
+    sum += (uint64_t)m_histogram[i] * i;
+  };
+  m_mean = total > 0 ? (double)sum / total : 0.0;
+  return m_mean;
+}
+
+bool DC1394Exposure::control( double mean )
+{
+  if ( fabs( mean - m_config.target ) <= m_config.tolerance ) return false;
+  // Brightness is assumed to be proportional to the shutter time and to double
+  // with every gainPerStop units of gain.
+  double stops = log2( m_config.target / max( mean, 0.5 ) ) * ( 1.0 - m_config.damping );
+  stops = max( -MAX_STOPS, min( stops, MAX_STOPS ) );
+  double shutter = max( m_shutter, 1u ), gain = m_gain;
+  uint32_t newShutter, newGain;
+  if ( stops > 0 ) {
+    // Lengthen the shutter time before raising the gain.
+    newShutter = clamp( shutter * pow( 2.0, stops ), m_config.shutterMin,
+                        m_config.shutterMax );
+    stops -= log2( max( newShutter, 1u ) / shutter );
+    newGain = clamp( gain + max( stops, 0.0 ) * m_config.gainPerStop,
+                     m_config.gainMin, m_config.gainMax );
+  } else {
+    // Lower the gain before shortening the shutter time.
+    newGain = clamp( gain + stops * m_config.gainPerStop, m_config.gainMin,
+                     m_config.gainMax );
+    stops -= ( newGain - gain ) / m_config.gainPerStop;
+    newShutter = clamp( shutter * pow( 2.0, min( stops, 0.0 ) ), m_config.shutterMin,
+                        m_config.shutterMax );
+  };
+  bool retVal = newShutter != m_shutter || newGain != m_gain;
+  m_shutter = newShutter;
+  m_gain = newGain;
+  return retVal;
+}
+
+void DC1394Exposure::failed( const std::string &message )
+{
+  m_errors++;
+  m_lastError = message;
+}
+
+VALUE DC1394Exposure::toRuby(void) const
+{
+  VALUE rbHistogram = rb_ary_new();
+  for ( int i=0; i<NUM_BINS; i++ )
+    rb_ary_push( rbHistogram, UINT2NUM( m_histogram[i] ) );
+  VALUE rbRetVal = rb_hash_new();
+  rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "target" ) ),
+                rb_float_new( m_config.target ) );
+  rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "mean" ) ), rb_float_new( m_mean ) );
+  rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "shutter" ) ), UINT2NUM( m_shutter ) );
+  rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "gain" ) ), UINT2NUM( m_gain ) );
+  rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "histogram" ) ), rbHistogram );
+  rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "errors" ) ), UINT2NUM( m_errors ) );
+  rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "last_error" ) ),
+                m_lastError.empty() ? Qnil : rb_str_new2( m_lastError.c_str() ) );
+  return rbRetVal;
+}
@@ -0,0 +1,78 @@
+/* HornetsEye - Computer Vision with Ruby
+ Copyright (C) 2006, 2007, 2008, 2009, 2010 Jan Wedekind
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef HORNETSEYE_DC1394EXPOSURE_HH
+#define HORNETSEYE_DC1394EXPOSURE_HH
+
+#include <string>
+#include <vector>
+#include <dc1394/dc1394.h>
+#include "rubyinc.hh"
+#include "error.hh"
+
+// Automatic exposure control driven by a subsampled luminance histogram of
+// each frame. The shutter is preferred over the gain to keep noise low.
+class DC1394Exposure
+{
+public:
+  static const int NUM_BINS = 256;
+  struct Config
+  {
+    // Desired mean luminance and the deviation tolerated without a change.
+    double target;
+    double tolerance;
+    // Fraction of the correction withheld in each step (0 for none).
+    double damping;
+    // Only every step-th pixel of every step-th row is sampled.
+    int step;
+    // Region of interest (whole frame if width or height is zero).
+    unsigned int left;
+    unsigned int top;
+    unsigned int width;
+    unsigned int height;
+    uint32_t shutterMin;
+    uint32_t shutterMax;
+    uint32_t gainMin;
+    uint32_t gainMax;
+    // Gain units doubling the brightness.
+    double gainPerStop;
+  };
+  DC1394Exposure( const Config &config, uint32_t shutter, uint32_t gain );
+  const Config &config(void) const { return m_config; }
+  static Config config( VALUE rbOptions, const dc1394feature_info_t &shutter,
+                        const dc1394feature_info_t &gain ) throw (Error);
+  static bool supported( dc1394color_coding_t coding );
+  double measure( const dc1394video_frame_t *frame, dc1394color_coding_t coding,
+                  unsigned int width, unsigned int height );
+  bool control( double mean );
+  double mean(void) const { return m_mean; }
+  uint32_t shutter(void) const { return m_shutter; }
+  uint32_t gain(void) const { return m_gain; }
+  const uint32_t *histogram(void) const { return m_histogram; }
+  void failed( const std::string &message );
+  VALUE toRuby(void) const;
+protected:
+  Config m_config;
+  uint32_t m_shutter;
+  uint32_t m_gain;
+  double m_mean;
+  // Number of corrections which could not be submitted and the last error.
+  unsigned int m_errors;
+  std::string m_lastError;
+  uint32_t m_histogram[ NUM_BINS ];
+  std::vector< uint8_t > m_row;
+};
+
+#endif
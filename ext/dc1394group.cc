@@ -0,0 +1,343 @@
+/* HornetsEye - Computer Vision with Ruby
+ Copyright (C) 2006, 2007, 2008, 2009, 2010 Jan Wedekind
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include <cstring>
+#include <unistd.h>
+#include "rubytools.hh"
+#include "dc1394group.hh"
+#include "dc1394lease.hh"
+#include "pipe.hh"
+
+using namespace boost;
+using namespace std;
+
+// Marks the wakeup pipe in the epoll set.
+#define WAKEUP_INDEX 0xFFFFFFFFU
+
+VALUE DC1394Group::cRubyClass = Qnil;
+
+DC1394Group::DC1394Group(void) throw (Error):
+  m_epoll( -1 ), m_timeout( -1 ), m_numEvents( 0 ), m_waitError( 0 ),
+  m_interrupted( false )
+{
+  m_wakeup[0] = m_wakeup[1] = -1;
+  try {
+    m_epoll = epoll_create( 1 );
+    ERRORMACRO( m_epoll != -1, Error, , "Error creating epoll instance: "
+                << strerror( errno ) );
+    openPipe( m_wakeup );
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.u32 = WAKEUP_INDEX;
+    ERRORMACRO( epoll_ctl( m_epoll, EPOLL_CTL_ADD, m_wakeup[0], &event ) == 0,
+                Error, , "Error adding wakeup pipe to epoll set: "
+                << strerror( errno ) );
+  } catch ( Error &e ) {
+    close();
+    throw e;
+  };
+}
+
+DC1394Group::~DC1394Group(void)
+{
+  close();
+}
+
+void DC1394Group::close(void)
+{
+  if ( m_epoll != -1 ) {
+    ::close( m_epoll );
+    m_epoll = -1;
+  };
+  closePipe( m_wakeup );
+  m_inputs.clear();
+  m_fds.clear();
+  m_pending.clear();
+  m_dc1394.reset();
+}
+
+bool DC1394Group::status(void) const
+{
+  return m_epoll != -1;
+}
+
+string DC1394Group::inspect(void) const
+{
+  ostringstream s;
+  s << "DC1394Group( " << m_inputs.size() << " )";
+  return s.str();
+}
+
+void DC1394Group::add( DC1394InputPtr input ) throw (Error)
+{
+  ERRORMACRO( m_epoll != -1, Error, , "Camera group is closed. Did you call "
+              "\"close\" before?" );
+  ERRORMACRO( input->status(), Error, , "Camera device not open any more. Did you "
+              "call \"close\" before?" );
+  if ( m_inputs.empty() )
+    m_dc1394 = input->dc1394();
+  else {
+    ERRORMACRO( input->dc1394() == m_dc1394, Error, , "All cameras of a group must "
+                "share the same DC1394 handle" );
+  };
+  m_inputs.push_back( input );
+  m_fds.push_back( -1 );
+  m_events.resize( m_inputs.size() + 1 );
+}
+
+void DC1394Group::update(void) throw (Error)
+{
+  // The file descriptor changes when a camera switches to background capture.
+  for ( unsigned int i=0; i<m_inputs.size(); i++ ) {
+    int fd = m_inputs[i]->fileno();
+    if ( fd != m_fds[i] ) {
+      if ( m_fds[i] != -1 )
+        epoll_ctl( m_epoll, EPOLL_CTL_DEL, m_fds[i], NULL );
+      struct epoll_event event;
+      event.events = EPOLLIN;
+      event.data.u32 = i;
+      ERRORMACRO( epoll_ctl( m_epoll, EPOLL_CTL_ADD, fd, &event ) == 0, Error, ,
+                  "Error adding camera to epoll set: " << strerror( errno ) );
+      m_fds[i] = fd;
+    };
+  };
+}
+
+int DC1394Group::read( int timeout, FramePtr &frame ) throw (Error)
+{
+  ERRORMACRO( m_epoll != -1, Error, , "Camera group is closed. Did you call "
+              "\"close\" before?" );
+  ERRORMACRO( !m_inputs.empty(), Error, , "Camera group is empty" );
+  while ( true ) {
+    while ( !m_pending.empty() ) {
+      unsigned int index = m_pending.front();
+      m_pending.pop_front();
+      frame = m_inputs[ index ]->tryRead();
+      if ( frame.get() != NULL ) return index;
+    };
+    update();
+    int n = wait( timeout );
+    if ( m_interrupted ) return INTERRUPTED;
+    if ( n == 0 ) return TIMEOUT;
+    for ( int i=0; i<n; i++ )
+      if ( m_events[i].data.u32 != WAKEUP_INDEX )
+        m_pending.push_back( m_events[i].data.u32 );
+  };
+}
+
+bool DC1394Group::readSet( uint64_t tolerance, VALUE rbFrames ) throw (Error)
+{
+  ERRORMACRO( m_epoll != -1, Error, , "Camera group is closed. Did you call "
+              "\"close\" before?" );
+  ERRORMACRO( !m_inputs.empty(), Error, , "Camera group is empty" );
+  unsigned int n = m_inputs.size();
+  // The Ruby array keeps the frames alive while the set is being collected.
+  vector< FramePtr > frames( n );
+  vector< uint64_t > timestamps( n );
+  unsigned int received = 0, replaced = 0;
+  try {
+    while ( true ) {
+      // Whichever camera is ready first is served first.
+      FramePtr frame;
+      int index = read( -1, frame );
+      if ( index == INTERRUPTED ) {
+        releaseSet( frames );
+        return false;
+      };
+      if ( index < 0 ) continue;
+      if ( frames[ index ].get() != NULL ) {
+        // Replace the older frame of a camera delivering again.
+        DC1394Lease::release( frames[ index ] );
+        replaced++;
+      } else
+        received++;
+      frames[ index ] = frame;
+      timestamps[ index ] = m_inputs[ index ]->timestamp();
+      rb_ary_store( rbFrames, index, frame->rubyObject() );
+      if ( received == n ) {
+        uint64_t oldest = timestamps[0], newest = timestamps[0];
+        for ( unsigned int i=1; i<n; i++ ) {
+          if ( timestamps[i] < oldest ) oldest = timestamps[i];
+          if ( timestamps[i] > newest ) newest = timestamps[i];
+        };
+        if ( newest - oldest <= tolerance ) return true;
+      };
+      ERRORMACRO( replaced < 16 * n, Error, , "Could not find a set of frames "
+                  "with timestamps differing by at most " << tolerance
+                  << " microseconds" );
+    };
+  } catch ( Error &e ) {
+    releaseSet( frames );
+    throw e;
+  };
+}
+
+void DC1394Group::releaseSet( vector< FramePtr > &frames )
+{
+  for ( unsigned int i=0; i<frames.size(); i++ )
+    if ( frames[i].get() != NULL ) DC1394Lease::release( frames[i] );
+}
+
+int DC1394Group::wait( int timeout ) throw (Error)
+{
+  // Drop stale wakeup requests before blocking.
+  drainPipe( m_wakeup[0] );
+  m_timeout = timeout;
+  m_numEvents = 0;
+  m_waitError = 0;
+  m_interrupted = false;
+  rb_thread_call_without_gvl( waitWithoutGVL, this, interruptWait, this );
+  ERRORMACRO( m_waitError == 0, Error, , "Error waiting for frames: "
+              << strerror( m_waitError ) );
+  // Interrupts are handled by the Ruby wrapper once the C++ stack has unwound.
+  return m_numEvents;
+}
+
+void *DC1394Group::waitWithoutGVL( void *ptr )
+{
+  DC1394Group *self = (DC1394Group *)ptr;
+  int n = epoll_wait( self->m_epoll, &self->m_events[0], self->m_events.size(),
+                      self->m_timeout );
+  if ( n < 0 ) {
+    // A negative number of events tells the caller to retry.
+    if ( errno != EINTR ) self->m_waitError = errno;
+    self->m_numEvents = -1;
+  } else
+    self->m_numEvents = n;
+  return NULL;
+}
+
+void DC1394Group::interruptWait( void *ptr )
+{
+  DC1394Group *self = (DC1394Group *)ptr;
+  self->m_interrupted = true;
+  signalPipe( self->m_wakeup[1] );
+}
+
+VALUE DC1394Group::registerRubyClass( VALUE module )
+{
+  cRubyClass = rb_define_class_under( module, "DC1394Group", rb_cObject );
+  rb_define_singleton_method( cRubyClass, "new", RUBY_METHOD_FUNC( wrapNew ), 0 );
+  rb_define_method( cRubyClass, "close", RUBY_METHOD_FUNC( wrapClose ), 0 );
+  rb_define_method( cRubyClass, "status?", RUBY_METHOD_FUNC( wrapStatus ), 0 );
+  rb_define_method( cRubyClass, "add", RUBY_METHOD_FUNC( wrapAdd ), 1 );
+  rb_define_method( cRubyClass, "size", RUBY_METHOD_FUNC( wrapSize ), 0 );
+  rb_define_method( cRubyClass, "read", RUBY_METHOD_FUNC( wrapRead ), 1 );
+  rb_define_method( cRubyClass, "read_set", RUBY_METHOD_FUNC( wrapReadSet ), 1 );
+  return cRubyClass;
+}
+
+void DC1394Group::deleteRubyObject( void *ptr )
+{
+  DC1394GroupPtr *self = (DC1394GroupPtr *)ptr;
+  if ( DC1394Input::postpone() )
+    for ( std::vector< DC1394InputPtr >::iterator i = (*self)->m_inputs.begin();
+          i != (*self)->m_inputs.end(); i++ )
+      DC1394Input::defer( *i );
+  delete self;
+}
+
+VALUE DC1394Group::wrapNew( VALUE rbClass )
+{
+  VALUE rbRetVal = Qnil;
+  try {
+    DC1394GroupPtr ptr( new DC1394Group );
+    rbRetVal = Data_Wrap_Struct( rbClass, 0, deleteRubyObject,
+                                 new DC1394GroupPtr( ptr ) );
+  } catch ( std::exception &e ) {
+    rb_raise( rb_eRuntimeError, "%s", e.what() );
+  };
+  return rbRetVal;
+}
+
+VALUE DC1394Group::wrapClose( VALUE rbSelf )
+{
+  DC1394GroupPtr *self; Data_Get_Struct( rbSelf, DC1394GroupPtr, self );
+  (*self)->close();
+  return rbSelf;
+}
+
+VALUE DC1394Group::wrapStatus( VALUE rbSelf )
+{
+  DC1394GroupPtr *self; Data_Get_Struct( rbSelf, DC1394GroupPtr, self );
+  return (*self)->status() ? Qtrue : Qfalse;
+}
+
+VALUE DC1394Group::wrapAdd( VALUE rbSelf, VALUE rbInput )
+{
+  try {
+    DC1394GroupPtr *self; Data_Get_Struct( rbSelf, DC1394GroupPtr, self );
+    DC1394InputPtr *input;
+    dataGetStruct( rbInput, DC1394Input::cRubyClass, DC1394InputPtr, input );
+    (*self)->add( *input );
+  } catch ( std::exception &e ) {
+    rb_raise( rb_eRuntimeError, "%s", e.what() );
+  };
+  return rbSelf;
+}
+
+VALUE DC1394Group::wrapSize( VALUE rbSelf )
+{
+  DC1394GroupPtr *self; Data_Get_Struct( rbSelf, DC1394GroupPtr, self );
+  return UINT2NUM( (*self)->size() );
+}
+
+VALUE DC1394Group::wrapRead( VALUE rbSelf, VALUE rbTimeout )
+{
+  VALUE rbRetVal = Qnil;
+  int limit = NUM2INT( rbTimeout ), timeout = limit;
+  uint64_t start = DC1394Stats::now();
+  while ( true ) {
+    int index = TIMEOUT;
+    try {
+      DC1394GroupPtr *self; Data_Get_Struct( rbSelf, DC1394GroupPtr, self );
+      FramePtr frame;
+      index = (*self)->read( timeout, frame );
+      if ( index >= 0 )
+        rbRetVal = rb_ary_new3( 2, INT2NUM( index ), frame->rubyObject() );
+    } catch ( std::exception &e ) {
+      rb_raise( rb_eRuntimeError, "%s", e.what() );
+    };
+    if ( index != INTERRUPTED ) break;
+    // Raises an exception if the thread was killed or interrupted. Otherwise
+    // waiting is resumed with the remaining time.
+    rb_thread_check_ints();
+    if ( timeout > 0 ) {
+      int elapsed = ( DC1394Stats::now() - start ) / 1000;
+      timeout = elapsed < limit ? limit - elapsed : 0;
+    };
+  };
+  return rbRetVal;
+}
+
+VALUE DC1394Group::wrapReadSet( VALUE rbSelf, VALUE rbTolerance )
+{
+  VALUE rbRetVal = Qnil;
+  while ( rbRetVal == Qnil ) {
+    VALUE rbFrames = rb_ary_new();
+    try {
+      DC1394GroupPtr *self; Data_Get_Struct( rbSelf, DC1394GroupPtr, self );
+      if ( (*self)->readSet( NUM2ULL( rbTolerance ), rbFrames ) )
+        rbRetVal = rbFrames;
+    } catch ( std::exception &e ) {
+      rb_raise( rb_eRuntimeError, "%s", e.what() );
+    };
+    RB_GC_GUARD( rbFrames );
+    // Raises an exception if the thread was killed or interrupted. Otherwise
+    // reading is resumed.
+    if ( rbRetVal == Qnil ) rb_thread_check_ints();
+  };
+  return rbRetVal;
+}
@@ -0,0 +1,74 @@
+/* HornetsEye - Computer Vision with Ruby
+   Copyright (C) 2006, 2007, 2008, 2009, 2010 Jan Wedekind
+   
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef HORNETSEYE_DC1394GROUP_HH
+#define HORNETSEYE_DC1394GROUP_HH
+
+#include <deque>
+#include <vector>
+#include <sys/epoll.h>
+#include <boost/atomic.hpp>
+#include "error.hh"
+#include "dc1394.hh"
+#include "dc1394input.hh"
+#include "frame.hh"
+
+class DC1394Group
+{
+public:
+  DC1394Group(void) throw (Error);
+  virtual ~DC1394Group(void);
+  void close(void);
+  bool status(void) const;
+  std::string inspect(void) const;
+  void add( DC1394InputPtr input ) throw (Error);
+  unsigned int size(void) const { return m_inputs.size(); }
+  // Status values returned by read instead of a camera index.
+  enum { TIMEOUT = -1, INTERRUPTED = -2 };
+  int read( int timeout, FramePtr &frame ) throw (Error);
+  bool readSet( uint64_t tolerance, VALUE rbFrames ) throw (Error);
+  static VALUE cRubyClass;
+  static VALUE registerRubyClass( VALUE module );
+  static void deleteRubyObject( void *ptr );
+  static VALUE wrapNew( VALUE rbClass );
+  static VALUE wrapClose( VALUE rbSelf );
+  static VALUE wrapStatus( VALUE rbSelf );
+  static VALUE wrapAdd( VALUE rbSelf, VALUE rbInput );
+  static VALUE wrapSize( VALUE rbSelf );
+  static VALUE wrapRead( VALUE rbSelf, VALUE rbTimeout );
+  static VALUE wrapReadSet( VALUE rbSelf, VALUE rbTolerance );
+protected:
+  void update(void) throw (Error);
+  int wait( int timeout ) throw (Error);
+  static void *waitWithoutGVL( void *ptr );
+  static void interruptWait( void *ptr );
+  static void releaseSet( std::vector< FramePtr > &frames );
+  DC1394Ptr m_dc1394;
+  std::vector< DC1394InputPtr > m_inputs;
+  std::vector< int > m_fds;
+  std::deque< unsigned int > m_pending;
+  std::vector< struct epoll_event > m_events;
+  int m_epoll;
+  int m_wakeup[2];
+  int m_timeout;
+  int m_numEvents;
+  int m_waitError;
+  boost::atomic< bool > m_interrupted;
+};
+
+typedef boost::shared_ptr< DC1394Group > DC1394GroupPtr;
+
+#endif
+
@@ -17,143 +17,777 @@
 #include <iostream>
 #endif
 #include <iomanip>
+#include <algorithm>
+#include <cstring>
+#include <poll.h>
+#include <unistd.h>
 #include "rubytools.hh"
 #include "dc1394input.hh"
+#include "dc1394lease.hh"
+#include "dc1394plan.hh"
+#include "dc1394pool.hh"
+#include "dc1394unpack.hh"
+#include "pipe.hh"
 
 using namespace boost;
 using namespace std;
 
+// Minimum number of bytes swapped or copied by one thread of the pool.
+static const int STRIPE_BYTES = 1 << 18;
+
+struct DC1394Copy
+{
+  const uint8_t *src;
+  uint8_t *dst;
+};
+
 VALUE DC1394Input::cRubyClass = Qnil;
 
-DC1394Input::DC1394Input( DC1394Ptr dc1394, unsigned int node, dc1394speed_t speed,
-                          DC1394SelectPtr select, bool forceFrameRate,
-                          dc1394framerate_t frameRate )
+std::vector< DC1394InputPtr > DC1394Input::deferred;
+
+bool DC1394Input::exiting = false;
+
+DC1394Input::DC1394Input( DC1394Ptr dc1394, uint64_t guid, int unit,
+                          dc1394speed_t speed, DC1394SelectPtr select, bool forceFrameRate,
+                          dc1394framerate_t frameRate, unsigned int numBuffers,
+                          uint32_t flags )
   throw (Error):
-  m_dc1394( dc1394 ), m_node( node ), m_camera( NULL ), m_frame( NULL )
+  m_dc1394( dc1394 ), m_backend( dc1394->backend() ), m_guid( guid ), m_unit( unit ),
+  m_camera( NULL ), m_detached( NULL ),
+  m_keepPowered( false ), m_speed( DC1394_ISO_SPEED_400 ),
+  m_operationMode( DC1394_OPERATION_MODE_LEGACY ),
+  m_videoMode( DC1394_VIDEO_MODE_MIN ), m_flags( flags ), m_rbTypecode( Qnil ),
+  m_storageSize( 0 ), m_numBuffers( numBuffers ),
+  m_frameBytes( 0 ), m_coding( DC1394_COLOR_CODING_MONO8 ), m_spareBuffers( 1 ),
+  m_leased( 0 ), m_queued( 0 ), m_triggered( false ), m_triggerCount( 0 ),
+  m_waitFd( -1 ), m_waitError( 0 ), m_interrupted( false ),
+  m_async( false ), m_order( READ_NEWEST ),
+  m_quit( false ), m_captureError( DC1394_SUCCESS ), m_featuresValid( false ),
+  m_exposureCommand( 0 )
 {
-  dc1394camera_list_t *list = NULL;
+  memset( &m_info, 0, sizeof(m_info) );
+  pthread_mutex_init( &m_bus, NULL );
+  m_wakeup[0] = m_wakeup[1] = -1;
+  m_notify[0] = m_notify[1] = -1;
+  m_resume[0] = m_resume[1] = -1;
   try {
-    dc1394error_t err;
-    err = dc1394_camera_enumerate( dc1394->get(), &list );
-    ERRORMACRO( err == DC1394_SUCCESS, Error, , "Failed to enumerate cameras: "
-                << dc1394_error_get_string( err ) );
-    ERRORMACRO( list->num > 0, Error, , "Could not find a single digital camera on "
-                "the firewire bus. Please check, whether the kernel modules "
-                "'ieee1394','raw1394' and 'ohci1394' are loaded and whether you "
-                "have read/write permission on \"/dev/raw1394\". Also make sure "
-                "that the camera is connected and powered up." );
-    ERRORMACRO( node < list->num, Error, ,
-                "Camera node number " << node << " out of range. The range is "
-                "[ 0; " << list->num << " )" );
-    m_camera = dc1394_camera_new( dc1394->get(), list->ids[ node ].guid );
-    dc1394_camera_free_list( list ); list = NULL;
-    ERRORMACRO( m_camera != NULL, Error, , "Failed to initialise camera node "
-               << node << " (guid 0x" << setbase( 16 ) << list->ids[ node ].guid
-               << setbase( 10 ) << ")" );
-    dc1394video_modes_t videoModes;
-    err = dc1394_video_get_supported_modes( m_camera, &videoModes );
-    for ( unsigned int i=0; i<videoModes.num; i++ ) {
-      dc1394video_mode_t videoMode = videoModes.modes[i];
-      dc1394color_coding_t coding;
-      dc1394_get_color_coding_from_video_mode( m_camera, videoMode, &coding );
-      unsigned int width, height;
-      dc1394_get_image_size_from_video_mode( m_camera, videoMode, &width, &height );
-      select->add( coding, width, height );
-    };
+    ERRORMACRO( numBuffers > 0, Error, , "Number of DMA buffers must be at least 1" );
+    ERRORMACRO( ( flags & ~( DC1394_CAPTURE_FLAGS_CHANNEL_ALLOC |
+                             DC1394_CAPTURE_FLAGS_BANDWIDTH_ALLOC |
+                             DC1394_CAPTURE_FLAGS_DEFAULT |
+                             DC1394_CAPTURE_FLAGS_AUTO_ISO ) ) == 0, Error, ,
+                "Unknown capture flags 0x" << setbase( 16 ) << flags
+                << setbase( 10 ) );
+    openPipe( m_wakeup );
+    openPipe( m_notify );
+    openPipe( m_resume );
+    m_camera = dc1394->openCamera( guid, unit );
+    m_unit = m_camera->unit;
+    // The mode table is taken from the cached camera list if possible.
+    DC1394::Camera info( dc1394->info( m_camera ) );
+    select->addModes( *m_backend, m_camera, info );
     unsigned int selection = select->make();
-    ERRORMACRO( selection < videoModes.num, Error, ,
+    ERRORMACRO( selection < info.modes.size(), Error, ,
                 "Index of selected video mode out of range" );
-    dc1394video_mode_t videoMode = videoModes.modes[ selection ];
-    err = dc1394_video_set_iso_speed( m_camera, speed );
-    ERRORMACRO( err == DC1394_SUCCESS, Error, , "Error setting iso speed: "
-                << dc1394_error_get_string( err ) );
-    err = dc1394_video_set_mode( m_camera, videoMode );
+    const DC1394::Mode &mode = info.modes[ selection ];
+    dc1394video_mode_t videoMode = mode.mode;
+    dc1394error_t err;
+    negotiateSpeed( speed );
+    err = m_backend->videoSetMode( m_camera, videoMode );
     ERRORMACRO( err == DC1394_SUCCESS, Error, , "Failure setting video mode: "
                 << dc1394_error_get_string( err ) );
-    dc1394color_coding_t coding;
-    dc1394_get_color_coding_from_video_mode( m_camera, videoMode, &coding );
-    switch ( coding ) {
-    case DC1394_COLOR_CODING_MONO8:
-      m_typecode = "UBYTE";
-      break;
-    case DC1394_COLOR_CODING_YUV422:
-      m_typecode = "UYVY";
-      break;
-    case DC1394_COLOR_CODING_RGB8:
-      m_typecode = "UBYTERGB";
-      break;
-    case DC1394_COLOR_CODING_MONO16:
-      m_typecode = "USINT";
-      break;
-    default:
-      ERRORMACRO( false, Error, , "Conversion for DC1394 colorspace " << coding
-                  << " not implemented yet" );
-    };
-    dc1394_get_image_size_from_video_mode( m_camera, videoMode, &m_width, &m_height );
+    m_videoMode = videoMode;
     if ( dc1394_is_video_mode_scalable( videoMode ) ) {
       ERRORMACRO( !forceFrameRate, Error, , "Cannot set framerate in format6 or "
                   "format7 mode" );
+      if ( select->policy().packetSize > 0 ) {
+        err = m_backend->format7SetPacketSize( m_camera, videoMode,
+                                               select->policy().packetSize );
+        ERRORMACRO( err == DC1394_SUCCESS, Error, , "Error setting packet size: "
+                    << dc1394_error_get_string( err ) );
+      };
     } else {
       if ( forceFrameRate ) {
-        err = dc1394_video_set_framerate( m_camera, frameRate );
+        err = m_backend->videoSetFramerate( m_camera, frameRate );
         ERRORMACRO( err == DC1394_SUCCESS, Error, , "Error setting framerate: "
                     << dc1394_error_get_string( err ) );
       } else {
-        dc1394framerates_t frameRates;
-        err = dc1394_video_get_supported_framerates( m_camera, videoMode, &frameRates );
-        ERRORMACRO( err == DC1394_SUCCESS, Error, , "Error querying supported frame "
-                    "rates: " << dc1394_error_get_string( err ) );
-        err = dc1394_video_set_framerate( m_camera,
-                                          frameRates.framerates[ frameRates.num - 1 ] );
+        ERRORMACRO( !mode.frameRates.empty(), Error, , "Error querying supported "
+                    "frame rates" );
+        // Use the frame rate chosen by the selection policy or the fastest one.
+        int index = select->frameRate();
+        err = m_backend->videoSetFramerate( m_camera, index >= 0 ?
+                                            mode.frameRates[ index ] :
+                                            mode.frameRates.back() );
         ERRORMACRO( err == DC1394_SUCCESS, Error, , "Error setting framerate: "
                     << dc1394_error_get_string( err ) );
       };
     };
-    err = dc1394_capture_setup( m_camera, 4, DC1394_CAPTURE_FLAGS_DEFAULT );
-    ERRORMACRO( err == DC1394_SUCCESS, Error, , "Could not setup camera (video mode "
-                "and framerate not supported?): "
-                << dc1394_error_get_string( err ) );
-    err = dc1394_video_set_transmission( m_camera, DC1394_ON );
-    ERRORMACRO( err == DC1394_SUCCESS, Error, , "Could not start camera iso "
-                "transmission: " << dc1394_error_get_string( err ) );
+    try {
+      setupCapture();
+    } catch ( Error & ) {
+      // The host adapter or cabling might not support 1394b after all.
+      if ( m_speed <= DC1394_ISO_SPEED_400 ) throw;
+      m_dc1394->stopped( m_camera );
+      m_backend->captureStop( m_camera );
+      negotiateSpeed( DC1394_ISO_SPEED_400 );
+      setupCapture();
+    };
   } catch ( Error &e ) {
-    if ( list != NULL ) dc1394_camera_free_list( list );
     close();
     throw e;
   };
 }
 
+void DC1394Input::negotiateSpeed( dc1394speed_t speed ) throw (Error)
+{
+  ERRORMACRO( speed >= DC1394_ISO_SPEED_MIN && speed <= DC1394_ISO_SPEED_MAX, Error, ,
+              "Unknown iso speed " << speed );
+  dc1394error_t err;
+  bool done = false;
+  if ( speed > DC1394_ISO_SPEED_400 && m_camera->bmode_capable != DC1394_FALSE &&
+       m_backend->videoSetOperationMode( m_camera, DC1394_OPERATION_MODE_1394B ) ==
+       DC1394_SUCCESS ) {
+    // Try slower 1394b speeds if the requested one is not supported.
+    for ( int s=speed; s>DC1394_ISO_SPEED_400 && !done; s-- )
+      done = m_backend->videoSetIsoSpeed( m_camera, (dc1394speed_t)s ) ==
+        DC1394_SUCCESS;
+  };
+  if ( !done ) {
+    // Speeds above 400 Mb/s are not available in legacy mode.
+    dc1394operation_mode_t mode;
+    if ( m_backend->videoGetOperationMode( m_camera, &mode ) == DC1394_SUCCESS &&
+         mode != DC1394_OPERATION_MODE_LEGACY )
+      m_backend->videoSetOperationMode( m_camera, DC1394_OPERATION_MODE_LEGACY );
+    err = m_backend->videoSetIsoSpeed( m_camera, min( speed, DC1394_ISO_SPEED_400 ) );
+    ERRORMACRO( err == DC1394_SUCCESS, Error, , "Error setting iso speed: "
+                << dc1394_error_get_string( err ) );
+  };
+  err = m_backend->videoGetIsoSpeed( m_camera, &m_speed );
+  ERRORMACRO( err == DC1394_SUCCESS, Error, , "Error querying iso speed: "
+              << dc1394_error_get_string( err ) );
+  err = m_backend->videoGetOperationMode( m_camera, &m_operationMode );
+  ERRORMACRO( err == DC1394_SUCCESS, Error, , "Error querying operation mode: "
+              << dc1394_error_get_string( err ) );
+}
+
+void DC1394Input::setupCapture(void) throw (Error)
+{
+  dc1394error_t err;
+  dc1394color_coding_t coding;
+  m_backend->getColorCodingFromVideoMode( m_camera, m_videoMode, &coding );
+  m_coding = coding;
+  m_backend->getImageSizeFromVideoMode( m_camera, m_videoMode, &m_width, &m_height );
+  string previous = m_typecode;
+  m_convert.setSource( coding, m_width, m_height );
+  // Keep the typecode selected with "output=" if the new mode supports it.
+  if ( !previous.empty() ) {
+    try {
+      m_convert.setTypecode( previous );
+    } catch ( Error & ) {
+    };
+  };
+  m_typecode = m_convert.typecode();
+  if ( raw() ) {
+    // Only format7 modes report the Bayer pattern of the sensor.
+    dc1394color_filter_t pattern;
+    if ( dc1394_is_video_mode_scalable( m_videoMode ) &&
+         m_backend->format7GetColorFilter( m_camera, m_videoMode, &pattern ) ==
+         DC1394_SUCCESS )
+      m_convert.setBayerPattern( pattern );
+  };
+  m_rbTypecode = Frame::rubyTypecode( m_typecode );
+  m_storageSize = Frame::storageSize( m_rbTypecode, m_width, m_height );
+  if ( dc1394_is_video_mode_scalable( m_videoMode ) ) {
+    uint64_t totalBytes;
+    err = m_backend->format7GetTotalBytes( m_camera, m_videoMode, &totalBytes );
+    ERRORMACRO( err == DC1394_SUCCESS, Error, , "Error querying frame size: "
+                << dc1394_error_get_string( err ) );
+    m_frameBytes = totalBytes;
+  } else {
+    uint32_t bits;
+    err = dc1394_get_color_coding_bit_size( coding, &bits );
+    ERRORMACRO( err == DC1394_SUCCESS, Error, , "Error querying bits per pixel: "
+                << dc1394_error_get_string( err ) );
+    m_frameBytes = (size_t)m_width * m_height * bits / 8;
+  };
+  uint64_t physBytes = (uint64_t)sysconf( _SC_PHYS_PAGES ) * sysconf( _SC_PAGESIZE );
+  ERRORMACRO( (uint64_t)m_frameBytes * m_numBuffers < physBytes, Error, ,
+              m_numBuffers << " DMA buffers of " << m_frameBytes << " bytes each "
+              "exceed the physical memory of " << physBytes << " bytes" );
+  if ( dc1394_is_video_mode_scalable( m_videoMode ) ) {
+    float interval;
+    if ( m_backend->format7GetFrameInterval( m_camera, m_videoMode, &interval ) ==
+         DC1394_SUCCESS )
+      m_stats.setFramePeriod( (uint64_t)( interval * 1e6 ) );
+  } else {
+    dc1394framerate_t rate;
+    float fps;
+    if ( m_backend->videoGetFramerate( m_camera, &rate ) == DC1394_SUCCESS &&
+         dc1394_framerate_as_float( rate, &fps ) == DC1394_SUCCESS && fps > 0 )
+      m_stats.setFramePeriod( (uint64_t)( 1e6 / fps ) );
+  };
+  err = m_backend->captureSetup( m_camera, m_numBuffers, m_flags );
+  if ( err != DC1394_SUCCESS ) {
+    // A common cause is other cameras using up the bandwidth of the bus.
+    uint32_t units = 0;
+    m_backend->videoGetBandwidthUsage( m_camera, &units );
+    ERRORMACRO( false, Error, , "Could not setup camera with " << m_numBuffers
+                << " DMA buffers of " << m_frameBytes << " bytes (video mode and "
+                "framerate not supported?): " << dc1394_error_get_string( err )
+                << ". The camera requires " << units << " of "
+                << DC1394Plan::BUS_BANDWIDTH << " isochronous bandwidth units. Use "
+                "\"DC1394Input.plan\" to share the bus with other cameras" );
+  };
+  // Bandwidth used by running cameras is not available to "DC1394Input.plan".
+  uint32_t units;
+  if ( m_backend->videoGetBandwidthUsage( m_camera, &units ) == DC1394_SUCCESS )
+    m_dc1394->started( m_camera, units );
+  err = m_backend->videoSetTransmission( m_camera, DC1394_ON );
+  ERRORMACRO( err == DC1394_SUCCESS, Error, , "Could not start camera iso "
+              "transmission: " << dc1394_error_get_string( err ) );
+}
+
+void DC1394Input::format7Write( dc1394color_coding_t coding, int packetSize,
+                                unsigned int left, unsigned int top,
+                                unsigned int width, unsigned int height )
+  throw (Error)
+{
+  ERRORMACRO( m_camera != NULL, Error, , "Camera device not open any more. Did you "
+              "call \"close\" before?" );
+  ERRORMACRO( dc1394_is_video_mode_scalable( m_videoMode ), Error, , "Region of "
+              "interest and packet size can only be set in format7 mode" );
+  ERRORMACRO( m_leased == 0, Error, , "Cannot change format7 settings while "
+              << m_leased << " video frames hold DMA buffers. Release them first" );
+  Format7Info info( format7Read() );
+  ERRORMACRO( width > 0 && height > 0 && width % info.unitWidth == 0 &&
+              height % info.unitHeight == 0, Error, , "Size of region of interest "
+              "must be a positive multiple of " << info.unitWidth << 'x'
+              << info.unitHeight << " (but was " << width << 'x' << height << ")" );
+  ERRORMACRO( left % info.unitLeft == 0 && top % info.unitTop == 0, Error, ,
+              "Position of region of interest must be a multiple of "
+              << info.unitLeft << 'x' << info.unitTop << " (but was " << left
+              << 'x' << top << ")" );
+  ERRORMACRO( left + width <= info.maxWidth && top + height <= info.maxHeight,
+              Error, , "Region of interest (" << left << ", " << top << ", "
+              << width << ", " << height << ") exceeds maximum image size of "
+              << info.maxWidth << 'x' << info.maxHeight );
+  ERRORMACRO( find( info.codings.begin(), info.codings.end(), coding ) !=
+              info.codings.end(), Error, , "DC1394 colorspace " << coding
+              << " is not supported in this format7 mode" );
+  if ( packetSize > 0 ) {
+    ERRORMACRO( packetSize % info.unitBytes == 0 &&
+                (unsigned int)packetSize <= info.maxBytes, Error, , "Packet size "
+                "must be a multiple of " << info.unitBytes << " not exceeding "
+                << info.maxBytes << " (but was " << packetSize << ")" );
+  } else
+    packetSize = DC1394_USE_RECOMMENDED;
+  // The DMA buffers have to be reallocated for the new frame size.
+  bool async = m_async;
+  ReadOrder order = m_order;
+  asyncStop();
+  try {
+    format7Apply( coding, packetSize, left, top, width, height );
+  } catch ( Error &e ) {
+    // Capture resumes with the previous settings if the new ones were rejected.
+    try {
+      format7Apply( info.coding, info.packetSize, info.left, info.top, info.width,
+                    info.height );
+    } catch ( Error &f ) {
+      ERRORMACRO( false, Error, , e.what() << ". Restoring the previous format7 "
+                  "settings failed as well: " << f.what() );
+    };
+    if ( async ) asyncStart( order );
+    throw e;
+  };
+  if ( async ) asyncStart( order );
+}
+
+void DC1394Input::format7Apply( dc1394color_coding_t coding, int packetSize,
+                                unsigned int left, unsigned int top,
+                                unsigned int width, unsigned int height )
+  throw (Error)
+{
+  DC1394BusLock lock( &m_bus );
+  m_backend->videoSetTransmission( m_camera, DC1394_OFF );
+  m_dc1394->stopped( m_camera );
+  m_backend->captureStop( m_camera );
+  dc1394error_t err = m_backend->format7SetRoi( m_camera, m_videoMode, coding,
+                                                packetSize, left, top, width, height );
+  ERRORMACRO( err == DC1394_SUCCESS, Error, , "Error setting format7 region of "
+              "interest: " << dc1394_error_get_string( err ) );
+  setupCapture();
+}
+
+DC1394Input::Format7Info DC1394Input::format7Read(void) throw (Error)
+{
+  ERRORMACRO( m_camera != NULL, Error, , "Camera device not open any more. Did you "
+              "call \"close\" before?" );
+  ERRORMACRO( dc1394_is_video_mode_scalable( m_videoMode ), Error, , "Camera is "
+              "not in format7 mode" );
+  DC1394BusLock lock( &m_bus );
+  Format7Info retVal;
+  dc1394error_t err;
+  err = m_backend->format7GetMaxImageSize( m_camera, m_videoMode, &retVal.maxWidth,
+                                            &retVal.maxHeight );
+  ERRORMACRO( err == DC1394_SUCCESS, Error, , "Error querying maximum image size: "
+              << dc1394_error_get_string( err ) );
+  err = m_backend->format7GetUnitSize( m_camera, m_videoMode, &retVal.unitWidth,
+                                       &retVal.unitHeight );
+  ERRORMACRO( err == DC1394_SUCCESS, Error, , "Error querying unit size: "
+              << dc1394_error_get_string( err ) );
+  err = m_backend->format7GetUnitPosition( m_camera, m_videoMode, &retVal.unitLeft,
+                                           &retVal.unitTop );
+  ERRORMACRO( err == DC1394_SUCCESS, Error, , "Error querying unit position: "
+              << dc1394_error_get_string( err ) );
+  // Cameras without separate unit position use the unit size.
+  if ( retVal.unitLeft == 0 ) retVal.unitLeft = retVal.unitWidth;
+  if ( retVal.unitTop == 0 ) retVal.unitTop = retVal.unitHeight;
+  err = m_backend->format7GetPacketParameters( m_camera, m_videoMode, &retVal.unitBytes,
+                                               &retVal.maxBytes );
+  ERRORMACRO( err == DC1394_SUCCESS, Error, , "Error querying packet parameters: "
+              << dc1394_error_get_string( err ) );
+  err = m_backend->format7GetRoi( m_camera, m_videoMode, &retVal.coding,
+                                  &retVal.packetSize, &retVal.left, &retVal.top,
+                                  &retVal.width, &retVal.height );
+  ERRORMACRO( err == DC1394_SUCCESS, Error, , "Error querying region of interest: "
+              << dc1394_error_get_string( err ) );
+  err = m_backend->format7GetTotalBytes( m_camera, m_videoMode, &retVal.totalBytes );
+  ERRORMACRO( err == DC1394_SUCCESS, Error, , "Error querying frame size: "
+              << dc1394_error_get_string( err ) );
+  dc1394color_codings_t codings;
+  err = m_backend->format7GetColorCodings( m_camera, m_videoMode, &codings );
+  ERRORMACRO( err == DC1394_SUCCESS, Error, , "Error querying color codings: "
+              << dc1394_error_get_string( err ) );
+  retVal.codings.assign( codings.codings, codings.codings + codings.num );
+  if ( m_backend->format7GetFrameInterval( m_camera, m_videoMode,
+                                           &retVal.frameInterval ) != DC1394_SUCCESS )
+    retVal.frameInterval = 0;
+  return retVal;
+}
+
 DC1394Input::~DC1394Input(void)
 {
   close();
+  pthread_mutex_destroy( &m_bus );
 }
 
-void DC1394Input::close(void)
+void DC1394Input::close( bool keepPowered )
 {
   if ( m_camera != NULL ) {
-    dc1394_video_set_transmission( m_camera, DC1394_OFF );
-    dc1394_capture_stop( m_camera );
-    dc1394_camera_set_power( m_camera, DC1394_OFF );
-    dc1394_camera_free( m_camera );
+    m_keepPowered = keepPowered;
+    asyncStop();
+    m_exposure.reset();
+    // Apply pending feature writes before the camera is released.
+    m_control.reset();
+    // Otherwise the camera would wait for triggers when it is opened again.
+    if ( m_triggered ) {
+      m_backend->externalTriggerSetPower( m_camera, DC1394_OFF );
+      m_triggered = false;
+    };
+    m_backend->videoSetTransmission( m_camera, DC1394_OFF );
+    m_dc1394->stopped( m_camera );
+    // Leased frames still refer to the DMA buffers of the detached camera.
+    m_detached = m_camera;
     m_camera = NULL;
   };
+  if ( m_leased == 0 ) freeCamera();
+  closePipe( m_wakeup );
+  closePipe( m_notify );
+  closePipe( m_resume );
+}
+
+void DC1394Input::freeCamera(void)
+{
+  if ( m_detached != NULL ) {
+    m_backend->captureStop( m_detached );
+    if ( m_keepPowered && m_dc1394->status() ) {
+      // Hand the configured camera back to the DC1394 handle for reopening.
+      m_dc1394->park( m_detached );
+    } else {
+      if ( !m_keepPowered ) m_backend->cameraSetPower( m_detached, DC1394_OFF );
+      m_backend->cameraFree( m_detached );
+    };
+    m_detached = NULL;
+  };
   m_dc1394.reset();
+  m_backend.reset();
 }
 
 FramePtr DC1394Input::read(void) throw (Error)
 {
   ERRORMACRO( m_camera != NULL, Error, , "Camera device not open any more. Did you "
               "call \"close\" before?" );
-  if ( m_frame != NULL ) {
-    dc1394_capture_enqueue( m_camera, m_frame );
-    m_frame = NULL;
+  ERRORMACRO( m_leased < m_numBuffers, Error, , "All " << m_numBuffers
+              << " DMA buffers are held by video frames. Release some frames or "
+              "increase the number of spare buffers" );
+  uint64_t start = DC1394Stats::now();
+  dc1394video_frame_t *frame = m_async ? pop( true ) : dequeue( true );
+  m_stats.waited( DC1394Stats::now() - start );
+  // No frame is returned if the thread was interrupted while waiting.
+  if ( frame == NULL ) return FramePtr();
+  return wrap( frame );
+}
+
+FramePtr DC1394Input::tryRead(void) throw (Error)
+{
+  ERRORMACRO( m_camera != NULL, Error, , "Camera device not open any more. Did you "
+              "call \"close\" before?" );
+  ERRORMACRO( m_leased < m_numBuffers, Error, , "All " << m_numBuffers
+              << " DMA buffers are held by video frames. Release some frames or "
+              "increase the number of spare buffers" );
+  dc1394video_frame_t *frame = m_async ? pop( false ) : dequeue( false );
+  if ( frame == NULL ) return FramePtr();
+  return wrap( frame );
+}
+
+int DC1394Input::fileno(void) throw (Error)
+{
+  ERRORMACRO( m_camera != NULL, Error, , "Camera device not open any more. Did you "
+              "call \"close\" before?" );
+  return m_async ? m_notify[0] : m_backend->captureGetFileno( m_camera );
+}
+
+dc1394video_frame_t *DC1394Input::dequeue( bool block ) throw (Error)
+{
+  dc1394video_frame_t *retVal = NULL;
+  while ( true ) {
+    dc1394error_t err = m_backend->captureDequeue( m_camera, DC1394_CAPTURE_POLICY_POLL,
+                                                   &retVal );
+    // Features have to be read again after a bus reset.
+    if ( err != DC1394_SUCCESS ) m_featuresValid = false;
+    ERRORMACRO( err == DC1394_SUCCESS, Error, , "Error capturing frame: "
+                << dc1394_error_get_string( err ) );
+    if ( retVal != NULL || !block ) break;
+    if ( !wait( m_backend->captureGetFileno( m_camera ) ) ) break;
   };
-  dc1394error_t err = dc1394_capture_dequeue( m_camera, DC1394_CAPTURE_POLICY_WAIT,
-                                              &m_frame );
-  ERRORMACRO( err == DC1394_SUCCESS, Error, , "Error capturing frame: "
-              << dc1394_error_get_string( err ) );
-  return FramePtr( new Frame( m_typecode, m_width, m_height,
-                              (char *)m_frame->image ) );
+  if ( retVal != NULL ) m_stats.captured( retVal->timestamp );
+  m_queued = 0;
+  return retVal;
+}
+
+dc1394video_frame_t *DC1394Input::pop( bool block ) throw (Error)
+{
+  dc1394video_frame_t *retVal = NULL;
+  while ( true ) {
+    // Drain notifications before looking at the queue so that none gets lost.
+    drainPipe( m_notify[0] );
+    dc1394video_frame_t *frame;
+    if ( m_order == READ_NEWEST ) {
+      while ( m_ready->pop( frame ) ) {
+        if ( retVal != NULL ) {
+          release( retVal );
+          m_stats.skipped();
+        };
+        retVal = frame;
+      };
+    } else if ( m_ready->pop( frame ) )
+      retVal = frame;
+    if ( retVal != NULL ) {
+      m_queued = m_ready->read_available();
+      // Keep the notification pipe readable while frames are left in the queue.
+      if ( m_queued > 0 ) signalPipe( m_notify[1] );
+      break;
+    };
+    dc1394error_t err = (dc1394error_t)m_captureError.load();
+    if ( err != DC1394_SUCCESS ) m_featuresValid = false;
+    ERRORMACRO( err == DC1394_SUCCESS, Error, , "Error capturing frame: "
+                << dc1394_error_get_string( err ) );
+    if ( !block ) break;
+    if ( !wait( m_notify[0] ) ) break;
+  };
+  return retVal;
+}
+
+FramePtr DC1394Input::wrap( dc1394video_frame_t *frame ) throw (Error)
+{
+  uint64_t start = DC1394Stats::now();
+  m_info.timestamp = frame->timestamp;
+  m_info.id = frame->id;
+  m_info.framesBehind = frame->frames_behind;
+  m_info.queued = m_queued;
+  m_info.packetsPerFrame = frame->packets_per_frame;
+  m_info.corrupt = m_backend->captureIsFrameCorrupt( m_camera, frame ) != DC1394_FALSE;
+  // Frames captured before the oldest pending trigger were not produced by it.
+  m_info.trigger = 0;
+  m_info.triggerLatency = 0;
+  m_info.command = 0;
+  if ( !m_triggers.empty() && m_triggers.front().second <= frame->timestamp ) {
+    m_info.trigger = m_triggers.front().first;
+    m_info.triggerLatency = frame->timestamp - m_triggers.front().second;
+    m_triggers.pop_front();
+  };
+  // A feature write is in effect if it completed before the frame was exposed.
+  if ( m_control ) {
+    uint64_t period = m_stats.framePeriod();
+    if ( frame->timestamp > period )
+      m_info.command = m_control->effective( frame->timestamp - period );
+  };
+  if ( swapped() ) {
+    // 16 bit pixels arrive in network byte order.
+    if ( ( frame->little_endian != DC1394_FALSE ) != DC1394Unpack::littleEndian() )
+      DC1394Pool::run( swapStripe, frame->image, frame->image_bytes / 2,
+                       STRIPE_BYTES / 2 );
+  };
+  // Exposure is only corrected again once the last correction is visible.
+  bool correct = false;
+  if ( m_exposure && m_info.command >= m_exposureCommand )
+    correct = m_exposure->control( m_exposure->measure( frame, m_coding, m_width,
+                                                        m_height ) );
+  FramePtr retVal;
+  bool copy = m_convert.required() || m_leased + m_spareBuffers >= m_numBuffers;
+  if ( m_convert.required() ) {
+    // Converting the frame requires a new frame anyway.
+    try {
+      retVal = FramePtr( new Frame( m_rbTypecode, m_width, m_height,
+                                    m_storageSize ) );
+      m_convert.convert( frame->image, (uint8_t *)retVal->data() );
+    } catch ( Error &e ) {
+      release( frame );
+      throw e;
+    };
+    release( frame );
+  } else if ( copy ) {
+    // Copy the frame so that the camera does not run out of DMA buffers.
+    try {
+      retVal = FramePtr( new Frame( m_rbTypecode, m_width, m_height,
+                                    m_storageSize ) );
+      DC1394Copy job;
+      job.src = frame->image;
+      job.dst = (uint8_t *)retVal->data();
+      DC1394Pool::run( copyStripe, &job, m_storageSize, STRIPE_BYTES );
+    } catch ( Error &e ) {
+      release( frame );
+      throw e;
+    };
+    release( frame );
+  } else {
+    // The DMA buffer is returned when the Ruby frame is garbage collected or
+    // released explicitly.
+    VALUE rbLease = DC1394Lease::wrap( new DC1394Lease( shared_from_this(), frame ) );
+    m_leased++;
+    retVal = FramePtr( new Frame( m_rbTypecode, m_width, m_height, m_storageSize,
+                                  (char *)frame->image, rbLease ) );
+  };
+  m_stats.delivered( copy, m_info.corrupt, DC1394Stats::now() - start );
+  // The frame is handed off before so that a failed write cannot lose it.
+  if ( correct ) exposureSubmit();
+  return retVal;
+}
+
+void DC1394Input::exposureSubmit(void)
+{
+  try {
+    m_exposureCommand = featureSubmit( DC1394_FEATURE_SHUTTER,
+                                       DC1394Control::SET_VALUE,
+                                       m_exposure->shutter() );
+    if ( m_exposure->config().gainMax > m_exposure->config().gainMin )
+      m_exposureCommand = featureSubmit( DC1394_FEATURE_GAIN,
+                                         DC1394Control::SET_VALUE,
+                                         m_exposure->gain() );
+  } catch ( Error &e ) {
+    // Exposure control continues with the next frame.
+    m_exposure->failed( e.what() );
+    m_stats.exposureFailed();
+  };
+}
+
+bool DC1394Input::swapped(void) const
+{
+  switch ( m_coding ) {
+  case DC1394_COLOR_CODING_MONO16:
+  case DC1394_COLOR_CODING_RGB16:
+  case DC1394_COLOR_CODING_MONO16S:
+  case DC1394_COLOR_CODING_RGB16S:
+  case DC1394_COLOR_CODING_RAW16:
+    return true;
+  default:
+    return false;
+  };
+}
+
+void DC1394Input::setOutput( const std::string &typecode ) throw (Error)
+{
+  m_convert.setTypecode( typecode );
+  m_typecode = typecode;
+  m_rbTypecode = Frame::rubyTypecode( m_typecode );
+  m_storageSize = Frame::storageSize( m_rbTypecode, m_width, m_height );
+}
+
+void DC1394Input::unlease( dc1394video_frame_t *frame )
+{
+  m_leased--;
+  if ( m_camera != NULL )
+    release( frame );
+  else if ( m_leased == 0 && !postpone() )
+    freeCamera();
+}
+
+bool DC1394Input::postpone(void)
+{
+  // Freeing a camera involves bus transactions and joining threads which must
+  // not happen inside the garbage collector. At process exit the remaining
+  // objects are freed after the end procs and nothing is deferred any more.
+  return rb_during_gc() && !exiting;
+}
+
+void DC1394Input::defer( DC1394InputPtr input )
+{
+  deferred.push_back( input );
+}
+
+void DC1394Input::freeDeferred( bool atExit )
+{
+  if ( atExit ) exiting = true;
+  // Freeing a camera may trigger the garbage collector which may defer more.
+  while ( !deferred.empty() ) {
+    std::vector< DC1394InputPtr > inputs;
+    inputs.swap( deferred );
+    for ( std::vector< DC1394InputPtr >::iterator i = inputs.begin();
+          i != inputs.end(); i++ )
+      if ( (*i)->m_camera == NULL && (*i)->m_leased == 0 ) (*i)->freeCamera();
+  };
+}
+
+void DC1394Input::setSpareBuffers( unsigned int spareBuffers ) throw (Error)
+{
+  ERRORMACRO( spareBuffers <= m_numBuffers, Error, , "Number of spare buffers must "
+              "not exceed the number of DMA buffers (" << m_numBuffers << ")" );
+  m_spareBuffers = spareBuffers;
+}
+
+void DC1394Input::release( dc1394video_frame_t *frame )
+{
+  if ( m_async ) {
+    m_done->push( frame );
+    signalPipe( m_resume[1] );
+  } else
+    m_backend->captureEnqueue( m_camera, frame );
+}
+
+bool DC1394Input::wait( int fd ) throw (Error)
+{
+  // Drop stale wakeup requests before blocking.
+  drainPipe( m_wakeup[0] );
+  m_waitFd = fd;
+  m_waitError = 0;
+  m_interrupted = false;
+  rb_thread_call_without_gvl( waitWithoutGVL, this, interruptWait, this );
+  ERRORMACRO( m_waitError == 0, Error, , "Error waiting for frame: "
+              << strerror( m_waitError ) );
+  // Interrupts are handled by the Ruby wrapper once the C++ stack has unwound.
+  return !m_interrupted;
+}
+
+void DC1394Input::swapStripe( void *data, int begin, int end )
+{
+  DC1394Unpack::swapBytes( (uint16_t *)data + begin, end - begin );
+}
+
+void DC1394Input::copyStripe( void *data, int begin, int end )
+{
+  DC1394Copy *job = (DC1394Copy *)data;
+  memcpy( job->dst + begin, job->src + begin, end - begin );
+}
+
+void *DC1394Input::waitWithoutGVL( void *ptr )
+{
+  DC1394Input *self = (DC1394Input *)ptr;
+  struct pollfd fds[2];
+  fds[0].fd = self->m_waitFd;
+  fds[0].events = POLLIN;
+  fds[1].fd = self->m_wakeup[0];
+  fds[1].events = POLLIN;
+  if ( poll( fds, 2, -1 ) < 0 && errno != EINTR )
+    self->m_waitError = errno;
+  return NULL;
+}
+
+void DC1394Input::interruptWait( void *ptr )
+{
+  DC1394Input *self = (DC1394Input *)ptr;
+  self->m_interrupted = true;
+  signalPipe( self->m_wakeup[1] );
+}
+
+void DC1394Input::asyncStart( ReadOrder order ) throw (Error)
+{
+  ERRORMACRO( m_camera != NULL, Error, , "Camera device not open any more. Did you "
+              "call \"close\" before?" );
+  m_order = order;
+  if ( !m_async ) {
+    m_ready.reset( new FrameQueue( m_numBuffers ) );
+    m_done.reset( new FrameQueue( m_numBuffers ) );
+    m_quit = false;
+    m_captureError = DC1394_SUCCESS;
+    // The capture thread is the only one dequeueing and enqueueing DMA buffers
+    // from now on.
+    m_async = true;
+    int err = pthread_create( &m_thread, NULL, captureThread, this );
+    if ( err != 0 ) {
+      m_async = false;
+      m_ready.reset();
+      m_done.reset();
+      ERRORMACRO( false, Error, , "Error starting capture thread: "
+                  << strerror( err ) );
+    };
+  };
+}
+
+void DC1394Input::asyncStop(void)
+{
+  if ( m_async ) {
+    m_quit = true;
+    signalPipe( m_resume[1] );
+    pthread_join( m_thread, NULL );
+    m_async = false;
+    dc1394video_frame_t *frame;
+    while ( m_ready->pop( frame ) )
+      m_backend->captureEnqueue( m_camera, frame );
+    while ( m_done->pop( frame ) )
+      m_backend->captureEnqueue( m_camera, frame );
+    m_ready.reset();
+    m_done.reset();
+  };
+}
+
+void DC1394Input::capture(void)
+{
+  struct pollfd fds[2];
+  fds[0].fd = m_backend->captureGetFileno( m_camera );
+  fds[0].events = POLLIN;
+  fds[1].fd = m_resume[0];
+  fds[1].events = POLLIN;
+  while ( !m_quit ) {
+    // Drain notifications before looking at the queue so that none gets lost.
+    drainPipe( m_resume[0] );
+    dc1394video_frame_t *frame;
+    while ( m_done->pop( frame ) )
+      m_backend->captureEnqueue( m_camera, frame );
+    frame = NULL;
+    dc1394error_t err = m_backend->captureDequeue( m_camera, DC1394_CAPTURE_POLICY_POLL,
+                                                   &frame );
+    if ( err == DC1394_SUCCESS && frame == NULL ) {
+      if ( poll( fds, 2, -1 ) < 0 && errno != EINTR ) err = DC1394_FAILURE;
+    };
+    if ( err != DC1394_SUCCESS ) {
+      m_captureError = err;
+      signalPipe( m_notify[1] );
+      break;
+    };
+    if ( frame != NULL ) {
+      m_stats.captured( frame->timestamp );
+      // The queue holds as many entries as there are DMA buffers.
+      m_ready->push( frame );
+      signalPipe( m_notify[1] );
+    };
+  };
+}
+
+void *DC1394Input::captureThread( void *ptr )
+{
+  ((DC1394Input *)ptr)->capture();
+  return NULL;
 }
 
 bool DC1394Input::status(void) const
@@ -161,10 +795,102 @@ bool DC1394Input::status(void) const
   return m_camera != NULL;
 }
 
+uint32_t DC1394Input::bandwidth(void) throw (Error)
+{
+  ERRORMACRO( m_camera != NULL, Error, , "Camera device not open any more. Did you "
+              "call \"close\" before?" );
+  DC1394BusLock lock( &m_bus );
+  uint32_t retVal;
+  dc1394error_t err = m_backend->videoGetBandwidthUsage( m_camera, &retVal );
+  ERRORMACRO( err == DC1394_SUCCESS, Error, , "Error querying bandwidth usage: "
+              << dc1394_error_get_string( err ) );
+  return retVal;
+}
+
+DC1394Input::TriggerInfo DC1394Input::triggerRead(void) throw (Error)
+{
+  ERRORMACRO( m_camera != NULL, Error, , "Camera device not open any more. Did you "
+              "call \"close\" before?" );
+  DC1394BusLock lock( &m_bus );
+  dc1394feature_info_t feature;
+  feature.id = DC1394_FEATURE_TRIGGER;
+  dc1394error_t err = m_backend->featureGet( m_camera, &feature );
+  ERRORMACRO( err == DC1394_SUCCESS, Error, , "Error querying trigger: "
+              << dc1394_error_get_string( err ) );
+  ERRORMACRO( feature.available != DC1394_FALSE, Error, , "Camera does not "
+              "support triggered capture" );
+  TriggerInfo retVal;
+  retVal.enabled = feature.is_on != DC1394_OFF;
+  retVal.source = feature.trigger_source;
+  retVal.mode = feature.trigger_mode;
+  retVal.polarity = feature.trigger_polarity;
+  retVal.polarityCapable = feature.polarity_capable != DC1394_FALSE;
+  retVal.sources.assign( feature.trigger_sources.sources,
+                         feature.trigger_sources.sources +
+                         feature.trigger_sources.num );
+  retVal.modes.assign( feature.trigger_modes.modes,
+                       feature.trigger_modes.modes + feature.trigger_modes.num );
+  return retVal;
+}
+
+void DC1394Input::triggerWrite( bool enabled, dc1394trigger_source_t source,
+                                dc1394trigger_mode_t mode,
+                                dc1394trigger_polarity_t polarity ) throw (Error)
+{
+  TriggerInfo info( triggerRead() );
+  DC1394BusLock lock( &m_bus );
+  dc1394error_t err;
+  if ( enabled ) {
+    ERRORMACRO( find( info.sources.begin(), info.sources.end(), source ) !=
+                info.sources.end(), Error, , "Trigger source " << source
+                << " is not supported by the camera" );
+    ERRORMACRO( find( info.modes.begin(), info.modes.end(), mode ) !=
+                info.modes.end(), Error, , "Trigger mode " << mode
+                << " is not supported by the camera" );
+    err = m_backend->externalTriggerSetMode( m_camera, mode );
+    ERRORMACRO( err == DC1394_SUCCESS, Error, , "Error setting trigger mode: "
+                << dc1394_error_get_string( err ) );
+    err = m_backend->externalTriggerSetSource( m_camera, source );
+    ERRORMACRO( err == DC1394_SUCCESS, Error, , "Error setting trigger source: "
+                << dc1394_error_get_string( err ) );
+    if ( info.polarityCapable ) {
+      err = m_backend->externalTriggerSetPolarity( m_camera, polarity );
+      ERRORMACRO( err == DC1394_SUCCESS, Error, , "Error setting trigger "
+                  "polarity: " << dc1394_error_get_string( err ) );
+    };
+  };
+  err = m_backend->externalTriggerSetPower( m_camera,
+                                           enabled ? DC1394_ON : DC1394_OFF );
+  ERRORMACRO( err == DC1394_SUCCESS, Error, , "Error switching trigger "
+              << ( enabled ? "on" : "off" ) << ": " << dc1394_error_get_string( err ) );
+  m_triggered = enabled;
+  m_triggers.clear();
+}
+
+uint32_t DC1394Input::softwareTrigger(void) throw (Error)
+{
+  ERRORMACRO( m_camera != NULL, Error, , "Camera device not open any more. Did you "
+              "call \"close\" before?" );
+  ERRORMACRO( m_triggered, Error, , "Triggered capture is not enabled" );
+  // Frame timestamps are based on the wall clock.
+  struct timespec t;
+  clock_gettime( CLOCK_REALTIME, &t );
+  uint64_t time = (uint64_t)t.tv_sec * 1000000 + t.tv_nsec / 1000;
+  DC1394BusLock lock( &m_bus );
+  dc1394error_t err = m_backend->softwareTriggerSetPower( m_camera, DC1394_ON );
+  ERRORMACRO( err == DC1394_SUCCESS, Error, , "Error firing software trigger: "
+              << dc1394_error_get_string( err ) );
+  // Triggers which were lost are discarded eventually.
+  if ( m_triggers.size() >= 2 * m_numBuffers ) m_triggers.pop_front();
+  m_triggers.push_back( make_pair( ++m_triggerCount, time ) );
+  return m_triggerCount;
+}
+
 string DC1394Input::inspect(void) const
 {
   ostringstream s;
-  s << "DC1394Input( '" << m_node << "' )";
+  s << "DC1394Input( '0x" << setfill( '0' ) << setw( 16 ) << setbase( 16 )
+    << m_guid << setbase( 10 ) << ':' << m_unit << "' )";
   return s.str();
 }
 
@@ -172,10 +898,17 @@ unsigned int DC1394Input::featureGetValue( dc1394feature_t feature ) throw (Erro
 {
   ERRORMACRO( m_camera != NULL, Error, , "Camera device not open any more. Did you "
               "call \"close\" before?" );
+  dc1394feature_info_t &info = featureInfo( feature );
+  // Values changed by the camera itself are read from the bus.
+  if ( info.available != DC1394_FALSE &&
+       info.current_mode == DC1394_FEATURE_MODE_MANUAL )
+    return info.value;
+  DC1394BusLock lock( &m_bus );
   uint32_t value;
-  dc1394error_t err = dc1394_feature_get_value( m_camera, feature, &value );
+  dc1394error_t err = m_backend->featureGetValue( m_camera, feature, &value );
   ERRORMACRO( err == DC1394_SUCCESS, Error, , "Error reading feature value: "
               << dc1394_error_get_string( err ) );
+  info.value = value;
   return value;
 }
 
@@ -183,50 +916,35 @@ void DC1394Input::featureSetValue( dc1394feature_t feature, unsigned int value )
 {
   ERRORMACRO( m_camera != NULL, Error, , "Camera device not open any more. Did you "
               "call \"close\" before?" );
-  dc1394error_t err = dc1394_feature_set_value( m_camera, feature, value );
-  ERRORMACRO( err == DC1394_SUCCESS, Error, , "Error writing feature value: "
-              << dc1394_error_get_string( err ) );
+  // Writes go through the queue of the control thread so that an older
+  // asynchronous write cannot overwrite the value later.
+  featureSubmit( feature, DC1394Control::SET_VALUE, value );
 }
 
 bool DC1394Input::featureIsPresent( dc1394feature_t feature ) throw (Error)
 {
-  ERRORMACRO( m_camera != NULL, Error, , "Camera device not open any more. Did you "
-              "call \"close\" before?" );
-  dc1394bool_t value;
-  dc1394error_t err = dc1394_feature_is_present( m_camera, feature, &value );
-  ERRORMACRO( err == DC1394_SUCCESS, Error, , "Error checking presence of feature: "
-              << dc1394_error_get_string( err ) );
-  return value != DC1394_FALSE;
+  return featureInfo( feature ).available != DC1394_FALSE;
 }
 
 bool DC1394Input::featureIsReadable( dc1394feature_t feature ) throw (Error)
 {
-  ERRORMACRO( m_camera != NULL, Error, , "Camera device not open any more. Did you "
-              "call \"close\" before?" );
-  dc1394bool_t value;
-  dc1394error_t err = dc1394_feature_is_readable( m_camera, feature, &value );
-  ERRORMACRO( err == DC1394_SUCCESS, Error, , "Error checking whether feature is "
-              "readable: " << dc1394_error_get_string( err ) );
-  return value != DC1394_FALSE;
+  return featureInfo( feature ).readout_capable != DC1394_FALSE;
 }
 
 bool DC1394Input::featureIsSwitchable( dc1394feature_t feature ) throw (Error)
 {
-  ERRORMACRO( m_camera != NULL, Error, , "Camera device not open any more. Did you "
-              "call \"close\" before?" );
-  dc1394bool_t value;
-  dc1394error_t err = dc1394_feature_is_switchable( m_camera, feature, &value );
-  ERRORMACRO( err == DC1394_SUCCESS, Error, , "Error checking whether feature is "
-              "switchable: " << dc1394_error_get_string( err ) );
-  return value != DC1394_FALSE;
+  return featureInfo( feature ).on_off_capable != DC1394_FALSE;
 }
 
 dc1394switch_t DC1394Input::featureGetPower( dc1394feature_t feature ) throw (Error)
 {
   ERRORMACRO( m_camera != NULL, Error, , "Camera device not open any more. Did you "
               "call \"close\" before?" );
+  dc1394feature_info_t &info = featureInfo( feature );
+  if ( info.available != DC1394_FALSE ) return info.is_on;
+  DC1394BusLock lock( &m_bus );
   dc1394switch_t value;
-  dc1394error_t err = dc1394_feature_get_power( m_camera, feature, &value );
+  dc1394error_t err = m_backend->featureGetPower( m_camera, feature, &value );
   ERRORMACRO( err == DC1394_SUCCESS, Error, , "Error checking power status of "
               "feature: " << dc1394_error_get_string( err ) );
   return value;
@@ -237,21 +955,13 @@ void DC1394Input::featureSetPower( dc1394feature_t feature, dc1394switch_t value
 {
   ERRORMACRO( m_camera != NULL, Error, , "Camera device not open any more. Did you "
               "call \"close\" before?" );
-  dc1394error_t err = dc1394_feature_set_power( m_camera, feature, value );
-  ERRORMACRO( err == DC1394_SUCCESS, Error, , "Error setting power status of "
-              "feature: " << dc1394_error_get_string( err ) );
+  featureSubmit( feature, DC1394Control::SET_POWER, value );
 }
 
 dc1394feature_modes_t DC1394Input::featureModes( dc1394feature_t feature )
   throw (Error)
 {
-  ERRORMACRO( m_camera != NULL, Error, , "Camera device not open any more. Did you "
-              "call \"close\" before?" );
-  dc1394feature_modes_t value;
-  dc1394error_t err = dc1394_feature_get_modes( m_camera, feature, &value );
-  ERRORMACRO( err == DC1394_SUCCESS, Error, , "Error querying list of control modes "
-              "for a feature: " << dc1394_error_get_string( err ) );
-  return value;
+  return featureInfo( feature ).modes;
 }
 
 dc1394feature_mode_t DC1394Input::featureModeGet( dc1394feature_t feature )
@@ -259,8 +969,11 @@ dc1394feature_mode_t DC1394Input::featureModeGet( dc1394feature_t feature )
 {
   ERRORMACRO( m_camera != NULL, Error, , "Camera device not open any more. Did you "
               "call \"close\" before?" );
+  dc1394feature_info_t &info = featureInfo( feature );
+  if ( info.available != DC1394_FALSE ) return info.current_mode;
+  DC1394BusLock lock( &m_bus );
   dc1394feature_mode_t value;
-  dc1394error_t err = dc1394_feature_get_mode( m_camera, feature, &value );
+  dc1394error_t err = m_backend->featureGetMode( m_camera, feature, &value );
   ERRORMACRO( err == DC1394_SUCCESS, Error, , "Error querying current mode of "
               "feature: " << dc1394_error_get_string( err ) );
   return value;
@@ -271,33 +984,125 @@ void DC1394Input::featureModeSet( dc1394feature_t feature, dc1394feature_mode_t
 {
   ERRORMACRO( m_camera != NULL, Error, , "Camera device not open any more. Did you "
               "call \"close\" before?" );
-  dc1394error_t err = dc1394_feature_set_mode( m_camera, feature, mode );
-  ERRORMACRO( err == DC1394_SUCCESS, Error, , "Error setting mode of feature: "
-              << dc1394_error_get_string( err ) );
+  featureSubmit( feature, DC1394Control::SET_MODE, mode );
 }
 
 unsigned int DC1394Input::featureMin( dc1394feature_t feature ) throw (Error)
+{
+  return featureInfo( feature ).min;
+}
+
+unsigned int DC1394Input::featureMax( dc1394feature_t feature ) throw (Error)
+{
+  return featureInfo( feature ).max;
+}
+
+uint32_t DC1394Input::featureSubmit( dc1394feature_t feature,
+                                     DC1394Control::Command command,
+                                     uint32_t value ) throw (Error)
 {
   ERRORMACRO( m_camera != NULL, Error, , "Camera device not open any more. Did you "
               "call \"close\" before?" );
-  dc1394feature_info_t info;
-  info.id = feature;
-  dc1394error_t err = dc1394_feature_get( m_camera, &info );
-  ERRORMACRO( err == DC1394_SUCCESS, Error, , "Error querying minimum value of "
-              "feature: " << dc1394_error_get_string( err ) );
-  return info.min;
+  ERRORMACRO( feature >= DC1394_FEATURE_MIN && feature <= DC1394_FEATURE_MAX, Error, ,
+              "Feature " << feature << " does not exist" );
+  if ( !m_control )
+    m_control.reset( new DC1394Control( m_backend, m_camera, &m_bus ) );
+  // The snapshot is updated once the control thread has written the value.
+  return m_control->submit( feature, command, value );
 }
 
-unsigned int DC1394Input::featureMax( dc1394feature_t feature ) throw (Error)
+void DC1394Input::featureUpdate( int feature, DC1394Control::Command command,
+                                 uint32_t value )
+{
+  dc1394feature_info_t &info = m_features.feature[ feature - DC1394_FEATURE_MIN ];
+  switch ( command ) {
+  case DC1394Control::SET_MODE:
+    info.current_mode = (dc1394feature_mode_t)value;
+    break;
+  case DC1394Control::SET_POWER:
+    info.is_on = (dc1394switch_t)value;
+    break;
+  default:
+    info.value = value;
+    break;
+  };
+}
+
+bool DC1394Input::featureFlush(void) throw (Error)
 {
   ERRORMACRO( m_camera != NULL, Error, , "Camera device not open any more. Did you "
               "call \"close\" before?" );
-  dc1394feature_info_t info;
-  info.id = feature;
-  dc1394error_t err = dc1394_feature_get( m_camera, &info );
-  ERRORMACRO( err == DC1394_SUCCESS, Error, , "Error querying minimum value of "
-              "feature: " << dc1394_error_get_string( err ) );
-  return info.max;
+  return m_control ? m_control->flush() : true;
+}
+
+void DC1394Input::exposureStart( VALUE rbOptions ) throw (Error)
+{
+  ERRORMACRO( m_camera != NULL, Error, , "Camera device not open any more. Did you "
+              "call \"close\" before?" );
+  ERRORMACRO( DC1394Exposure::supported( m_coding ), Error, , "Exposure control "
+              "does not support DC1394 colorspace " << m_coding );
+  // Current values are required to continue from the present exposure.
+  refreshFeatures();
+  dc1394feature_info_t &shutter = featureInfo( DC1394_FEATURE_SHUTTER ),
+    &gain = featureInfo( DC1394_FEATURE_GAIN );
+  ERRORMACRO( shutter.available != DC1394_FALSE, Error, , "Exposure control "
+              "requires a camera with shutter feature" );
+  DC1394Exposure::Config config( DC1394Exposure::config( rbOptions, shutter, gain ) );
+  if ( config.width > 0 && config.height > 0 )
+    ERRORMACRO( config.left + config.width <= m_width &&
+                config.top + config.height <= m_height, Error, , "Region of "
+                "interest " << config.width << 'x' << config.height << '+'
+                << config.left << '+' << config.top << " exceeds frame of size "
+                << m_width << 'x' << m_height );
+  m_exposureCommand = 0;
+  if ( shutter.current_mode != DC1394_FEATURE_MODE_MANUAL )
+    m_exposureCommand = featureSubmit( DC1394_FEATURE_SHUTTER, DC1394Control::SET_MODE,
+                                       DC1394_FEATURE_MODE_MANUAL );
+  if ( config.gainMax > config.gainMin &&
+       gain.current_mode != DC1394_FEATURE_MODE_MANUAL )
+    m_exposureCommand = featureSubmit( DC1394_FEATURE_GAIN, DC1394Control::SET_MODE,
+                                       DC1394_FEATURE_MODE_MANUAL );
+  m_exposure.reset( new DC1394Exposure( config, shutter.value,
+                                        gain.available != DC1394_FALSE ?
+                                        gain.value : 0 ) );
+}
+
+const dc1394featureset_t &DC1394Input::features(void) throw (Error)
+{
+  ERRORMACRO( m_camera != NULL, Error, , "Camera device not open any more. Did you "
+              "call \"close\" before?" );
+  if ( !m_featuresValid )
+    refreshFeatures();
+  else if ( m_control ) {
+    // Apply asynchronous writes completed in the meantime.
+    DC1394Control::ValueMap values;
+    m_control->written( values );
+    for ( DC1394Control::ValueMap::const_iterator i=values.begin();
+          i!=values.end(); i++ )
+      featureUpdate( i->first.first, (DC1394Control::Command)i->first.second,
+                     i->second );
+  };
+  return m_features;
+}
+
+void DC1394Input::refreshFeatures(void) throw (Error)
+{
+  ERRORMACRO( m_camera != NULL, Error, , "Camera device not open any more. Did you "
+              "call \"close\" before?" );
+  DC1394BusLock lock( &m_bus );
+  dc1394error_t err = m_backend->featureGetAll( m_camera, &m_features );
+  ERRORMACRO( err == DC1394_SUCCESS, Error, , "Error reading features: "
+              << dc1394_error_get_string( err ) );
+  m_featuresValid = true;
+}
+
+dc1394feature_info_t &DC1394Input::featureInfo( dc1394feature_t feature )
+  throw (Error)
+{
+  ERRORMACRO( feature >= DC1394_FEATURE_MIN && feature <= DC1394_FEATURE_MAX, Error, ,
+              "Feature " << feature << " does not exist" );
+  features();
+  return m_features.feature[ feature - DC1394_FEATURE_MIN ];
 }
 
 VALUE DC1394Input::registerRubyClass( VALUE module )
@@ -393,12 +1198,96 @@ VALUE DC1394Input::registerRubyClass( VALUE module )
                    INT2NUM( DC1394_FEATURE_MODE_AUTO ) );
   rb_define_const( cRubyClass, "FEATURE_MODE_ONE_PUSH_AUTO",
                    INT2NUM( DC1394_FEATURE_MODE_ONE_PUSH_AUTO ) );
-  rb_define_singleton_method( cRubyClass, "new", RUBY_METHOD_FUNC( wrapNew ), 5 );
-  rb_define_method( cRubyClass, "close", RUBY_METHOD_FUNC( wrapClose ), 0 );
+  rb_define_const( cRubyClass, "TRIGGER_MODE_0", INT2NUM( DC1394_TRIGGER_MODE_0 ) );
+  rb_define_const( cRubyClass, "TRIGGER_MODE_1", INT2NUM( DC1394_TRIGGER_MODE_1 ) );
+  rb_define_const( cRubyClass, "TRIGGER_MODE_2", INT2NUM( DC1394_TRIGGER_MODE_2 ) );
+  rb_define_const( cRubyClass, "TRIGGER_MODE_3", INT2NUM( DC1394_TRIGGER_MODE_3 ) );
+  rb_define_const( cRubyClass, "TRIGGER_MODE_4", INT2NUM( DC1394_TRIGGER_MODE_4 ) );
+  rb_define_const( cRubyClass, "TRIGGER_MODE_5", INT2NUM( DC1394_TRIGGER_MODE_5 ) );
+  rb_define_const( cRubyClass, "TRIGGER_MODE_14", INT2NUM( DC1394_TRIGGER_MODE_14 ) );
+  rb_define_const( cRubyClass, "TRIGGER_MODE_15", INT2NUM( DC1394_TRIGGER_MODE_15 ) );
+  rb_define_const( cRubyClass, "TRIGGER_SOURCE_0",
+                   INT2NUM( DC1394_TRIGGER_SOURCE_0 ) );
+  rb_define_const( cRubyClass, "TRIGGER_SOURCE_1",
+                   INT2NUM( DC1394_TRIGGER_SOURCE_1 ) );
+  rb_define_const( cRubyClass, "TRIGGER_SOURCE_2",
+                   INT2NUM( DC1394_TRIGGER_SOURCE_2 ) );
+  rb_define_const( cRubyClass, "TRIGGER_SOURCE_3",
+                   INT2NUM( DC1394_TRIGGER_SOURCE_3 ) );
+  rb_define_const( cRubyClass, "TRIGGER_SOURCE_SOFTWARE",
+                   INT2NUM( DC1394_TRIGGER_SOURCE_SOFTWARE ) );
+  rb_define_const( cRubyClass, "TRIGGER_ACTIVE_LOW",
+                   INT2NUM( DC1394_TRIGGER_ACTIVE_LOW ) );
+  rb_define_const( cRubyClass, "TRIGGER_ACTIVE_HIGH",
+                   INT2NUM( DC1394_TRIGGER_ACTIVE_HIGH ) );
+  rb_define_const( cRubyClass, "READ_OLDEST", INT2NUM( READ_OLDEST ) );
+  rb_define_const( cRubyClass, "READ_NEWEST", INT2NUM( READ_NEWEST ) );
+  rb_define_const( cRubyClass, "CAPTURE_FLAGS_CHANNEL_ALLOC",
+                   INT2NUM( DC1394_CAPTURE_FLAGS_CHANNEL_ALLOC ) );
+  rb_define_const( cRubyClass, "CAPTURE_FLAGS_BANDWIDTH_ALLOC",
+                   INT2NUM( DC1394_CAPTURE_FLAGS_BANDWIDTH_ALLOC ) );
+  rb_define_const( cRubyClass, "CAPTURE_FLAGS_DEFAULT",
+                   INT2NUM( DC1394_CAPTURE_FLAGS_DEFAULT ) );
+  rb_define_const( cRubyClass, "CAPTURE_FLAGS_AUTO_ISO",
+                   INT2NUM( DC1394_CAPTURE_FLAGS_AUTO_ISO ) );
+  rb_define_const( cRubyClass, "BAYER_RGGB", INT2NUM( DC1394_COLOR_FILTER_RGGB ) );
+  rb_define_const( cRubyClass, "BAYER_GBRG", INT2NUM( DC1394_COLOR_FILTER_GBRG ) );
+  rb_define_const( cRubyClass, "BAYER_GRBG", INT2NUM( DC1394_COLOR_FILTER_GRBG ) );
+  rb_define_const( cRubyClass, "BAYER_BGGR", INT2NUM( DC1394_COLOR_FILTER_BGGR ) );
+  rb_define_const( cRubyClass, "DEMOSAIC_NEAREST", INT2NUM( DC1394Bayer::NEAREST ) );
+  rb_define_const( cRubyClass, "DEMOSAIC_BILINEAR", INT2NUM( DC1394Bayer::BILINEAR ) );
+  rb_define_const( cRubyClass, "DEMOSAIC_EDGE_AWARE",
+                   INT2NUM( DC1394Bayer::EDGE_AWARE ) );
+  rb_define_singleton_method( cRubyClass, "new", RUBY_METHOD_FUNC( wrapNew ), 8 );
+  rb_define_method( cRubyClass, "close", RUBY_METHOD_FUNC( wrapClose ), 1 );
   rb_define_method( cRubyClass, "width", RUBY_METHOD_FUNC( wrapWidth ), 0 );
   rb_define_method( cRubyClass, "height", RUBY_METHOD_FUNC( wrapHeight ), 0 );
+  rb_define_method( cRubyClass, "buffers", RUBY_METHOD_FUNC( wrapNumBuffers ), 0 );
+  rb_define_method( cRubyClass, "frame_bytes", RUBY_METHOD_FUNC( wrapFrameBytes ), 0 );
+  rb_define_method( cRubyClass, "dma_bytes", RUBY_METHOD_FUNC( wrapDMABytes ), 0 );
+  rb_define_method( cRubyClass, "spare_buffers",
+                    RUBY_METHOD_FUNC( wrapSpareBuffers ), 0 );
+  rb_define_method( cRubyClass, "spare_buffers=",
+                    RUBY_METHOD_FUNC( wrapSetSpareBuffers ), 1 );
+  rb_define_method( cRubyClass, "leased", RUBY_METHOD_FUNC( wrapLeased ), 0 );
+  rb_define_method( cRubyClass, "guid", RUBY_METHOD_FUNC( wrapGUID ), 0 );
+  rb_define_method( cRubyClass, "unit", RUBY_METHOD_FUNC( wrapUnit ), 0 );
+  rb_define_method( cRubyClass, "bandwidth", RUBY_METHOD_FUNC( wrapBandwidth ), 0 );
+  rb_define_method( cRubyClass, "speed", RUBY_METHOD_FUNC( wrapSpeed ), 0 );
+  rb_define_method( cRubyClass, "b_mode?", RUBY_METHOD_FUNC( wrapBMode ), 0 );
+  rb_define_method( cRubyClass, "raw?", RUBY_METHOD_FUNC( wrapRaw ), 0 );
+  rb_define_method( cRubyClass, "bayer_pattern",
+                    RUBY_METHOD_FUNC( wrapBayerPattern ), 0 );
+  rb_define_method( cRubyClass, "bayer_pattern=",
+                    RUBY_METHOD_FUNC( wrapSetBayerPattern ), 1 );
+  rb_define_method( cRubyClass, "demosaic", RUBY_METHOD_FUNC( wrapDemosaic ), 0 );
+  rb_define_method( cRubyClass, "demosaic=",
+                    RUBY_METHOD_FUNC( wrapSetDemosaic ), 1 );
+  rb_define_method( cRubyClass, "format7?", RUBY_METHOD_FUNC( wrapFormat7 ), 0 );
+  rb_define_method( cRubyClass, "format7_read",
+                    RUBY_METHOD_FUNC( wrapFormat7Read ), 0 );
+  rb_define_method( cRubyClass, "format7_write",
+                    RUBY_METHOD_FUNC( wrapFormat7Write ), 6 );
+  rb_define_method( cRubyClass, "output", RUBY_METHOD_FUNC( wrapOutput ), 0 );
+  rb_define_method( cRubyClass, "output=", RUBY_METHOD_FUNC( wrapSetOutput ), 1 );
   rb_define_method( cRubyClass, "read", RUBY_METHOD_FUNC( wrapRead ), 0 );
+  rb_define_method( cRubyClass, "try_read", RUBY_METHOD_FUNC( wrapTryRead ), 0 );
+  rb_define_method( cRubyClass, "fileno", RUBY_METHOD_FUNC( wrapFileno ), 0 );
+  rb_define_method( cRubyClass, "last_frame_info",
+                    RUBY_METHOD_FUNC( wrapLastFrameInfo ), 0 );
+  rb_define_method( cRubyClass, "stats", RUBY_METHOD_FUNC( wrapStats ), 0 );
+  rb_define_method( cRubyClass, "reset_stats", RUBY_METHOD_FUNC( wrapResetStats ), 0 );
   rb_define_method( cRubyClass, "status?", RUBY_METHOD_FUNC( wrapStatus ), 0 );
+  rb_define_method( cRubyClass, "async_start",
+                    RUBY_METHOD_FUNC( wrapAsyncStart ), 1 );
+  rb_define_method( cRubyClass, "async_stop", RUBY_METHOD_FUNC( wrapAsyncStop ), 0 );
+  rb_define_method( cRubyClass, "async?", RUBY_METHOD_FUNC( wrapAsync ), 0 );
+  rb_define_method( cRubyClass, "trigger_read",
+                    RUBY_METHOD_FUNC( wrapTriggerRead ), 0 );
+  rb_define_method( cRubyClass, "trigger_write",
+                    RUBY_METHOD_FUNC( wrapTriggerWrite ), 4 );
+  rb_define_method( cRubyClass, "software_trigger",
+                    RUBY_METHOD_FUNC( wrapSoftwareTrigger ), 0 );
   rb_define_method( cRubyClass, "feature_read",
                     RUBY_METHOD_FUNC( wrapFeatureGetValue ), 1 );
   rb_define_method( cRubyClass, "feature_write",
@@ -423,26 +1312,74 @@ VALUE DC1394Input::registerRubyClass( VALUE module )
                     RUBY_METHOD_FUNC( wrapFeatureMin ), 1 );
   rb_define_method( cRubyClass, "feature_max",
                     RUBY_METHOD_FUNC( wrapFeatureMax ), 1 );
+  rb_define_method( cRubyClass, "feature_write_async",
+                    RUBY_METHOD_FUNC( wrapFeatureWriteAsync ), 2 );
+  rb_define_method( cRubyClass, "feature_on_async",
+                    RUBY_METHOD_FUNC( wrapFeatureOnAsync ), 2 );
+  rb_define_method( cRubyClass, "feature_mode_write_async",
+                    RUBY_METHOD_FUNC( wrapFeatureModeWriteAsync ), 2 );
+  rb_define_method( cRubyClass, "feature_flush",
+                    RUBY_METHOD_FUNC( wrapFeatureFlush ), 0 );
+  rb_define_method( cRubyClass, "auto_exposure_start",
+                    RUBY_METHOD_FUNC( wrapAutoExposureStart ), 1 );
+  rb_define_method( cRubyClass, "auto_exposure_stop",
+                    RUBY_METHOD_FUNC( wrapAutoExposureStop ), 0 );
+  rb_define_method( cRubyClass, "auto_exposure",
+                    RUBY_METHOD_FUNC( wrapAutoExposure ), 0 );
+  rb_define_method( cRubyClass, "features", RUBY_METHOD_FUNC( wrapFeatures ), 0 );
+  rb_define_method( cRubyClass, "refresh_features",
+                    RUBY_METHOD_FUNC( wrapRefreshFeatures ), 0 );
   return cRubyClass;
 }
 
+void DC1394Input::markRubyMember(void)
+{
+  rb_gc_mark( m_rbTypecode );
+}
+
+void DC1394Input::markRubyObject( void *ptr )
+{
+  (*(DC1394InputPtr *)ptr)->markRubyMember();
+}
+
 void DC1394Input::deleteRubyObject( void *ptr )
 {
-  delete (DC1394InputPtr *)ptr;
+  DC1394InputPtr *self = (DC1394InputPtr *)ptr;
+  if ( postpone() ) defer( *self );
+  delete self;
 }
 
 VALUE DC1394Input::wrapNew( VALUE rbClass, VALUE rbDC1394, VALUE rbNode,
-                            VALUE rbSpeed, VALUE rbForceFrameRate, VALUE rbFrameRate )
+                            VALUE rbSpeed, VALUE rbForceFrameRate, VALUE rbFrameRate,
+                            VALUE rbNumBuffers, VALUE rbFlags, VALUE rbPolicy )
 {
   VALUE rbRetVal = Qnil;
   try {
+    freeDeferred();
     DC1394Ptr *dc1394; Data_Get_Struct( rbDC1394, DC1394Ptr, dc1394 );
+    uint64_t guid;
+    int unit;
+    if ( TYPE( rbNode ) == T_HASH ) {
+      VALUE rbGUID = rb_hash_aref( rbNode, ID2SYM( rb_intern( "guid" ) ) ),
+        rbUnit = rb_hash_aref( rbNode, ID2SYM( rb_intern( "unit" ) ) );
+      if ( NIL_P( rbGUID ) )
+        rb_raise( rb_eArgError, "Hash for selecting camera requires :guid" );
+      guid = NUM2ULL( rbGUID );
+      unit = NIL_P( rbUnit ) ? -1 : NUM2INT( rbUnit );
+    } else {
+      const DC1394::Camera &camera = (*dc1394)->camera( NUM2UINT( rbNode ) );
+      guid = camera.guid;
+      unit = camera.unit;
+    };
     DC1394SelectPtr select( new DC1394Select );
-    DC1394InputPtr ptr( new DC1394Input( *dc1394, NUM2UINT( rbNode ),
+    select->setPolicy( rbPolicy );
+    DC1394InputPtr ptr( new DC1394Input( *dc1394, guid, unit,
                                          (dc1394speed_t)NUM2INT( rbSpeed ),
                                          select, rbForceFrameRate != Qfalse,
-                                         (dc1394framerate_t)NUM2INT( rbFrameRate ) ) );
-    rbRetVal = Data_Wrap_Struct( rbClass, 0, deleteRubyObject,
+                                         (dc1394framerate_t)NUM2INT( rbFrameRate ),
+                                         NUM2UINT( rbNumBuffers ),
+                                         NUM2UINT( rbFlags ) ) );
+    rbRetVal = Data_Wrap_Struct( rbClass, markRubyObject, deleteRubyObject,
                                  new DC1394InputPtr( ptr ) );
   } catch ( std::exception &e ) {
     rb_raise( rb_eRuntimeError, "%s", e.what() );
@@ -450,32 +1387,125 @@ VALUE DC1394Input::wrapNew( VALUE rbClass, VALUE rbDC1394, VALUE rbNode,
   return rbRetVal;
 }
 
-VALUE DC1394Input::wrapClose( VALUE rbSelf )
+VALUE DC1394Input::wrapClose( VALUE rbSelf, VALUE rbKeepPowered )
 {
   DC1394InputPtr *self; Data_Get_Struct( rbSelf, DC1394InputPtr, self );
-  (*self)->close();
+  (*self)->close( RTEST( rbKeepPowered ) );
+  freeDeferred();
   return rbSelf;
 }
 
 VALUE DC1394Input::wrapRead( VALUE rbSelf )
+{
+  VALUE rbRetVal = Qnil;
+  while ( rbRetVal == Qnil ) {
+    try {
+      freeDeferred();
+      DC1394InputPtr *self; Data_Get_Struct( rbSelf, DC1394InputPtr, self );
+      FramePtr frame( (*self)->read() );
+      if ( frame.get() != NULL ) rbRetVal = frame->rubyObject();
+    } catch ( std::exception &e ) {
+      rb_raise( rb_eRuntimeError, "%s", e.what() );
+    };
+    // Raises an exception if the thread was killed or interrupted. Otherwise
+    // reading is resumed.
+    if ( rbRetVal == Qnil ) rb_thread_check_ints();
+  };
+  return rbRetVal;
+}
+
+VALUE DC1394Input::wrapTryRead( VALUE rbSelf )
+{
+  VALUE rbRetVal = Qnil;
+  try {
+    freeDeferred();
+    DC1394InputPtr *self; Data_Get_Struct( rbSelf, DC1394InputPtr, self );
+    FramePtr frame( (*self)->tryRead() );
+    if ( frame.get() != NULL ) rbRetVal = frame->rubyObject();
+  } catch ( std::exception &e ) {
+    rb_raise( rb_eRuntimeError, "%s", e.what() );
+  };
+  return rbRetVal;
+}
+
+VALUE DC1394Input::wrapFileno( VALUE rbSelf )
 {
   VALUE rbRetVal = Qnil;
   try {
     DC1394InputPtr *self; Data_Get_Struct( rbSelf, DC1394InputPtr, self );
-    FramePtr frame( (*self)->read() );
-    rbRetVal = frame->rubyObject();
+    rbRetVal = INT2NUM( (*self)->fileno() );
   } catch ( std::exception &e ) {
     rb_raise( rb_eRuntimeError, "%s", e.what() );
   };
   return rbRetVal;
 }
 
+VALUE DC1394Input::wrapLastFrameInfo( VALUE rbSelf )
+{
+  DC1394InputPtr *self; Data_Get_Struct( rbSelf, DC1394InputPtr, self );
+  const FrameInfo &info = (*self)->lastFrameInfo();
+  VALUE rbRetVal = rb_hash_new();
+  rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "timestamp" ) ),
+                ULL2NUM( info.timestamp ) );
+  rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "id" ) ), UINT2NUM( info.id ) );
+  rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "frames_behind" ) ),
+                UINT2NUM( info.framesBehind ) );
+  rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "queued" ) ), UINT2NUM( info.queued ) );
+  rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "packets_per_frame" ) ),
+                UINT2NUM( info.packetsPerFrame ) );
+  rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "corrupt" ) ),
+                info.corrupt ? Qtrue : Qfalse );
+  rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "trigger" ) ),
+                info.trigger > 0 ? UINT2NUM( info.trigger ) : Qnil );
+  rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "trigger_latency" ) ),
+                info.trigger > 0 ? ULL2NUM( info.triggerLatency ) : Qnil );
+  rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "command" ) ), UINT2NUM( info.command ) );
+  return rbRetVal;
+}
+
+VALUE DC1394Input::wrapStats( VALUE rbSelf )
+{
+  DC1394InputPtr *self; Data_Get_Struct( rbSelf, DC1394InputPtr, self );
+  return (*self)->stats().toRuby();
+}
+
+VALUE DC1394Input::wrapResetStats( VALUE rbSelf )
+{
+  DC1394InputPtr *self; Data_Get_Struct( rbSelf, DC1394InputPtr, self );
+  (*self)->resetStats();
+  return rbSelf;
+}
+
 VALUE DC1394Input::wrapStatus( VALUE rbSelf )
 {
   DC1394InputPtr *self; Data_Get_Struct( rbSelf, DC1394InputPtr, self );
   return (*self)->status() ? Qtrue : Qfalse;
 }
 
+VALUE DC1394Input::wrapAsyncStart( VALUE rbSelf, VALUE rbOrder )
+{
+  try {
+    DC1394InputPtr *self; Data_Get_Struct( rbSelf, DC1394InputPtr, self );
+    (*self)->asyncStart( (ReadOrder)NUM2INT( rbOrder ) );
+  } catch ( std::exception &e ) {
+    rb_raise( rb_eRuntimeError, "%s", e.what() );
+  };
+  return rbSelf;
+}
+
+VALUE DC1394Input::wrapAsyncStop( VALUE rbSelf )
+{
+  DC1394InputPtr *self; Data_Get_Struct( rbSelf, DC1394InputPtr, self );
+  (*self)->asyncStop();
+  return rbSelf;
+}
+
+VALUE DC1394Input::wrapAsync( VALUE rbSelf )
+{
+  DC1394InputPtr *self; Data_Get_Struct( rbSelf, DC1394InputPtr, self );
+  return (*self)->async() ? Qtrue : Qfalse;
+}
+
 VALUE DC1394Input::wrapWidth( VALUE rbSelf )
 {
   DC1394InputPtr *self; Data_Get_Struct( rbSelf, DC1394InputPtr, self );
@@ -488,6 +1518,266 @@ VALUE DC1394Input::wrapHeight( VALUE rbSelf )
   return INT2NUM((*self)->height());
 }
 
+VALUE DC1394Input::wrapNumBuffers( VALUE rbSelf )
+{
+  DC1394InputPtr *self; Data_Get_Struct( rbSelf, DC1394InputPtr, self );
+  return UINT2NUM((*self)->numBuffers());
+}
+
+VALUE DC1394Input::wrapFrameBytes( VALUE rbSelf )
+{
+  DC1394InputPtr *self; Data_Get_Struct( rbSelf, DC1394InputPtr, self );
+  return ULL2NUM((*self)->frameBytes());
+}
+
+VALUE DC1394Input::wrapDMABytes( VALUE rbSelf )
+{
+  DC1394InputPtr *self; Data_Get_Struct( rbSelf, DC1394InputPtr, self );
+  return ULL2NUM((*self)->dmaBytes());
+}
+
+VALUE DC1394Input::wrapSpareBuffers( VALUE rbSelf )
+{
+  DC1394InputPtr *self; Data_Get_Struct( rbSelf, DC1394InputPtr, self );
+  return UINT2NUM((*self)->spareBuffers());
+}
+
+VALUE DC1394Input::wrapSetSpareBuffers( VALUE rbSelf, VALUE rbSpareBuffers )
+{
+  try {
+    DC1394InputPtr *self; Data_Get_Struct( rbSelf, DC1394InputPtr, self );
+    (*self)->setSpareBuffers( NUM2UINT( rbSpareBuffers ) );
+  } catch ( std::exception &e ) {
+    rb_raise( rb_eRuntimeError, "%s", e.what() );
+  };
+  return rbSpareBuffers;
+}
+
+VALUE DC1394Input::wrapRaw( VALUE rbSelf )
+{
+  DC1394InputPtr *self; Data_Get_Struct( rbSelf, DC1394InputPtr, self );
+  return (*self)->raw() ? Qtrue : Qfalse;
+}
+
+VALUE DC1394Input::wrapBayerPattern( VALUE rbSelf )
+{
+  DC1394InputPtr *self; Data_Get_Struct( rbSelf, DC1394InputPtr, self );
+  return INT2NUM((*self)->bayerPattern());
+}
+
+VALUE DC1394Input::wrapSetBayerPattern( VALUE rbSelf, VALUE rbPattern )
+{
+  try {
+    DC1394InputPtr *self; Data_Get_Struct( rbSelf, DC1394InputPtr, self );
+    (*self)->setBayerPattern( (dc1394color_filter_t)NUM2INT( rbPattern ) );
+  } catch ( std::exception &e ) {
+    rb_raise( rb_eRuntimeError, "%s", e.what() );
+  };
+  return rbPattern;
+}
+
+VALUE DC1394Input::wrapDemosaic( VALUE rbSelf )
+{
+  DC1394InputPtr *self; Data_Get_Struct( rbSelf, DC1394InputPtr, self );
+  return INT2NUM((*self)->demosaic());
+}
+
+VALUE DC1394Input::wrapSetDemosaic( VALUE rbSelf, VALUE rbMethod )
+{
+  try {
+    DC1394InputPtr *self; Data_Get_Struct( rbSelf, DC1394InputPtr, self );
+    (*self)->setDemosaic( (DC1394Bayer::Method)NUM2INT( rbMethod ) );
+  } catch ( std::exception &e ) {
+    rb_raise( rb_eRuntimeError, "%s", e.what() );
+  };
+  return rbMethod;
+}
+
+VALUE DC1394Input::wrapFormat7( VALUE rbSelf )
+{
+  DC1394InputPtr *self; Data_Get_Struct( rbSelf, DC1394InputPtr, self );
+  return (*self)->format7() ? Qtrue : Qfalse;
+}
+
+VALUE DC1394Input::wrapFormat7Read( VALUE rbSelf )
+{
+  VALUE rbRetVal = Qnil;
+  try {
+    DC1394InputPtr *self; Data_Get_Struct( rbSelf, DC1394InputPtr, self );
+    Format7Info info( (*self)->format7Read() );
+    VALUE rbCodings = rb_ary_new();
+    for ( unsigned int i=0; i<info.codings.size(); i++ )
+      rb_ary_push( rbCodings, INT2NUM( info.codings[i] ) );
+    rbRetVal = rb_hash_new();
+    rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "left" ) ), UINT2NUM( info.left ) );
+    rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "top" ) ), UINT2NUM( info.top ) );
+    rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "width" ) ), UINT2NUM( info.width ) );
+    rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "height" ) ), UINT2NUM( info.height ) );
+    rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "max_width" ) ),
+                  UINT2NUM( info.maxWidth ) );
+    rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "max_height" ) ),
+                  UINT2NUM( info.maxHeight ) );
+    rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "unit_width" ) ),
+                  UINT2NUM( info.unitWidth ) );
+    rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "unit_height" ) ),
+                  UINT2NUM( info.unitHeight ) );
+    rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "unit_left" ) ),
+                  UINT2NUM( info.unitLeft ) );
+    rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "unit_top" ) ),
+                  UINT2NUM( info.unitTop ) );
+    rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "packet_size" ) ),
+                  UINT2NUM( info.packetSize ) );
+    rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "unit_bytes" ) ),
+                  UINT2NUM( info.unitBytes ) );
+    rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "max_bytes" ) ),
+                  UINT2NUM( info.maxBytes ) );
+    rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "total_bytes" ) ),
+                  ULL2NUM( info.totalBytes ) );
+    rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "coding" ) ), INT2NUM( info.coding ) );
+    rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "codings" ) ), rbCodings );
+    rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "frame_rate" ) ),
+                  info.frameInterval > 0 ? rb_float_new( 1.0 / info.frameInterval ) :
+                  Qnil );
+  } catch ( std::exception &e ) {
+    rb_raise( rb_eRuntimeError, "%s", e.what() );
+  };
+  return rbRetVal;
+}
+
+VALUE DC1394Input::wrapFormat7Write( VALUE rbSelf, VALUE rbCoding, VALUE rbPacketSize,
+                                     VALUE rbLeft, VALUE rbTop, VALUE rbWidth,
+                                     VALUE rbHeight )
+{
+  try {
+    DC1394InputPtr *self; Data_Get_Struct( rbSelf, DC1394InputPtr, self );
+    (*self)->format7Write( (dc1394color_coding_t)NUM2INT( rbCoding ),
+                           NUM2INT( rbPacketSize ), NUM2UINT( rbLeft ),
+                           NUM2UINT( rbTop ), NUM2UINT( rbWidth ),
+                           NUM2UINT( rbHeight ) );
+  } catch ( std::exception &e ) {
+    rb_raise( rb_eRuntimeError, "%s", e.what() );
+  };
+  return rbSelf;
+}
+
+VALUE DC1394Input::wrapOutput( VALUE rbSelf )
+{
+  DC1394InputPtr *self; Data_Get_Struct( rbSelf, DC1394InputPtr, self );
+  return (*self)->output();
+}
+
+VALUE DC1394Input::wrapSetOutput( VALUE rbSelf, VALUE rbTypecode )
+{
+  try {
+    DC1394InputPtr *self; Data_Get_Struct( rbSelf, DC1394InputPtr, self );
+    VALUE rbString = rb_funcall( rbTypecode, rb_intern( "to_s" ), 0 );
+    (*self)->setOutput( StringValuePtr( rbString ) );
+  } catch ( std::exception &e ) {
+    rb_raise( rb_eRuntimeError, "%s", e.what() );
+  };
+  return rbTypecode;
+}
+
+VALUE DC1394Input::wrapLeased( VALUE rbSelf )
+{
+  DC1394InputPtr *self; Data_Get_Struct( rbSelf, DC1394InputPtr, self );
+  return UINT2NUM((*self)->leased());
+}
+
+VALUE DC1394Input::wrapGUID( VALUE rbSelf )
+{
+  DC1394InputPtr *self; Data_Get_Struct( rbSelf, DC1394InputPtr, self );
+  return ULL2NUM((*self)->guid());
+}
+
+VALUE DC1394Input::wrapUnit( VALUE rbSelf )
+{
+  DC1394InputPtr *self; Data_Get_Struct( rbSelf, DC1394InputPtr, self );
+  return INT2NUM((*self)->unit());
+}
+
+VALUE DC1394Input::wrapSpeed( VALUE rbSelf )
+{
+  DC1394InputPtr *self; Data_Get_Struct( rbSelf, DC1394InputPtr, self );
+  return INT2NUM((*self)->speed());
+}
+
+VALUE DC1394Input::wrapBMode( VALUE rbSelf )
+{
+  DC1394InputPtr *self; Data_Get_Struct( rbSelf, DC1394InputPtr, self );
+  return (*self)->operationMode() == DC1394_OPERATION_MODE_1394B ? Qtrue : Qfalse;
+}
+
+VALUE DC1394Input::wrapBandwidth( VALUE rbSelf )
+{
+  VALUE rbRetVal = Qnil;
+  try {
+    DC1394InputPtr *self; Data_Get_Struct( rbSelf, DC1394InputPtr, self );
+    rbRetVal = UINT2NUM((*self)->bandwidth());
+  } catch ( std::exception &e ) {
+    rb_raise( rb_eRuntimeError, "%s", e.what() );
+  };
+  return rbRetVal;
+}
+
+VALUE DC1394Input::wrapTriggerRead( VALUE rbSelf )
+{
+  VALUE rbRetVal = Qnil;
+  try {
+    DC1394InputPtr *self; Data_Get_Struct( rbSelf, DC1394InputPtr, self );
+    TriggerInfo info( (*self)->triggerRead() );
+    VALUE rbSources = rb_ary_new();
+    for ( vector< dc1394trigger_source_t >::const_iterator i = info.sources.begin();
+          i != info.sources.end(); i++ )
+      rb_ary_push( rbSources, INT2NUM( *i ) );
+    VALUE rbModes = rb_ary_new();
+    for ( vector< dc1394trigger_mode_t >::const_iterator i = info.modes.begin();
+          i != info.modes.end(); i++ )
+      rb_ary_push( rbModes, INT2NUM( *i ) );
+    rbRetVal = rb_hash_new();
+    rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "enabled" ) ),
+                  info.enabled ? Qtrue : Qfalse );
+    rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "source" ) ), INT2NUM( info.source ) );
+    rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "mode" ) ), INT2NUM( info.mode ) );
+    rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "polarity" ) ),
+                  INT2NUM( info.polarity ) );
+    rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "polarity_capable" ) ),
+                  info.polarityCapable ? Qtrue : Qfalse );
+    rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "sources" ) ), rbSources );
+    rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "modes" ) ), rbModes );
+  } catch ( std::exception &e ) {
+    rb_raise( rb_eRuntimeError, "%s", e.what() );
+  };
+  return rbRetVal;
+}
+
+VALUE DC1394Input::wrapTriggerWrite( VALUE rbSelf, VALUE rbEnabled, VALUE rbSource,
+                                     VALUE rbMode, VALUE rbPolarity )
+{
+  try {
+    DC1394InputPtr *self; Data_Get_Struct( rbSelf, DC1394InputPtr, self );
+    (*self)->triggerWrite( RTEST( rbEnabled ),
+                           (dc1394trigger_source_t)NUM2INT( rbSource ),
+                           (dc1394trigger_mode_t)NUM2INT( rbMode ),
+                           (dc1394trigger_polarity_t)NUM2INT( rbPolarity ) );
+  } catch ( std::exception &e ) {
+    rb_raise( rb_eRuntimeError, "%s", e.what() );
+  };
+  return rbSelf;
+}
+
+VALUE DC1394Input::wrapSoftwareTrigger( VALUE rbSelf )
+{
+  VALUE rbRetVal = Qnil;
+  try {
+    DC1394InputPtr *self; Data_Get_Struct( rbSelf, DC1394InputPtr, self );
+    rbRetVal = UINT2NUM( (*self)->softwareTrigger() );
+  } catch ( std::exception &e ) {
+    rb_raise( rb_eRuntimeError, "%s", e.what() );
+  };
+  return rbRetVal;
+}
+
 VALUE DC1394Input::wrapFeatureGetValue( VALUE rbSelf, VALUE rbFeature )
 {
   VALUE rbRetVal = Qnil;
@@ -510,6 +1800,8 @@ VALUE DC1394Input::wrapFeatureSetValue( VALUE rbSelf, VALUE rbFeature, VALUE rbV
   } catch ( std::exception &e ) {
     rb_raise( rb_eRuntimeError, "%s", e.what() );
   };
+  // Wait until the control thread has written the value.
+  wrapFeatureFlush( rbSelf );
   return rbValue;
 }
 
@@ -576,6 +1868,8 @@ VALUE DC1394Input::wrapFeatureSetPower( VALUE rbSelf, VALUE rbFeature, VALUE rbV
   } catch ( std::exception &e ) {
     rb_raise( rb_eRuntimeError, "%s", e.what() );
   };
+  // Wait until the control thread has written the value.
+  wrapFeatureFlush( rbSelf );
   return rbValue;
 }
 
@@ -617,6 +1911,8 @@ VALUE DC1394Input::wrapFeatureModeSet( VALUE rbSelf, VALUE rbFeature, VALUE rbMo
   } catch ( std::exception &e ) {
     rb_raise( rb_eRuntimeError, "%s", e.what() );
   };
+  // Wait until the control thread has written the value.
+  wrapFeatureFlush( rbSelf );
   return rbMode;
 }
 
@@ -646,4 +1942,145 @@ VALUE DC1394Input::wrapFeatureMax( VALUE rbSelf, VALUE rbFeature )
   return rbRetVal;
 }
 
+VALUE DC1394Input::wrapFeatureWriteAsync( VALUE rbSelf, VALUE rbFeature,
+                                          VALUE rbValue )
+{
+  VALUE rbRetVal = Qnil;
+  try {
+    DC1394InputPtr *self; Data_Get_Struct( rbSelf, DC1394InputPtr, self );
+    rbRetVal = UINT2NUM( (*self)->featureSubmit( (dc1394feature_t)NUM2INT( rbFeature ),
+                                                 DC1394Control::SET_VALUE,
+                                                 NUM2UINT( rbValue ) ) );
+  } catch ( std::exception &e ) {
+    rb_raise( rb_eRuntimeError, "%s", e.what() );
+  };
+  return rbRetVal;
+}
+
+VALUE DC1394Input::wrapFeatureOnAsync( VALUE rbSelf, VALUE rbFeature, VALUE rbValue )
+{
+  VALUE rbRetVal = Qnil;
+  try {
+    DC1394InputPtr *self; Data_Get_Struct( rbSelf, DC1394InputPtr, self );
+    rbRetVal = UINT2NUM( (*self)->featureSubmit( (dc1394feature_t)NUM2INT( rbFeature ),
+                                                 DC1394Control::SET_POWER,
+                                                 rbValue == Qtrue ? DC1394_ON :
+                                                 DC1394_OFF ) );
+  } catch ( std::exception &e ) {
+    rb_raise( rb_eRuntimeError, "%s", e.what() );
+  };
+  return rbRetVal;
+}
+
+VALUE DC1394Input::wrapFeatureModeWriteAsync( VALUE rbSelf, VALUE rbFeature,
+                                              VALUE rbMode )
+{
+  VALUE rbRetVal = Qnil;
+  try {
+    DC1394InputPtr *self; Data_Get_Struct( rbSelf, DC1394InputPtr, self );
+    rbRetVal = UINT2NUM( (*self)->featureSubmit( (dc1394feature_t)NUM2INT( rbFeature ),
+                                                 DC1394Control::SET_MODE,
+                                                 NUM2UINT( rbMode ) ) );
+  } catch ( std::exception &e ) {
+    rb_raise( rb_eRuntimeError, "%s", e.what() );
+  };
+  return rbRetVal;
+}
+
+VALUE DC1394Input::wrapFeatureFlush( VALUE rbSelf )
+{
+  bool done = false;
+  while ( !done ) {
+    try {
+      DC1394InputPtr *self; Data_Get_Struct( rbSelf, DC1394InputPtr, self );
+      done = (*self)->featureFlush();
+    } catch ( std::exception &e ) {
+      rb_raise( rb_eRuntimeError, "%s", e.what() );
+    };
+    // Raises an exception if the thread was killed or interrupted.
+    if ( !done ) rb_thread_check_ints();
+  };
+  return rbSelf;
+}
 
+VALUE DC1394Input::wrapAutoExposureStart( VALUE rbSelf, VALUE rbOptions )
+{
+  try {
+    DC1394InputPtr *self; Data_Get_Struct( rbSelf, DC1394InputPtr, self );
+    (*self)->exposureStart( rbOptions );
+  } catch ( std::exception &e ) {
+    rb_raise( rb_eRuntimeError, "%s", e.what() );
+  };
+  return rbSelf;
+}
+
+VALUE DC1394Input::wrapAutoExposureStop( VALUE rbSelf )
+{
+  DC1394InputPtr *self; Data_Get_Struct( rbSelf, DC1394InputPtr, self );
+  (*self)->exposureStop();
+  return rbSelf;
+}
+
+VALUE DC1394Input::wrapAutoExposure( VALUE rbSelf )
+{
+  DC1394InputPtr *self; Data_Get_Struct( rbSelf, DC1394InputPtr, self );
+  boost::shared_ptr< DC1394Exposure > exposure( (*self)->exposure() );
+  return exposure ? exposure->toRuby() : Qnil;
+}
+
+VALUE DC1394Input::wrapFeatures( VALUE rbSelf )
+{
+  VALUE rbRetVal = Qnil;
+  try {
+    DC1394InputPtr *self; Data_Get_Struct( rbSelf, DC1394InputPtr, self );
+    const dc1394featureset_t &features = (*self)->features();
+    rbRetVal = rb_hash_new();
+    for ( int i=0; i<DC1394_FEATURE_NUM; i++ ) {
+      const dc1394feature_info_t &info = features.feature[i];
+      if ( info.available == DC1394_FALSE ) continue;
+      VALUE rbModes = rb_ary_new();
+      for ( unsigned int j=0; j<info.modes.num; j++ )
+        rb_ary_push( rbModes, INT2NUM( info.modes.modes[j] ) );
+      VALUE rbFeature = rb_hash_new();
+      rb_hash_aset( rbFeature, ID2SYM( rb_intern( "readable" ) ),
+                    info.readout_capable != DC1394_FALSE ? Qtrue : Qfalse );
+      rb_hash_aset( rbFeature, ID2SYM( rb_intern( "switchable" ) ),
+                    info.on_off_capable != DC1394_FALSE ? Qtrue : Qfalse );
+      rb_hash_aset( rbFeature, ID2SYM( rb_intern( "on" ) ),
+                    info.is_on != DC1394_OFF ? Qtrue : Qfalse );
+      rb_hash_aset( rbFeature, ID2SYM( rb_intern( "modes" ) ), rbModes );
+      rb_hash_aset( rbFeature, ID2SYM( rb_intern( "mode" ) ),
+                    INT2NUM( info.current_mode ) );
+      rb_hash_aset( rbFeature, ID2SYM( rb_intern( "min" ) ), UINT2NUM( info.min ) );
+      rb_hash_aset( rbFeature, ID2SYM( rb_intern( "max" ) ), UINT2NUM( info.max ) );
+      rb_hash_aset( rbFeature, ID2SYM( rb_intern( "value" ) ),
+                    UINT2NUM( info.value ) );
+      VALUE rbAbsolute = Qnil;
+      if ( info.absolute_capable != DC1394_FALSE ) {
+        rbAbsolute = rb_hash_new();
+        rb_hash_aset( rbAbsolute, ID2SYM( rb_intern( "min" ) ),
+                      rb_float_new( info.abs_min ) );
+        rb_hash_aset( rbAbsolute, ID2SYM( rb_intern( "max" ) ),
+                      rb_float_new( info.abs_max ) );
+        rb_hash_aset( rbAbsolute, ID2SYM( rb_intern( "value" ) ),
+                      rb_float_new( info.abs_value ) );
+      };
+      rb_hash_aset( rbFeature, ID2SYM( rb_intern( "absolute" ) ), rbAbsolute );
+      rb_hash_aset( rbRetVal, INT2NUM( info.id ), rbFeature );
+    };
+  } catch ( std::exception &e ) {
+    rb_raise( rb_eRuntimeError, "%s", e.what() );
+  };
+  return rbRetVal;
+}
+
+VALUE DC1394Input::wrapRefreshFeatures( VALUE rbSelf )
+{
+  try {
+    DC1394InputPtr *self; Data_Get_Struct( rbSelf, DC1394InputPtr, self );
+    (*self)->refreshFeatures();
+  } catch ( std::exception &e ) {
+    rb_raise( rb_eRuntimeError, "%s", e.what() );
+  };
+  return rbSelf;
+}
@@ -17,24 +17,126 @@
 #define HORNETSEYE_DC1394INPUT_HH
 
 #include <errno.h>
+#include <pthread.h>
+#include <deque>
+#include <vector>
+#include <boost/atomic.hpp>
+#include <boost/lockfree/spsc_queue.hpp>
 #include "error.hh"
 #include "dc1394.hh"
+#include "dc1394control.hh"
+#include "dc1394convert.hh"
+#include "dc1394exposure.hh"
 #include "dc1394select.hh"
+#include "dc1394stats.hh"
 #include "frame.hh"
 
-class DC1394Input
+class DC1394Input: public boost::enable_shared_from_this< DC1394Input >
 {
 public:
-  DC1394Input( DC1394Ptr dc1394, unsigned int node, dc1394speed_t speed,
+  enum ReadOrder { READ_OLDEST = 0, READ_NEWEST };
+  struct FrameInfo
+  {
+    uint64_t timestamp;
+    uint32_t id;
+    uint32_t framesBehind;
+    uint32_t queued;
+    uint32_t packetsPerFrame;
+    bool corrupt;
+    // Number of the software trigger which produced the frame (0 if unknown).
+    uint32_t trigger;
+    uint64_t triggerLatency;
+    // Serial number of the most recent asynchronous feature write in effect.
+    uint32_t command;
+  };
+  struct TriggerInfo
+  {
+    bool enabled;
+    dc1394trigger_source_t source;
+    dc1394trigger_mode_t mode;
+    dc1394trigger_polarity_t polarity;
+    bool polarityCapable;
+    std::vector< dc1394trigger_source_t > sources;
+    std::vector< dc1394trigger_mode_t > modes;
+  };
+  struct Format7Info
+  {
+    uint32_t left;
+    uint32_t top;
+    uint32_t width;
+    uint32_t height;
+    uint32_t maxWidth;
+    uint32_t maxHeight;
+    uint32_t unitWidth;
+    uint32_t unitHeight;
+    uint32_t unitLeft;
+    uint32_t unitTop;
+    uint32_t packetSize;
+    uint32_t unitBytes;
+    uint32_t maxBytes;
+    uint64_t totalBytes;
+    float frameInterval;
+    dc1394color_coding_t coding;
+    std::vector< dc1394color_coding_t > codings;
+  };
+  DC1394Input( DC1394Ptr dc1394, uint64_t guid, int unit, dc1394speed_t speed,
                DC1394SelectPtr select, bool forceFrameRate,
-               dc1394framerate_t frameRate ) throw (Error);
+               dc1394framerate_t frameRate, unsigned int numBuffers,
+               uint32_t flags ) throw (Error);
   virtual ~DC1394Input(void);
-  void close(void);
+  void close( bool keepPowered = false );
   FramePtr read(void) throw (Error);
+  FramePtr tryRead(void) throw (Error);
+  int fileno(void) throw (Error);
   bool status(void) const;
+  DC1394Ptr dc1394(void) const { return m_dc1394; }
+  uint64_t guid(void) const { return m_guid; }
+  int unit(void) const { return m_unit; }
+  uint32_t bandwidth(void) throw (Error);
+  dc1394speed_t speed(void) const { return m_speed; }
+  dc1394operation_mode_t operationMode(void) const { return m_operationMode; }
+  const FrameInfo &lastFrameInfo(void) const { return m_info; }
+  uint64_t timestamp(void) const { return m_info.timestamp; }
+  const DC1394Stats &stats(void) const { return m_stats; }
+  void resetStats(void) { m_stats.reset(); }
+  void asyncStart( ReadOrder order ) throw (Error);
+  void asyncStop(void);
+  bool async(void) const { return m_async; }
   std::string inspect(void) const;
   int width(void) const { return m_width; }
   int height(void) const { return m_height; }
+  unsigned int numBuffers(void) const { return m_numBuffers; }
+  size_t frameBytes(void) const { return m_frameBytes; }
+  size_t dmaBytes(void) const { return m_frameBytes * m_numBuffers; }
+  unsigned int spareBuffers(void) const { return m_spareBuffers; }
+  void setSpareBuffers( unsigned int spareBuffers ) throw (Error);
+  unsigned int leased(void) const { return m_leased; }
+  void unlease( dc1394video_frame_t *frame );
+  static bool postpone(void);
+  static void defer( boost::shared_ptr< DC1394Input > input );
+  static void freeDeferred( bool atExit = false );
+  bool raw(void) const
+  {
+    return m_coding == DC1394_COLOR_CODING_RAW8 || m_coding == DC1394_COLOR_CODING_RAW16;
+  }
+  dc1394color_filter_t bayerPattern(void) const { return m_convert.bayerPattern(); }
+  void setBayerPattern( dc1394color_filter_t pattern ) throw (Error)
+  { m_convert.setBayerPattern( pattern ); }
+  DC1394Bayer::Method demosaic(void) const { return m_convert.demosaic(); }
+  void setDemosaic( DC1394Bayer::Method method ) throw (Error)
+  { m_convert.setDemosaic( method ); }
+  bool format7(void) const { return dc1394_is_video_mode_scalable( m_videoMode ); }
+  Format7Info format7Read(void) throw (Error);
+  void format7Write( dc1394color_coding_t coding, int packetSize, unsigned int left,
+                     unsigned int top, unsigned int width, unsigned int height )
+    throw (Error);
+  VALUE output(void) const { return m_rbTypecode; }
+  void setOutput( const std::string &typecode ) throw (Error);
+  TriggerInfo triggerRead(void) throw (Error);
+  void triggerWrite( bool enabled, dc1394trigger_source_t source,
+                     dc1394trigger_mode_t mode, dc1394trigger_polarity_t polarity )
+    throw (Error);
+  uint32_t softwareTrigger(void) throw (Error);
   unsigned int featureGetValue( dc1394feature_t feature ) throw (Error);
   void featureSetValue( dc1394feature_t feature, unsigned int value ) throw (Error);
   bool featureIsPresent( dc1394feature_t feature ) throw (Error);
@@ -48,16 +150,62 @@ public:
     throw (Error);
   unsigned int featureMin( dc1394feature_t feature ) throw (Error);
   unsigned int featureMax( dc1394feature_t feature ) throw (Error);
+  uint32_t featureSubmit( dc1394feature_t feature, DC1394Control::Command command,
+                         uint32_t value ) throw (Error);
+  bool featureFlush(void) throw (Error);
+  void exposureStart( VALUE rbOptions ) throw (Error);
+  void exposureStop(void) { m_exposure.reset(); }
+  boost::shared_ptr< DC1394Exposure > exposure(void) const { return m_exposure; }
+  const dc1394featureset_t &features(void) throw (Error);
+  void refreshFeatures(void) throw (Error);
   static VALUE cRubyClass;
+  void markRubyMember(void);
   static VALUE registerRubyClass( VALUE module );
+  static void markRubyObject( void *ptr );
   static void deleteRubyObject( void *ptr );
   static VALUE wrapNew( VALUE rbClass, VALUE rbDC1394, VALUE rbNode, VALUE rbSpeed,
-                        VALUE rbForceFrameRate, VALUE rbFrameRate );
-  static VALUE wrapClose( VALUE rbSelf );
+                        VALUE rbForceFrameRate, VALUE rbFrameRate, VALUE rbNumBuffers,
+                        VALUE rbFlags, VALUE rbPolicy );
+  static VALUE wrapClose( VALUE rbSelf, VALUE rbKeepPowered );
   static VALUE wrapRead( VALUE rbSelf );
+  static VALUE wrapTryRead( VALUE rbSelf );
+  static VALUE wrapFileno( VALUE rbSelf );
+  static VALUE wrapLastFrameInfo( VALUE rbSelf );
+  static VALUE wrapStats( VALUE rbSelf );
+  static VALUE wrapResetStats( VALUE rbSelf );
   static VALUE wrapStatus( VALUE rbSelf );
+  static VALUE wrapAsyncStart( VALUE rbSelf, VALUE rbOrder );
+  static VALUE wrapAsyncStop( VALUE rbSelf );
+  static VALUE wrapAsync( VALUE rbSelf );
   static VALUE wrapWidth( VALUE rbSelf );
   static VALUE wrapHeight( VALUE rbSelf );
+  static VALUE wrapNumBuffers( VALUE rbSelf );
+  static VALUE wrapFrameBytes( VALUE rbSelf );
+  static VALUE wrapDMABytes( VALUE rbSelf );
+  static VALUE wrapSpareBuffers( VALUE rbSelf );
+  static VALUE wrapSetSpareBuffers( VALUE rbSelf, VALUE rbSpareBuffers );
+  static VALUE wrapLeased( VALUE rbSelf );
+  static VALUE wrapGUID( VALUE rbSelf );
+  static VALUE wrapUnit( VALUE rbSelf );
+  static VALUE wrapBandwidth( VALUE rbSelf );
+  static VALUE wrapSpeed( VALUE rbSelf );
+  static VALUE wrapBMode( VALUE rbSelf );
+  static VALUE wrapRaw( VALUE rbSelf );
+  static VALUE wrapBayerPattern( VALUE rbSelf );
+  static VALUE wrapSetBayerPattern( VALUE rbSelf, VALUE rbPattern );
+  static VALUE wrapDemosaic( VALUE rbSelf );
+  static VALUE wrapSetDemosaic( VALUE rbSelf, VALUE rbMethod );
+  static VALUE wrapFormat7( VALUE rbSelf );
+  static VALUE wrapFormat7Read( VALUE rbSelf );
+  static VALUE wrapFormat7Write( VALUE rbSelf, VALUE rbCoding, VALUE rbPacketSize,
+                                 VALUE rbLeft, VALUE rbTop, VALUE rbWidth,
+                                 VALUE rbHeight );
+  static VALUE wrapOutput( VALUE rbSelf );
+  static VALUE wrapSetOutput( VALUE rbSelf, VALUE rbTypecode );
+  static VALUE wrapTriggerRead( VALUE rbSelf );
+  static VALUE wrapTriggerWrite( VALUE rbSelf, VALUE rbEnabled, VALUE rbSource,
+                                 VALUE rbMode, VALUE rbPolarity );
+  static VALUE wrapSoftwareTrigger( VALUE rbSelf );
   static VALUE wrapFeatureGetValue( VALUE rbSelf, VALUE rbFeature );
   static VALUE wrapFeatureSetValue( VALUE rbSelf, VALUE rbFeature, VALUE rbValue );
   static VALUE wrapFeatureIsPresent( VALUE rbSelf, VALUE rbFeature );
@@ -70,14 +218,98 @@ public:
   static VALUE wrapFeatureModeSet( VALUE rbSelf, VALUE rbFeature, VALUE rbMode );
   static VALUE wrapFeatureMin( VALUE rbSelf, VALUE rbFeature );
   static VALUE wrapFeatureMax( VALUE rbSelf, VALUE rbFeature );
+  static VALUE wrapFeatureWriteAsync( VALUE rbSelf, VALUE rbFeature, VALUE rbValue );
+  static VALUE wrapFeatureOnAsync( VALUE rbSelf, VALUE rbFeature, VALUE rbValue );
+  static VALUE wrapFeatureModeWriteAsync( VALUE rbSelf, VALUE rbFeature,
+                                          VALUE rbMode );
+  static VALUE wrapFeatureFlush( VALUE rbSelf );
+  static VALUE wrapAutoExposureStart( VALUE rbSelf, VALUE rbOptions );
+  static VALUE wrapAutoExposureStop( VALUE rbSelf );
+  static VALUE wrapAutoExposure( VALUE rbSelf );
+  static VALUE wrapFeatures( VALUE rbSelf );
+  static VALUE wrapRefreshFeatures( VALUE rbSelf );
 protected:
+  typedef boost::lockfree::spsc_queue< dc1394video_frame_t * > FrameQueue;
+  void setupCapture(void) throw (Error);
+  void format7Apply( dc1394color_coding_t coding, int packetSize, unsigned int left,
+                     unsigned int top, unsigned int width, unsigned int height )
+    throw (Error);
+  void negotiateSpeed( dc1394speed_t speed ) throw (Error);
+  dc1394video_frame_t *dequeue( bool block ) throw (Error);
+  dc1394video_frame_t *pop( bool block ) throw (Error);
+  FramePtr wrap( dc1394video_frame_t *frame ) throw (Error);
+  void release( dc1394video_frame_t *frame );
+  void exposureSubmit(void);
+  bool swapped(void) const;
+  void freeCamera(void);
+  dc1394feature_info_t &featureInfo( dc1394feature_t feature ) throw (Error);
+  void featureUpdate( int feature, DC1394Control::Command command, uint32_t value );
+  bool wait( int fd ) throw (Error);
+  void capture(void);
+  static void swapStripe( void *data, int begin, int end );
+  static void copyStripe( void *data, int begin, int end );
+  static void *waitWithoutGVL( void *ptr );
+  static void interruptWait( void *ptr );
+  static void *captureThread( void *ptr );
+  // Cameras released by the garbage collector and not freed yet.
+  static std::vector< boost::shared_ptr< DC1394Input > > deferred;
+  static bool exiting;
   DC1394Ptr m_dc1394;
-  int m_node;
+  // The backend stays alive until the camera is freed.
+  DC1394BackendPtr m_backend;
+  uint64_t m_guid;
+  int m_unit;
   dc1394camera_t *m_camera;
-  dc1394video_frame_t *m_frame;
+  dc1394camera_t *m_detached;
+  bool m_keepPowered;
+  dc1394speed_t m_speed;
+  dc1394operation_mode_t m_operationMode;
+  dc1394video_mode_t m_videoMode;
+  uint32_t m_flags;
+  FrameInfo m_info;
   std::string m_typecode;
+  VALUE m_rbTypecode;
+  int m_storageSize;
   unsigned int m_width;
   unsigned int m_height;
+  unsigned int m_numBuffers;
+  size_t m_frameBytes;
+  dc1394color_coding_t m_coding;
+  DC1394Convert m_convert;
+  unsigned int m_spareBuffers;
+  unsigned int m_leased;
+  unsigned int m_queued;
+  DC1394Stats m_stats;
+  bool m_triggered;
+  uint32_t m_triggerCount;
+  // Number and time of software triggers not paired with a frame yet.
+  std::deque< std::pair< uint32_t, uint64_t > > m_triggers;
+  int m_wakeup[2];
+  int m_waitFd;
+  int m_waitError;
+  // Set if the thread was interrupted while waiting without the GVL.
+  boost::atomic< bool > m_interrupted;
+  bool m_async;
+  ReadOrder m_order;
+  pthread_t m_thread;
+  boost::shared_ptr< FrameQueue > m_ready;
+  boost::shared_ptr< FrameQueue > m_done;
+  int m_notify[2];
+  int m_resume[2];
+  boost::atomic< bool > m_quit;
+  boost::atomic< int > m_captureError;
+  // Snapshot of all features. The capabilities do not change while the camera
+  // is open. Values are updated by completed writes and by refreshing the
+  // snapshot. A capture error such as a bus reset invalidates the snapshot.
+  dc1394featureset_t m_features;
+  bool m_featuresValid;
+  // Serialises register transactions of this thread and the control thread.
+  pthread_mutex_t m_bus;
+  // Created when the first feature write is submitted.
+  DC1394ControlPtr m_control;
+  boost::shared_ptr< DC1394Exposure > m_exposure;
+  // Serial number of the last write of the exposure control.
+  uint32_t m_exposureCommand;
 };
 
 typedef boost::shared_ptr< DC1394Input > DC1394InputPtr;
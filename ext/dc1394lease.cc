@@ -0,0 +1,88 @@
+/* HornetsEye - Computer Vision with Ruby
+ Copyright (C) 2006, 2007, 2008, 2009, 2010 Jan Wedekind
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "rubyinc.hh"
+#include "dc1394input.hh"
+#include "dc1394lease.hh"
+
+using namespace boost;
+using namespace std;
+
+VALUE DC1394Lease::cRubyClass = Qnil;
+
+DC1394Lease::DC1394Lease( DC1394InputPtr input,
+                          dc1394video_frame_t *frame ):
+  m_input( input ), m_frame( frame )
+{
+}
+
+DC1394Lease::~DC1394Lease(void)
+{
+  release();
+}
+
+void DC1394Lease::release(void)
+{
+  if ( m_frame != NULL ) {
+    m_input->unlease( m_frame );
+    m_frame = NULL;
+    // The garbage collector only returns the buffer. The camera is freed later.
+    if ( DC1394Input::postpone() ) DC1394Input::defer( m_input );
+    m_input.reset();
+  };
+}
+
+void DC1394Lease::release( FramePtr frame )
+{
+  VALUE rbMemory = rb_funcall( frame->rubyObject(), rb_intern( "memory" ), 0 );
+  VALUE rbOwner = rb_ivar_get( rbMemory, rb_intern( "@owner" ) );
+  if ( rb_obj_is_kind_of( rbOwner, cRubyClass ) ) {
+    DC1394Lease *lease; Data_Get_Struct( rbOwner, DC1394Lease, lease );
+    lease->release();
+  };
+}
+
+VALUE DC1394Lease::registerRubyClass( VALUE module )
+{
+  cRubyClass = rb_define_class_under( module, "DC1394Lease", rb_cObject );
+  rb_undef_alloc_func( cRubyClass );
+  rb_define_method( cRubyClass, "release", RUBY_METHOD_FUNC( wrapRelease ), 0 );
+  rb_define_method( cRubyClass, "released?", RUBY_METHOD_FUNC( wrapReleased ), 0 );
+  return cRubyClass;
+}
+
+void DC1394Lease::deleteRubyObject( void *ptr )
+{
+  delete (DC1394Lease *)ptr;
+}
+
+VALUE DC1394Lease::wrap( DC1394Lease *lease )
+{
+  return Data_Wrap_Struct( cRubyClass, 0, deleteRubyObject, lease );
+}
+
+VALUE DC1394Lease::wrapRelease( VALUE rbSelf )
+{
+  DC1394Lease *self; Data_Get_Struct( rbSelf, DC1394Lease, self );
+  self->release();
+  return rbSelf;
+}
+
+VALUE DC1394Lease::wrapReleased( VALUE rbSelf )
+{
+  DC1394Lease *self; Data_Get_Struct( rbSelf, DC1394Lease, self );
+  return self->released() ? Qtrue : Qfalse;
+}
+
@@ -0,0 +1,47 @@
+/* HornetsEye - Computer Vision with Ruby
+   Copyright (C) 2006, 2007, 2008, 2009, 2010 Jan Wedekind
+   
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef HORNETSEYE_DC1394LEASE_HH
+#define HORNETSEYE_DC1394LEASE_HH
+
+#include <boost/smart_ptr.hpp>
+#include <dc1394/dc1394.h>
+#include "rubyinc.hh"
+#include "frame.hh"
+
+class DC1394Input;
+
+// Keeps a DMA buffer away from the camera while a Ruby frame refers to it.
+class DC1394Lease
+{
+public:
+  DC1394Lease( boost::shared_ptr< DC1394Input > input, dc1394video_frame_t *frame );
+  virtual ~DC1394Lease(void);
+  void release(void);
+  bool released(void) const { return m_frame == NULL; }
+  static void release( FramePtr frame );
+  static VALUE cRubyClass;
+  static VALUE registerRubyClass( VALUE module );
+  static void deleteRubyObject( void *ptr );
+  static VALUE wrap( DC1394Lease *lease );
+  static VALUE wrapRelease( VALUE rbSelf );
+  static VALUE wrapReleased( VALUE rbSelf );
+protected:
+  boost::shared_ptr< DC1394Input > m_input;
+  dc1394video_frame_t *m_frame;
+};
+
+#endif
+
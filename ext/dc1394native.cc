@@ -0,0 +1,388 @@
+/* HornetsEye - Computer Vision with Ruby
+   Copyright (C) 2006, 2007, 2008, 2009, 2010 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "dc1394native.hh"
+
+DC1394Native::DC1394Native(void) throw (Error):
+  m_dc1394(NULL)
+{
+  m_dc1394 = dc1394_new();
+  ERRORMACRO( m_dc1394 != NULL, Error, , "Error initialising DC1394 library" );
+}
+
+DC1394Native::~DC1394Native(void)
+{
+  dc1394_free( m_dc1394 );
+}
+
+bool DC1394Native::simulated(void) const
+{
+  return false;
+}
+
+dc1394error_t DC1394Native::cameraEnumerate( dc1394camera_list_t **list )
+{
+  return dc1394_camera_enumerate( m_dc1394, list );
+}
+
+void DC1394Native::cameraFreeList( dc1394camera_list_t *list )
+{
+  dc1394_camera_free_list( list );
+}
+
+dc1394camera_t *DC1394Native::cameraNewUnit( uint64_t guid, int unit )
+{
+  return dc1394_camera_new_unit( m_dc1394, guid, unit );
+}
+
+void DC1394Native::cameraFree( dc1394camera_t *camera )
+{
+  dc1394_camera_free( camera );
+}
+
+dc1394error_t DC1394Native::cameraSetPower( dc1394camera_t *camera,
+                                            dc1394switch_t power )
+{
+  return dc1394_camera_set_power( camera, power );
+}
+
+dc1394error_t DC1394Native::videoGetSupportedModes( dc1394camera_t *camera,
+                                                    dc1394video_modes_t *modes )
+{
+  return dc1394_video_get_supported_modes( camera, modes );
+}
+
+dc1394error_t DC1394Native::videoGetSupportedFramerates( dc1394camera_t *camera,
+                                                         dc1394video_mode_t mode,
+                                                         dc1394framerates_t *rates )
+{
+  return dc1394_video_get_supported_framerates( camera, mode, rates );
+}
+
+dc1394error_t DC1394Native::videoSetMode( dc1394camera_t *camera,
+                                          dc1394video_mode_t mode )
+{
+  return dc1394_video_set_mode( camera, mode );
+}
+
+dc1394error_t DC1394Native::videoGetMode( dc1394camera_t *camera,
+                                          dc1394video_mode_t *mode )
+{
+  return dc1394_video_get_mode( camera, mode );
+}
+
+dc1394error_t DC1394Native::videoSetFramerate( dc1394camera_t *camera,
+                                               dc1394framerate_t rate )
+{
+  return dc1394_video_set_framerate( camera, rate );
+}
+
+dc1394error_t DC1394Native::videoGetFramerate( dc1394camera_t *camera,
+                                               dc1394framerate_t *rate )
+{
+  return dc1394_video_get_framerate( camera, rate );
+}
+
+dc1394error_t DC1394Native::videoSetIsoSpeed( dc1394camera_t *camera,
+                                              dc1394speed_t speed )
+{
+  return dc1394_video_set_iso_speed( camera, speed );
+}
+
+dc1394error_t DC1394Native::videoGetIsoSpeed( dc1394camera_t *camera,
+                                              dc1394speed_t *speed )
+{
+  return dc1394_video_get_iso_speed( camera, speed );
+}
+
+dc1394error_t DC1394Native::videoSetOperationMode( dc1394camera_t *camera,
+                                                   dc1394operation_mode_t mode )
+{
+  return dc1394_video_set_operation_mode( camera, mode );
+}
+
+dc1394error_t DC1394Native::videoGetOperationMode( dc1394camera_t *camera,
+                                                   dc1394operation_mode_t *mode )
+{
+  return dc1394_video_get_operation_mode( camera, mode );
+}
+
+dc1394error_t DC1394Native::videoSetTransmission( dc1394camera_t *camera,
+                                                  dc1394switch_t power )
+{
+  return dc1394_video_set_transmission( camera, power );
+}
+
+dc1394error_t DC1394Native::videoGetBandwidthUsage( dc1394camera_t *camera,
+                                                    uint32_t *units )
+{
+  return dc1394_video_get_bandwidth_usage( camera, units );
+}
+
+dc1394error_t DC1394Native::getColorCodingFromVideoMode( dc1394camera_t *camera,
+                                                         dc1394video_mode_t mode,
+                                                         dc1394color_coding_t *coding )
+{
+  return dc1394_get_color_coding_from_video_mode( camera, mode, coding );
+}
+
+dc1394error_t DC1394Native::getImageSizeFromVideoMode( dc1394camera_t *camera,
+                                                       dc1394video_mode_t mode,
+                                                       uint32_t *width,
+                                                       uint32_t *height )
+{
+  return dc1394_get_image_size_from_video_mode( camera, mode, width, height );
+}
+
+dc1394error_t DC1394Native::format7GetMaxImageSize( dc1394camera_t *camera,
+                                                    dc1394video_mode_t mode,
+                                                    uint32_t *width,
+                                                    uint32_t *height )
+{
+  return dc1394_format7_get_max_image_size( camera, mode, width, height );
+}
+
+dc1394error_t DC1394Native::format7GetUnitSize( dc1394camera_t *camera,
+                                                dc1394video_mode_t mode,
+                                                uint32_t *width, uint32_t *height )
+{
+  return dc1394_format7_get_unit_size( camera, mode, width, height );
+}
+
+dc1394error_t DC1394Native::format7GetUnitPosition( dc1394camera_t *camera,
+                                                    dc1394video_mode_t mode,
+                                                    uint32_t *left, uint32_t *top )
+{
+  return dc1394_format7_get_unit_position( camera, mode, left, top );
+}
+
+dc1394error_t DC1394Native::format7GetPacketParameters( dc1394camera_t *camera,
+                                                        dc1394video_mode_t mode,
+                                                        uint32_t *unitBytes,
+                                                        uint32_t *maxBytes )
+{
+  return dc1394_format7_get_packet_parameters( camera, mode, unitBytes, maxBytes );
+}
+
+dc1394error_t DC1394Native::format7GetPacketSize( dc1394camera_t *camera,
+                                                  dc1394video_mode_t mode,
+                                                  uint32_t *packetSize )
+{
+  return dc1394_format7_get_packet_size( camera, mode, packetSize );
+}
+
+dc1394error_t DC1394Native::format7SetPacketSize( dc1394camera_t *camera,
+                                                  dc1394video_mode_t mode,
+                                                  uint32_t packetSize )
+{
+  return dc1394_format7_set_packet_size( camera, mode, packetSize );
+}
+
+dc1394error_t DC1394Native::format7GetTotalBytes( dc1394camera_t *camera,
+                                                  dc1394video_mode_t mode,
+                                                  uint64_t *totalBytes )
+{
+  return dc1394_format7_get_total_bytes( camera, mode, totalBytes );
+}
+
+dc1394error_t DC1394Native::format7GetColorCodings( dc1394camera_t *camera,
+                                                    dc1394video_mode_t mode,
+                                                    dc1394color_codings_t *codings )
+{
+  return dc1394_format7_get_color_codings( camera, mode, codings );
+}
+
+dc1394error_t DC1394Native::format7GetColorFilter( dc1394camera_t *camera,
+                                                   dc1394video_mode_t mode,
+                                                   dc1394color_filter_t *filter )
+{
+  return dc1394_format7_get_color_filter( camera, mode, filter );
+}
+
+dc1394error_t DC1394Native::format7GetFrameInterval( dc1394camera_t *camera,
+                                                     dc1394video_mode_t mode,
+                                                     float *interval )
+{
+  return dc1394_format7_get_frame_interval( camera, mode, interval );
+}
+
+dc1394error_t DC1394Native::format7GetRoi( dc1394camera_t *camera,
+                                           dc1394video_mode_t mode,
+                                           dc1394color_coding_t *coding,
+                                           uint32_t *packetSize, uint32_t *left,
+                                           uint32_t *top, uint32_t *width,
+                                           uint32_t *height )
+{
+  return dc1394_format7_get_roi( camera, mode, coding, packetSize, left, top, width,
+                                 height );
+}
+
+dc1394error_t DC1394Native::format7SetRoi( dc1394camera_t *camera,
+                                           dc1394video_mode_t mode,
+                                           dc1394color_coding_t coding,
+                                           int32_t packetSize, int32_t left,
+                                           int32_t top, int32_t width, int32_t height )
+{
+  return dc1394_format7_set_roi( camera, mode, coding, packetSize, left, top, width,
+                                 height );
+}
+
+dc1394error_t DC1394Native::captureSetup( dc1394camera_t *camera,
+                                          uint32_t numBuffers, uint32_t flags )
+{
+  return dc1394_capture_setup( camera, numBuffers, flags );
+}
+
+dc1394error_t DC1394Native::captureStop( dc1394camera_t *camera )
+{
+  return dc1394_capture_stop( camera );
+}
+
+int DC1394Native::captureGetFileno( dc1394camera_t *camera )
+{
+  return dc1394_capture_get_fileno( camera );
+}
+
+dc1394error_t DC1394Native::captureDequeue( dc1394camera_t *camera,
+                                            dc1394capture_policy_t policy,
+                                            dc1394video_frame_t **frame )
+{
+  return dc1394_capture_dequeue( camera, policy, frame );
+}
+
+dc1394error_t DC1394Native::captureEnqueue( dc1394camera_t *camera,
+                                            dc1394video_frame_t *frame )
+{
+  return dc1394_capture_enqueue( camera, frame );
+}
+
+dc1394bool_t DC1394Native::captureIsFrameCorrupt( dc1394camera_t *camera,
+                                                  dc1394video_frame_t *frame )
+{
+  return dc1394_capture_is_frame_corrupt( camera, frame );
+}
+
+dc1394error_t DC1394Native::featureGet( dc1394camera_t *camera,
+                                        dc1394feature_info_t *feature )
+{
+  return dc1394_feature_get( camera, feature );
+}
+
+dc1394error_t DC1394Native::featureGetAll( dc1394camera_t *camera,
+                                           dc1394featureset_t *features )
+{
+  return dc1394_feature_get_all( camera, features );
+}
+
+dc1394error_t DC1394Native::featureGetValue( dc1394camera_t *camera,
+                                             dc1394feature_t feature,
+                                             uint32_t *value )
+{
+  return dc1394_feature_get_value( camera, feature, value );
+}
+
+dc1394error_t DC1394Native::featureSetValue( dc1394camera_t *camera,
+                                             dc1394feature_t feature,
+                                             uint32_t value )
+{
+  return dc1394_feature_set_value( camera, feature, value );
+}
+
+dc1394error_t DC1394Native::featureIsPresent( dc1394camera_t *camera,
+                                              dc1394feature_t feature,
+                                              dc1394bool_t *value )
+{
+  return dc1394_feature_is_present( camera, feature, value );
+}
+
+dc1394error_t DC1394Native::featureIsReadable( dc1394camera_t *camera,
+                                               dc1394feature_t feature,
+                                               dc1394bool_t *value )
+{
+  return dc1394_feature_is_readable( camera, feature, value );
+}
+
+dc1394error_t DC1394Native::featureIsSwitchable( dc1394camera_t *camera,
+                                                 dc1394feature_t feature,
+                                                 dc1394bool_t *value )
+{
+  return dc1394_feature_is_switchable( camera, feature, value );
+}
+
+dc1394error_t DC1394Native::featureGetPower( dc1394camera_t *camera,
+                                             dc1394feature_t feature,
+                                             dc1394switch_t *value )
+{
+  return dc1394_feature_get_power( camera, feature, value );
+}
+
+dc1394error_t DC1394Native::featureSetPower( dc1394camera_t *camera,
+                                             dc1394feature_t feature,
+                                             dc1394switch_t value )
+{
+  return dc1394_feature_set_power( camera, feature, value );
+}
+
+dc1394error_t DC1394Native::featureGetModes( dc1394camera_t *camera,
+                                             dc1394feature_t feature,
+                                             dc1394feature_modes_t *modes )
+{
+  return dc1394_feature_get_modes( camera, feature, modes );
+}
+
+dc1394error_t DC1394Native::featureGetMode( dc1394camera_t *camera,
+                                            dc1394feature_t feature,
+                                            dc1394feature_mode_t *mode )
+{
+  return dc1394_feature_get_mode( camera, feature, mode );
+}
+
+dc1394error_t DC1394Native::featureSetMode( dc1394camera_t *camera,
+                                            dc1394feature_t feature,
+                                            dc1394feature_mode_t mode )
+{
+  return dc1394_feature_set_mode( camera, feature, mode );
+}
+
+dc1394error_t DC1394Native::externalTriggerSetMode( dc1394camera_t *camera,
+                                                    dc1394trigger_mode_t mode )
+{
+  return dc1394_external_trigger_set_mode( camera, mode );
+}
+
+dc1394error_t DC1394Native::externalTriggerSetSource( dc1394camera_t *camera,
+                                                      dc1394trigger_source_t source )
+{
+  return dc1394_external_trigger_set_source( camera, source );
+}
+
+dc1394error_t DC1394Native::externalTriggerSetPolarity( dc1394camera_t *camera,
+                                                        dc1394trigger_polarity_t
+                                                        polarity )
+{
+  return dc1394_external_trigger_set_polarity( camera, polarity );
+}
+
+dc1394error_t DC1394Native::externalTriggerSetPower( dc1394camera_t *camera,
+                                                     dc1394switch_t power )
+{
+  return dc1394_external_trigger_set_power( camera, power );
+}
+
+dc1394error_t DC1394Native::softwareTriggerSetPower( dc1394camera_t *camera,
+                                                     dc1394switch_t power )
+{
+  return dc1394_software_trigger_set_power( camera, power );
+}
@@ -0,0 +1,249 @@
+/* HornetsEye - Computer Vision with Ruby
+   Copyright (C) 2006, 2007, 2008, 2009, 2010 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include <iomanip>
+#include "rubyinc.hh"
+#include "dc1394plan.hh"
+
+using namespace std;
+
+vector< DC1394Plan::Entry > DC1394Plan::make( DC1394Ptr dc1394,
+                                              const vector< Request > &requests,
+                                              dc1394speed_t speed, uint32_t budget )
+  throw (Error)
+{
+  vector< Entry > retVal;
+  vector< vector< Option > > choices;
+  const DC1394::BandwidthMap &running = dc1394->running();
+  for ( vector< Request >::const_iterator i = requests.begin(); i != requests.end();
+        i++ ) {
+    // Planning reconfigures the camera which must not disturb a transmission.
+    for ( DC1394::BandwidthMap::const_iterator j = running.begin();
+          j != running.end(); j++ )
+      ERRORMACRO( j->first->guid != i->guid ||
+                  ( i->unit >= 0 && j->first->unit != i->unit ), Error, ,
+                  "Camera with guid 0x" << setfill( '0' ) << setw( 16 )
+                  << setbase( 16 ) << i->guid << setbase( 10 ) << setfill( ' ' )
+                  << " is capturing. Close it before planning" );
+    // The camera is parked afterwards so that opening it is fast.
+    dc1394camera_t *camera = dc1394->openCamera( i->guid, i->unit );
+    DC1394BackendPtr backend( dc1394->backend() );
+    Settings settings( save( *backend, camera ) );
+    try {
+      DC1394::Camera info( dc1394->info( camera ) );
+      DC1394Select select;
+      select.setPolicy( i->policy );
+      select.addModes( *backend, camera, info );
+      const DC1394::Mode &mode = info.modes[ select.makeNative() ];
+      vector< Option > o( options( *backend, camera, mode, i->policy, speed ) );
+      ERRORMACRO( !o.empty(), Error, , "No frame rate of camera with guid 0x"
+                  << setfill( '0' ) << setw( 16 ) << setbase( 16 ) << camera->guid
+                  << setbase( 10 ) << setfill( ' ' ) << " meets the policy" );
+      Entry entry;
+      entry.guid = camera->guid;
+      entry.unit = camera->unit;
+      entry.mode = mode.mode;
+      entry.coding = mode.coding;
+      entry.width = mode.width;
+      entry.height = mode.height;
+      retVal.push_back( entry );
+      choices.push_back( o );
+    } catch ( Error &e ) {
+      restore( *backend, camera, settings );
+      dc1394->park( camera );
+      throw e;
+    };
+    restore( *backend, camera, settings );
+    dc1394->park( camera );
+  };
+  // Cameras capturing already keep their bandwidth.
+  uint32_t used = 0;
+  for ( DC1394::BandwidthMap::const_iterator i = running.begin();
+        i != running.end(); i++ )
+    used += i->second;
+  ERRORMACRO( used < budget, Error, , "Cameras already running use " << used
+              << " of " << budget << " available bandwidth units" );
+  budget -= used;
+  // Start with the fastest option of each camera and slow down the camera
+  // using the most bandwidth until the total fits the budget.
+  vector< unsigned int > current( choices.size(), 0 );
+  uint32_t total = 0;
+  for ( unsigned int i=0; i<choices.size(); i++ )
+    total += choices[i][0].bandwidth;
+  while ( total > budget ) {
+    int worst = -1;
+    for ( unsigned int i=0; i<choices.size(); i++ )
+      if ( current[i] + 1 < choices[i].size() &&
+           ( worst < 0 ||
+             choices[i][ current[i] ].bandwidth >
+             choices[ worst ][ current[ worst ] ].bandwidth ) )
+        worst = i;
+    ERRORMACRO( worst >= 0, Error, , "The cameras require " << total << " of "
+                << budget << " available bandwidth units even at the lowest frame "
+                "rates allowed (" << used << " units are used by running cameras). "
+                "Use a faster bus speed, fewer cameras, or smaller "
+                "video modes" );
+    total -= choices[ worst ][ current[ worst ] ].bandwidth;
+    current[ worst ]++;
+    total += choices[ worst ][ current[ worst ] ].bandwidth;
+  };
+  for ( unsigned int i=0; i<retVal.size(); i++ ) {
+    const Option &option = choices[i][ current[i] ];
+    retVal[i].frameRate = option.frameRate;
+    retVal[i].fps = option.fps;
+    retVal[i].packetSize = option.packetSize;
+    retVal[i].bandwidth = option.bandwidth;
+  };
+  return retVal;
+}
+
+uint32_t DC1394Plan::bandwidth( uint32_t packetSize, dc1394speed_t speed )
+{
+  // Quadlets of payload plus isochronous header and footer in units of the
+  // time needed to transmit one quadlet at S1600.
+  uint32_t quadlets = ( packetSize + 3 ) / 4 + 3;
+  if ( speed <= DC1394_ISO_SPEED_1600 )
+    return quadlets << ( DC1394_ISO_SPEED_1600 - speed );
+  else
+    return quadlets >> ( speed - DC1394_ISO_SPEED_1600 );
+}
+
+DC1394Plan::Settings DC1394Plan::save( DC1394Backend &backend,
+                                       dc1394camera_t *camera )
+{
+  Settings retVal;
+  retVal.valid = backend.videoGetMode( camera, &retVal.mode ) == DC1394_SUCCESS;
+  retVal.frameRate = DC1394_FRAMERATE_MIN;
+  retVal.packetSize = 0;
+  if ( retVal.valid ) {
+    if ( dc1394_is_video_mode_scalable( retVal.mode ) )
+      retVal.valid = backend.format7GetPacketSize( camera, retVal.mode,
+                                                   &retVal.packetSize ) ==
+        DC1394_SUCCESS;
+    else
+      retVal.valid = backend.videoGetFramerate( camera, &retVal.frameRate ) ==
+        DC1394_SUCCESS;
+  };
+  return retVal;
+}
+
+void DC1394Plan::restore( DC1394Backend &backend, dc1394camera_t *camera,
+                          const Settings &settings )
+{
+  // Failures are ignored because the camera is configured again when opened.
+  if ( settings.valid &&
+       backend.videoSetMode( camera, settings.mode ) == DC1394_SUCCESS ) {
+    if ( dc1394_is_video_mode_scalable( settings.mode ) )
+      backend.format7SetPacketSize( camera, settings.mode, settings.packetSize );
+    else
+      backend.videoSetFramerate( camera, settings.frameRate );
+  };
+}
+
+uint32_t DC1394Plan::usage( DC1394Backend &backend, dc1394camera_t *camera,
+                           uint32_t packetSize, dc1394speed_t speed )
+{
+  // The library computes the usage for the current iso speed. It is inversely
+  // proportional to the speed.
+  uint32_t units;
+  dc1394speed_t current;
+  if ( backend.videoGetBandwidthUsage( camera, &units ) != DC1394_SUCCESS ||
+       backend.videoGetIsoSpeed( camera, &current ) != DC1394_SUCCESS )
+    return bandwidth( packetSize, speed );
+  if ( speed <= current )
+    return units << ( current - speed );
+  else
+    return units >> ( speed - current );
+}
+
+vector< DC1394Plan::Option > DC1394Plan::options( DC1394Backend &backend,
+                                                  dc1394camera_t *camera,
+                                                  const DC1394::Mode &mode,
+                                                  const DC1394Select::Policy &policy,
+                                                  dc1394speed_t speed )
+  throw (Error)
+{
+  vector< Option > retVal;
+  uint32_t bits;
+  dc1394error_t err = dc1394_get_color_coding_bit_size( mode.coding, &bits );
+  ERRORMACRO( err == DC1394_SUCCESS, Error, , "Error querying bits per pixel: "
+              << dc1394_error_get_string( err ) );
+  uint64_t frameBytes = (uint64_t)mode.width * mode.height * bits / 8;
+  // The idle camera is configured with each option to query its bandwidth
+  // usage. The previous settings are restored afterwards.
+  err = backend.videoSetMode( camera, mode.mode );
+  ERRORMACRO( err == DC1394_SUCCESS, Error, , "Error setting video mode: "
+              << dc1394_error_get_string( err ) );
+  if ( dc1394_is_video_mode_scalable( mode.mode ) ) {
+    uint32_t unitBytes, maxBytes;
+    err = backend.format7GetPacketParameters( camera, mode.mode, &unitBytes,
+                                              &maxBytes );
+    ERRORMACRO( err == DC1394_SUCCESS, Error, , "Error querying packet "
+                "parameters: " << dc1394_error_get_string( err ) );
+    ERRORMACRO( unitBytes > 0 && maxBytes >= unitBytes && frameBytes > 0, Error, ,
+                "Camera reported invalid packet parameters" );
+    // Try the smallest packet size for each number of packets per frame
+    // unless the policy fixes the packet size.
+    uint32_t previous = 0;
+    uint64_t maxPackets = ( frameBytes + unitBytes - 1 ) / unitBytes;
+    for ( uint64_t packets = ( frameBytes + maxBytes - 1 ) / maxBytes;
+          packets <= maxPackets; packets++ ) {
+      uint32_t packetSize = policy.packetSize;
+      if ( packetSize == 0 ) {
+        packetSize = ( frameBytes + packets - 1 ) / packets;
+        packetSize = ( packetSize + unitBytes - 1 ) / unitBytes * unitBytes;
+      };
+      if ( packetSize == previous ) {
+        if ( policy.packetSize > 0 ) break;
+        continue;
+      };
+      previous = packetSize;
+      float fps = 8000.0f / ( ( frameBytes + packetSize - 1 ) / packetSize );
+      if ( fps < policy.minFrameRate || fps < 1 ) break;
+      if ( policy.maxBandwidth <= 0 || frameBytes * fps <= policy.maxBandwidth ) {
+        Option option;
+        option.frameRate = -1;
+        option.fps = fps;
+        option.packetSize = packetSize;
+        if ( backend.format7SetPacketSize( camera, mode.mode, packetSize ) ==
+             DC1394_SUCCESS )
+          option.bandwidth = usage( backend, camera, packetSize, speed );
+        else
+          option.bandwidth = bandwidth( packetSize, speed );
+        retVal.push_back( option );
+      };
+    };
+  } else {
+    // Frame rates are sorted in ascending order.
+    for ( int i=(int)mode.frameRates.size() - 1; i>=0; i-- ) {
+      float fps;
+      dc1394_framerate_as_float( mode.frameRates[i], &fps );
+      if ( fps < policy.minFrameRate ) continue;
+      if ( policy.maxBandwidth > 0 && frameBytes * fps > policy.maxBandwidth )
+        continue;
+      Option option;
+      option.frameRate = mode.frameRates[i];
+      option.fps = fps;
+      option.packetSize = (uint32_t)( ( frameBytes * fps / 8000 + 3 ) / 4 ) * 4;
+      if ( backend.videoSetFramerate( camera, mode.frameRates[i] ) == DC1394_SUCCESS )
+        option.bandwidth = usage( backend, camera, option.packetSize, speed );
+      else
+        option.bandwidth = bandwidth( option.packetSize, speed );
+      retVal.push_back( option );
+    };
+  };
+  return retVal;
+}
+
@@ -0,0 +1,89 @@
+/* HornetsEye - Computer Vision with Ruby
+   Copyright (C) 2006, 2007, 2008, 2009, 2010 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef HORNETSEYE_DC1394PLAN_HH
+#define HORNETSEYE_DC1394PLAN_HH
+
+#include <vector>
+#include <dc1394/dc1394.h>
+#include "error.hh"
+#include "dc1394.hh"
+#include "dc1394select.hh"
+
+// Distribution of the isochronous bandwidth of one firewire bus among
+// several cameras. Frame rates (or packet sizes in format7 modes) are
+// lowered until the cameras fit the budget.
+class DC1394Plan
+{
+public:
+  struct Request
+  {
+    uint64_t guid;
+    int unit;
+    DC1394Select::Policy policy;
+  };
+  struct Entry
+  {
+    uint64_t guid;
+    int unit;
+    dc1394video_mode_t mode;
+    dc1394color_coding_t coding;
+    unsigned int width;
+    unsigned int height;
+    // Frame rate of fixed modes or -1 for format7 modes.
+    int frameRate;
+    float fps;
+    // Bytes per isochronous packet.
+    uint32_t packetSize;
+    // Bandwidth units as used by "dc1394_video_get_bandwidth_usage".
+    uint32_t bandwidth;
+  };
+  // Bandwidth units available for isochronous transfers in one cycle.
+  static const uint32_t BUS_BANDWIDTH = 4915;
+  static std::vector< Entry > make( DC1394Ptr dc1394,
+                                    const std::vector< Request > &requests,
+                                    dc1394speed_t speed, uint32_t budget )
+    throw (Error);
+  static uint32_t bandwidth( uint32_t packetSize, dc1394speed_t speed );
+protected:
+  // Video mode, frame rate, and packet size of an idle camera.
+  struct Settings
+  {
+    bool valid;
+    dc1394video_mode_t mode;
+    dc1394framerate_t frameRate;
+    uint32_t packetSize;
+  };
+  static Settings save( DC1394Backend &backend, dc1394camera_t *camera );
+  static void restore( DC1394Backend &backend, dc1394camera_t *camera,
+                       const Settings &settings );
+  static uint32_t usage( DC1394Backend &backend, dc1394camera_t *camera,
+                         uint32_t packetSize, dc1394speed_t speed );
+  struct Option
+  {
+    int frameRate;
+    float fps;
+    uint32_t packetSize;
+    uint32_t bandwidth;
+  };
+  static std::vector< Option > options( DC1394Backend &backend,
+                                        dc1394camera_t *camera,
+                                        const DC1394::Mode &mode,
+                                        const DC1394Select::Policy &policy,
+                                        dc1394speed_t speed ) throw (Error);
+};
+
+#endif
+
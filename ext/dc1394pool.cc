@@ -0,0 +1,186 @@
+/* HornetsEye - Computer Vision with Ruby
+   Copyright (C) 2006, 2007, 2008, 2009, 2010 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include <algorithm>
+#include <vector>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include "dc1394pool.hh"
+
+using namespace std;
+
+// Upper limit for the number of worker threads.
+static const int MAX_THREADS = 64;
+
+// "serial" allows only one job at a time, "mutex" protects the state below.
+static pthread_mutex_t serial = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_cond_t wake = PTHREAD_COND_INITIALIZER;
+
+static pthread_cond_t finished = PTHREAD_COND_INITIALIZER;
+
+static vector< pthread_t > workers;
+
+// Number of threads including the calling thread (0 means one per core).
+static int requested = 0;
+
+static bool pinned = false;
+
+static bool quit = false;
+
+static unsigned long generation = 0;
+
+static DC1394Pool::Task jobTask = NULL;
+
+static void *jobData = NULL;
+
+static int jobSize = 0;
+
+static int jobStripe = 0;
+
+static int jobStripes = 0;
+
+static int jobNext = 0;
+
+static int jobDone = 0;
+
+static int cores(void)
+{
+  return max( 1, (int)sysconf( _SC_NPROCESSORS_ONLN ) );
+}
+
+void DC1394Pool::run( Task task, void *data, int size, int granularity )
+{
+  granularity = max( 1, granularity );
+  if ( size <= granularity || threads() <= 1 ) {
+    task( data, 0, size );
+    return;
+  };
+  pthread_mutex_lock( &serial );
+  pthread_mutex_lock( &mutex );
+  if ( workers.empty() ) start();
+  int n = min( (int)workers.size() + 1, ( size + granularity - 1 ) / granularity );
+  // Stripes are a multiple of the granularity (e.g. pairs of rows for Bayer
+  // images).
+  int stripe = ( size + n - 1 ) / n;
+  jobStripe = ( stripe + granularity - 1 ) / granularity * granularity;
+  jobStripes = ( size + jobStripe - 1 ) / jobStripe;
+  jobTask = task;
+  jobData = data;
+  jobSize = size;
+  jobNext = 0;
+  jobDone = 0;
+  generation++;
+  pthread_cond_broadcast( &wake );
+  work();
+  while ( jobDone < jobStripes )
+    pthread_cond_wait( &finished, &mutex );
+  pthread_mutex_unlock( &mutex );
+  pthread_mutex_unlock( &serial );
+}
+
+void DC1394Pool::shutdown(void)
+{
+  pthread_mutex_lock( &serial );
+  pthread_mutex_lock( &mutex );
+  quit = true;
+  pthread_cond_broadcast( &wake );
+  pthread_mutex_unlock( &mutex );
+  for ( vector< pthread_t >::iterator i = workers.begin(); i != workers.end(); i++ )
+    pthread_join( *i, NULL );
+  workers.clear();
+  quit = false;
+  pthread_mutex_unlock( &serial );
+}
+
+int DC1394Pool::threads(void)
+{
+  return min( requested > 0 ? requested : cores(), MAX_THREADS );
+}
+
+void DC1394Pool::setThreads( int threads )
+{
+  // The pool is restarted with the new size when it is used next.
+  shutdown();
+  requested = max( 0, threads );
+}
+
+bool DC1394Pool::affinity(void)
+{
+  return pinned;
+}
+
+void DC1394Pool::setAffinity( bool affinity )
+{
+  shutdown();
+  pinned = affinity;
+}
+
+void DC1394Pool::start(void)
+{
+  int n = threads() - 1;
+  for ( int i=0; i<n; i++ ) {
+    pthread_t id;
+    if ( pthread_create( &id, NULL, worker, NULL ) != 0 )
+      // Continue with fewer threads.
+      break;
+#ifdef __linux__
+    if ( pinned ) {
+      // The calling thread is left to the scheduler. Worker i is pinned to
+      // core i + 1 so that it does not compete with it.
+      cpu_set_t cpus;
+      CPU_ZERO( &cpus );
+      CPU_SET( ( i + 1 ) % cores(), &cpus );
+      pthread_setaffinity_np( id, sizeof( cpus ), &cpus );
+    };
+#endif
+    workers.push_back( id );
+  };
+}
+
+void DC1394Pool::work(void)
+{
+  // The mutex is held when entering and leaving this method.
+  while ( jobNext < jobStripes ) {
+    int begin = jobNext * jobStripe, end = min( begin + jobStripe, jobSize );
+    DC1394Pool::Task task = jobTask;
+    void *data = jobData;
+    jobNext++;
+    pthread_mutex_unlock( &mutex );
+    task( data, begin, end );
+    pthread_mutex_lock( &mutex );
+    jobDone++;
+  };
+  if ( jobDone == jobStripes ) pthread_cond_broadcast( &finished );
+}
+
+void *DC1394Pool::worker( void * )
+{
+  pthread_mutex_lock( &mutex );
+  unsigned long seen = generation;
+  while ( true ) {
+    while ( !quit && generation == seen )
+      pthread_cond_wait( &wake, &mutex );
+    if ( quit ) break;
+    seen = generation;
+    work();
+  };
+  pthread_mutex_unlock( &mutex );
+  return NULL;
+}
+
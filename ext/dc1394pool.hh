@@ -0,0 +1,41 @@
+/* HornetsEye - Computer Vision with Ruby
+   Copyright (C) 2006, 2007, 2008, 2009, 2010 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef HORNETSEYE_DC1394POOL_HH
+#define HORNETSEYE_DC1394POOL_HH
+
+// Process-wide pool of worker threads shared by all cameras. A job is split
+// into stripes which are processed by the workers and the calling thread.
+// The workers never touch Ruby objects and therefore do not need the GVL.
+// The threads are started on demand and stopped by "shutdown" when the process
+// exits or the pool is reconfigured.
+class DC1394Pool
+{
+public:
+  typedef void (*Task)( void *data, int begin, int end );
+  static void run( Task task, void *data, int size, int granularity );
+  static void shutdown(void);
+  static int threads(void);
+  static void setThreads( int threads );
+  static bool affinity(void);
+  static void setAffinity( bool affinity );
+protected:
+  static void start(void);
+  static void work(void);
+  static void *worker( void *ptr );
+};
+
+#endif
+
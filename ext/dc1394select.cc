@@ -13,23 +13,90 @@
    
    You should have received a copy of the GNU General Public License
    along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include <algorithm>
 #include "rubyinc.hh"
+#include "dc1394convert.hh"
 #include "dc1394select.hh"
 
+using namespace std;
+
 DC1394Select::DC1394Select(void) throw (Error):
-  m_rbArray(rb_ary_new())
+  m_frameRate(-1)
 {
+  m_policy.minWidth = 0;
+  m_policy.minHeight = 0;
+  m_policy.minFrameRate = 0;
+  m_policy.maxBandwidth = 0;
+  m_policy.mode = 0;
+  m_policy.packetSize = 0;
 }
 
 DC1394Select::~DC1394Select(void)
 {
 }
 
-void DC1394Select::add( dc1394color_coding_t coding, unsigned int width,
-                        unsigned int height )
+void DC1394Select::add( dc1394video_mode_t mode, dc1394color_coding_t coding,
+                        unsigned int width, unsigned int height,
+                        const vector< float > &frameRates )
 {
-  rb_ary_push( m_rbArray, rb_ary_new3( 3, INT2NUM( coding ), INT2NUM( width ),
-                                       INT2NUM( height ) ) );
+  Candidate candidate;
+  candidate.mode = mode;
+  candidate.coding = coding;
+  candidate.width = width;
+  candidate.height = height;
+  candidate.frameRates = frameRates;
+  m_candidates.push_back( candidate );
+}
+
+void DC1394Select::addModes( DC1394Backend &backend, dc1394camera_t *camera,
+                             DC1394::Camera &info )
+{
+  for ( vector< DC1394::Mode >::iterator i = info.modes.begin();
+        i != info.modes.end(); i++ ) {
+    vector< float > frameRates;
+    if ( dc1394_is_video_mode_scalable( i->mode ) ) {
+      // Coding and size of format7 modes can be changed by other programs.
+      backend.getColorCodingFromVideoMode( camera, i->mode, &i->coding );
+      backend.getImageSizeFromVideoMode( camera, i->mode, &i->width, &i->height );
+      float fps = format7FrameRate( backend, camera, i->mode );
+      if ( fps > 0 ) frameRates.push_back( fps );
+    } else
+      for ( vector< dc1394framerate_t >::const_iterator j = i->frameRates.begin();
+            j != i->frameRates.end(); j++ ) {
+        float fps;
+        dc1394_framerate_as_float( *j, &fps );
+        frameRates.push_back( fps );
+      };
+    add( i->mode, i->coding, i->width, i->height, frameRates );
+  };
+}
+
+void DC1394Select::setPolicy( VALUE rbPolicy ) throw (Error)
+{
+  if ( NIL_P( rbPolicy ) ) return;
+  ERRORMACRO( TYPE( rbPolicy ) == T_HASH, Error, , "Mode selection policy must be "
+              "a hash" );
+  VALUE rbCodings = rb_hash_aref( rbPolicy, ID2SYM( rb_intern( "codings" ) ) ),
+    rbMinWidth = rb_hash_aref( rbPolicy, ID2SYM( rb_intern( "min_width" ) ) ),
+    rbMinHeight = rb_hash_aref( rbPolicy, ID2SYM( rb_intern( "min_height" ) ) ),
+    rbMinFrameRate = rb_hash_aref( rbPolicy, ID2SYM( rb_intern( "min_frame_rate" ) ) ),
+    rbMaxBandwidth = rb_hash_aref( rbPolicy, ID2SYM( rb_intern( "max_bandwidth" ) ) ),
+    rbMode = rb_hash_aref( rbPolicy, ID2SYM( rb_intern( "mode" ) ) ),
+    rbPacketSize = rb_hash_aref( rbPolicy, ID2SYM( rb_intern( "packet_size" ) ) );
+  m_policy.codings.clear();
+  if ( !NIL_P( rbCodings ) ) {
+    ERRORMACRO( TYPE( rbCodings ) == T_ARRAY, Error, , "Value of :codings must be "
+                "an array" );
+    for ( int i=0; i<RARRAY_LEN( rbCodings ); i++ )
+      m_policy.codings.push_back
+        ( (dc1394color_coding_t)NUM2INT( rb_ary_entry( rbCodings, i ) ) );
+  };
+  m_policy.minWidth = NIL_P( rbMinWidth ) ? 0 : NUM2UINT( rbMinWidth );
+  m_policy.minHeight = NIL_P( rbMinHeight ) ? 0 : NUM2UINT( rbMinHeight );
+  m_policy.minFrameRate = NIL_P( rbMinFrameRate ) ? 0 : NUM2DBL( rbMinFrameRate );
+  m_policy.maxBandwidth = NIL_P( rbMaxBandwidth ) ? 0 : NUM2DBL( rbMaxBandwidth );
+  m_policy.mode = NIL_P( rbMode ) ? 0 : NUM2INT( rbMode );
+  m_policy.packetSize = NIL_P( rbPacketSize ) ? 0 : NUM2UINT( rbPacketSize );
 }
 
 static VALUE yield( VALUE arg )
@@ -39,8 +106,15 @@ static VALUE yield( VALUE arg )
 
 unsigned int DC1394Select::make(void) throw (Error)
 {
+  m_frameRate = -1;
+  if ( !rb_block_given_p() ) return makeNative();
+  VALUE rbArray = rb_ary_new();
+  for ( vector< Candidate >::const_iterator i = m_candidates.begin();
+        i != m_candidates.end(); i++ )
+    rb_ary_push( rbArray, rb_ary_new3( 3, INT2NUM( i->coding ), INT2NUM( i->width ),
+                                       INT2NUM( i->height ) ) );
   int error;
-  VALUE rbRetVal = rb_protect( yield, m_rbArray, &error );
+  VALUE rbRetVal = rb_protect( yield, rbArray, &error );
   if ( error ) {
     VALUE rbError = rb_funcall( rb_gv_get( "$!" ), rb_intern( "message" ), 0 );
     ERRORMACRO( false, Error, , "Error in block to \"DC1394Input.new\": "
@@ -51,7 +125,110 @@ unsigned int DC1394Select::make(void) throw (Error)
   return NUM2UINT(rbRetVal);
 }
 
-VALUE DC1394Select::wrapRescue( VALUE rbValue )
+unsigned int DC1394Select::makeNative(void) throw (Error)
 {
-  return rbValue;
+  int best = -1, bestRank = 0, bestFrameRate = -1;
+  double bestBandwidth = 0, bestFps = 0;
+  unsigned long bestPixels = 0;
+  for ( unsigned int i=0; i<m_candidates.size(); i++ ) {
+    const Candidate &candidate = m_candidates[i];
+    int rank;
+    if ( m_policy.codings.empty() )
+      rank = defaultRank( candidate.mode, candidate.coding );
+    else {
+      vector< dc1394color_coding_t >::const_iterator pos =
+        find( m_policy.codings.begin(), m_policy.codings.end(), candidate.coding );
+      rank = pos != m_policy.codings.end() ? pos - m_policy.codings.begin() : -1;
+    };
+    if ( rank < 0 ) continue;
+    if ( m_policy.mode != 0 && candidate.mode != m_policy.mode ) continue;
+    if ( candidate.width < m_policy.minWidth || candidate.height < m_policy.minHeight )
+      continue;
+    uint32_t bits;
+    if ( dc1394_get_color_coding_bit_size( candidate.coding, &bits ) !=
+         DC1394_SUCCESS )
+      continue;
+    unsigned long pixels = (unsigned long)candidate.width * candidate.height;
+    double frameBytes = pixels * bits / 8.0;
+    // Use the fastest frame rate meeting the policy. Modes with unknown frame
+    // rate only qualify if no minimum frame rate was requested.
+    int frameRate = -1;
+    float fps = 0;
+    for ( unsigned int j=0; j<candidate.frameRates.size(); j++ ) {
+      float f = candidate.frameRates[j];
+      if ( f >= m_policy.minFrameRate && f > fps &&
+           ( m_policy.maxBandwidth <= 0 || frameBytes * f <= m_policy.maxBandwidth ) ) {
+        frameRate = j;
+        fps = f;
+      };
+    };
+    if ( frameRate < 0 && ( m_policy.minFrameRate > 0 ||
+                            !candidate.frameRates.empty() ) )
+      continue;
+    double bandwidth = frameBytes * fps;
+    bool better;
+    if ( best < 0 || rank != bestRank )
+      better = best < 0 || rank < bestRank;
+    else if ( m_policy.maxBandwidth > 0 && bandwidth != bestBandwidth )
+      better = bandwidth > bestBandwidth;
+    else if ( pixels != bestPixels )
+      better = pixels > bestPixels;
+    else
+      better = fps > bestFps;
+    if ( better ) {
+      best = i;
+      bestRank = rank;
+      bestFrameRate = frameRate;
+      bestBandwidth = bandwidth;
+      bestFps = fps;
+      bestPixels = pixels;
+    };
+  };
+  ERRORMACRO( best >= 0, Error, , "Device does not support a video mode matching "
+              "the selection policy" );
+  m_frameRate = bestFrameRate;
+  return best;
 }
+
+float DC1394Select::format7FrameRate( DC1394Backend &backend,
+                                      dc1394camera_t *camera,
+                                      dc1394video_mode_t mode )
+{
+  float retVal = 0;
+  float interval;
+  uint32_t packetSize;
+  uint64_t totalBytes;
+  if ( backend.format7GetFrameInterval( camera, mode, &interval ) ==
+       DC1394_SUCCESS && interval > 0 )
+    retVal = 1.0f / interval;
+  else if ( backend.format7GetPacketSize( camera, mode, &packetSize ) ==
+            DC1394_SUCCESS && packetSize > 0 &&
+            backend.format7GetTotalBytes( camera, mode, &totalBytes ) ==
+            DC1394_SUCCESS && totalBytes > 0 )
+    // One packet is sent per isochronous cycle of 125 microseconds.
+    retVal = 8000.0f / ( ( totalBytes + packetSize - 1 ) / packetSize );
+  return retVal;
+}
+
+int DC1394Select::defaultRank( dc1394video_mode_t mode, dc1394color_coding_t coding )
+{
+  // Same preference as the Ruby block used before. Modes which have to be
+  // converted or demosaiced come next and format7 modes come last.
+  static const dc1394color_coding_t preference[] = {
+    DC1394_COLOR_CODING_RGB8, DC1394_COLOR_CODING_YUV422,
+    DC1394_COLOR_CODING_MONO16, DC1394_COLOR_CODING_MONO8 };
+  static const int numPreferences = sizeof( preference ) / sizeof( preference[0] );
+  int retVal = numPreferences;
+  for ( int i=0; i<numPreferences; i++ )
+    if ( coding == preference[i] ) retVal = i;
+  if ( retVal == numPreferences ) {
+    try {
+      DC1394Convert::nativeTypecode( coding );
+    } catch ( Error & ) {
+      return -1;
+    };
+  };
+  if ( dc1394_is_video_mode_scalable( mode ) ) retVal += numPreferences + 1;
+  return retVal;
+}
+
@@ -16,21 +16,60 @@
 #ifndef HORNETSEYE_DC1394SELECT_HH
 #define HORNETSEYE_DC1394SELECT_HH
 
+#include <vector>
 #include <boost/smart_ptr.hpp>
 #include <dc1394/dc1394.h>
 #include <errno.h>
 #include "error.hh"
+#include "dc1394.hh"
 
+// Selection of the video mode. A block passed to "DC1394Input.new" overrides
+// the native policy.
 class DC1394Select
 {
 public:
+  struct Policy
+  {
+    // Acceptable color codings in order of preference (all if empty).
+    std::vector< dc1394color_coding_t > codings;
+    unsigned int minWidth;
+    unsigned int minHeight;
+    float minFrameRate;
+    // Maximum number of bytes per second (unlimited if zero). If set, the
+    // mode with the highest data rate within the budget is preferred.
+    double maxBandwidth;
+    // Exact video mode to use (any if zero).
+    int mode;
+    // Bytes per isochronous packet in format7 modes (recommended if zero).
+    uint32_t packetSize;
+  };
   DC1394Select(void) throw (Error);
   virtual ~DC1394Select(void);
-  void add( dc1394color_coding_t coding, unsigned int width, unsigned int height );
+  void add( dc1394video_mode_t mode, dc1394color_coding_t coding, unsigned int width,
+            unsigned int height, const std::vector< float > &frameRates );
+  void addModes( DC1394Backend &backend, dc1394camera_t *camera,
+                 DC1394::Camera &info );
+  const Policy &policy(void) const { return m_policy; }
+  void setPolicy( const Policy &policy ) { m_policy = policy; }
+  void setPolicy( VALUE rbPolicy ) throw (Error);
   unsigned int make(void) throw (Error);
-  static VALUE wrapRescue( VALUE rbValue );
+  unsigned int makeNative(void) throw (Error);
+  int frameRate(void) const { return m_frameRate; }
+  static float format7FrameRate( DC1394Backend &backend, dc1394camera_t *camera,
+                                 dc1394video_mode_t mode );
 protected:
-  VALUE m_rbArray;
+  struct Candidate
+  {
+    dc1394video_mode_t mode;
+    dc1394color_coding_t coding;
+    unsigned int width;
+    unsigned int height;
+    std::vector< float > frameRates;
+  };
+  static int defaultRank( dc1394video_mode_t mode, dc1394color_coding_t coding );
+  std::vector< Candidate > m_candidates;
+  Policy m_policy;
+  int m_frameRate;
 };
 
 typedef boost::shared_ptr< DC1394Select > DC1394SelectPtr;
@@ -0,0 +1,1344 @@
+/* HornetsEye - Computer Vision with Ruby
+   Copyright (C) 2006, 2007, 2008, 2009, 2010 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include "rubyinc.hh"
+#include "dc1394simulator.hh"
+#include "dc1394plan.hh"
+#include "pipe.hh"
+
+using namespace std;
+
+// Color coding and size of the fixed video modes starting with
+// DC1394_VIDEO_MODE_160x120_YUV444.
+static const struct
+{
+  dc1394color_coding_t coding;
+  uint32_t width;
+  uint32_t height;
+} FIXED_MODES[] = {
+  { DC1394_COLOR_CODING_YUV444,  160,  120 },
+  { DC1394_COLOR_CODING_YUV422,  320,  240 },
+  { DC1394_COLOR_CODING_YUV411,  640,  480 },
+  { DC1394_COLOR_CODING_YUV422,  640,  480 },
+  { DC1394_COLOR_CODING_RGB8  ,  640,  480 },
+  { DC1394_COLOR_CODING_MONO8 ,  640,  480 },
+  { DC1394_COLOR_CODING_MONO16,  640,  480 },
+  { DC1394_COLOR_CODING_YUV422,  800,  600 },
+  { DC1394_COLOR_CODING_RGB8  ,  800,  600 },
+  { DC1394_COLOR_CODING_MONO8 ,  800,  600 },
+  { DC1394_COLOR_CODING_YUV422, 1024,  768 },
+  { DC1394_COLOR_CODING_RGB8  , 1024,  768 },
+  { DC1394_COLOR_CODING_MONO8 , 1024,  768 },
+  { DC1394_COLOR_CODING_MONO16,  800,  600 },
+  { DC1394_COLOR_CODING_MONO16, 1024,  768 },
+  { DC1394_COLOR_CODING_YUV422, 1280,  960 },
+  { DC1394_COLOR_CODING_RGB8  , 1280,  960 },
+  { DC1394_COLOR_CODING_MONO8 , 1280,  960 },
+  { DC1394_COLOR_CODING_YUV422, 1600, 1200 },
+  { DC1394_COLOR_CODING_RGB8  , 1600, 1200 },
+  { DC1394_COLOR_CODING_MONO8 , 1600, 1200 },
+  { DC1394_COLOR_CODING_MONO16, 1280,  960 },
+  { DC1394_COLOR_CODING_MONO16, 1600, 1200 }
+};
+
+static const unsigned int NUM_FIXED_MODES =
+  sizeof(FIXED_MODES) / sizeof(FIXED_MODES[0]);
+
+// Range and initial value of the simulated features.
+static const struct
+{
+  dc1394feature_t id;
+  uint32_t min;
+  uint32_t max;
+  uint32_t value;
+} FEATURES[] = {
+  { DC1394_FEATURE_BRIGHTNESS   , 0,  255,  128 },
+  { DC1394_FEATURE_EXPOSURE     , 0, 1023,  512 },
+  { DC1394_FEATURE_SHARPNESS    , 0,  255,   80 },
+  { DC1394_FEATURE_WHITE_BALANCE, 0, 1023,  512 },
+  { DC1394_FEATURE_GAMMA        , 0,    1,    1 },
+  { DC1394_FEATURE_SHUTTER      , 1, 4095, 1000 },
+  { DC1394_FEATURE_GAIN         , 0,  680,    0 }
+};
+
+static const unsigned int NUM_FEATURES = sizeof(FEATURES) / sizeof(FEATURES[0]);
+
+// Colour bars: white, yellow, cyan, green, magenta, red, blue, and black.
+static const uint8_t BARS[8][3] = {
+  { 255, 255, 255 }, { 255, 255,   0 }, {   0, 255, 255 }, {   0, 255,   0 },
+  { 255,   0, 255 }, { 255,   0,   0 }, {   0,   0, 255 }, {   0,   0,   0 }
+};
+
+// GUID of the first simulated camera ("SIM" in ASCII).
+static const uint64_t SIMULATOR_GUID = 0x53494D0000000000ULL;
+
+// Duration of an isochronous cycle in microseconds.
+static const uint64_t CYCLE = 125;
+
+static uint64_t monotonic(void)
+{
+  struct timespec t;
+  clock_gettime( CLOCK_MONOTONIC, &t );
+  return (uint64_t)t.tv_sec * 1000000 + t.tv_nsec / 1000;
+}
+
+static uint64_t realtime(void)
+{
+  struct timespec t;
+  clock_gettime( CLOCK_REALTIME, &t );
+  return (uint64_t)t.tv_sec * 1000000 + t.tv_nsec / 1000;
+}
+
+DC1394Simulator::DC1394Simulator( const Config &config ) throw (Error):
+  m_config( config ), m_bandwidth( 0 )
+{
+  ERRORMACRO( !config.modes.empty() || config.format7Width > 0, Error, ,
+              "Simulated cameras need at least one video mode" );
+  for ( unsigned int i=0; i<config.cameras; i++ ) {
+    Camera *camera = new Camera;
+    memset( &camera->camera, 0, sizeof(camera->camera) );
+    camera->camera.guid = SIMULATOR_GUID + i;
+    camera->camera.unit = 0;
+    camera->camera.vendor = const_cast< char * >( "HornetsEye" );
+    camera->camera.model = const_cast< char * >( "Simulated camera" );
+    camera->camera.bmode_capable = config.bmode ? DC1394_TRUE : DC1394_FALSE;
+    camera->camera.one_shot_capable = DC1394_TRUE;
+    camera->camera.can_switch_on_off = DC1394_TRUE;
+    camera->simulator = this;
+    camera->open = false;
+    camera->bandwidth = 0;
+    camera->period = 0;
+    camera->triggers = 0;
+    camera->produced = 0;
+    camera->busReset = false;
+    camera->seed = i + 1;
+    camera->pipe[0] = camera->pipe[1] = -1;
+    camera->running = false;
+    camera->quit = false;
+    pthread_mutex_init( &camera->mutex, NULL );
+    pthread_condattr_t attr;
+    pthread_condattr_init( &attr );
+    pthread_condattr_setclock( &attr, CLOCK_MONOTONIC );
+    pthread_cond_init( &camera->cond, &attr );
+    pthread_condattr_destroy( &attr );
+    defaults( camera );
+    m_cameras.push_back( camera );
+  };
+}
+
+DC1394Simulator::~DC1394Simulator(void)
+{
+  for ( vector< Camera * >::iterator i = m_cameras.begin(); i != m_cameras.end();
+        i++ ) {
+    captureStop( &(*i)->camera );
+    pthread_cond_destroy( &(*i)->cond );
+    pthread_mutex_destroy( &(*i)->mutex );
+    delete *i;
+  };
+}
+
+DC1394Simulator::Config DC1394Simulator::config( VALUE rbOptions ) throw (Error)
+{
+  Config retVal;
+  retVal.cameras = 1;
+  retVal.modes.push_back( (dc1394video_mode_t)( DC1394_VIDEO_MODE_MIN + 5 ) );
+  retVal.modes.push_back( (dc1394video_mode_t)( DC1394_VIDEO_MODE_MIN + 3 ) );
+  retVal.frameRates.push_back( DC1394_FRAMERATE_7_5 );
+  retVal.frameRates.push_back( DC1394_FRAMERATE_15 );
+  retVal.frameRates.push_back( DC1394_FRAMERATE_30 );
+  retVal.format7Width = 0;
+  retVal.format7Height = 0;
+  retVal.format7Codings.push_back( DC1394_COLOR_CODING_RAW8 );
+  retVal.format7Codings.push_back( DC1394_COLOR_CODING_MONO8 );
+  retVal.format7Codings.push_back( DC1394_COLOR_CODING_RAW16 );
+  retVal.filter = DC1394_COLOR_FILTER_RGGB;
+  retVal.bmode = false;
+  retVal.dropRate = 0;
+  retVal.resetAfter = 0;
+  if ( NIL_P( rbOptions ) ) return retVal;
+  ERRORMACRO( TYPE( rbOptions ) == T_HASH, Error, , "Simulator options must be a "
+              "hash" );
+  VALUE rbCameras = rb_hash_aref( rbOptions, ID2SYM( rb_intern( "cameras" ) ) ),
+    rbModes = rb_hash_aref( rbOptions, ID2SYM( rb_intern( "modes" ) ) ),
+    rbFrameRates = rb_hash_aref( rbOptions, ID2SYM( rb_intern( "frame_rates" ) ) ),
+    rbFormat7Width = rb_hash_aref( rbOptions,
+                                   ID2SYM( rb_intern( "format7_width" ) ) ),
+    rbFormat7Height = rb_hash_aref( rbOptions,
+                                    ID2SYM( rb_intern( "format7_height" ) ) ),
+    rbFormat7Codings = rb_hash_aref( rbOptions,
+                                     ID2SYM( rb_intern( "format7_codings" ) ) ),
+    rbBayer = rb_hash_aref( rbOptions, ID2SYM( rb_intern( "bayer" ) ) ),
+    rbBMode = rb_hash_aref( rbOptions, ID2SYM( rb_intern( "b_mode" ) ) ),
+    rbDropRate = rb_hash_aref( rbOptions, ID2SYM( rb_intern( "drop_rate" ) ) ),
+    rbResetAfter = rb_hash_aref( rbOptions,
+                                 ID2SYM( rb_intern( "bus_reset_after" ) ) );
+  if ( !NIL_P( rbCameras ) ) retVal.cameras = NUM2UINT( rbCameras );
+  if ( !NIL_P( rbModes ) ) {
+    ERRORMACRO( TYPE( rbModes ) == T_ARRAY, Error, , "Value of :modes must be an "
+                "array" );
+    retVal.modes.clear();
+    for ( int i=0; i<RARRAY_LEN( rbModes ); i++ ) {
+      VALUE rbMode = rb_ary_entry( rbModes, i );
+      ERRORMACRO( TYPE( rbMode ) == T_ARRAY && RARRAY_LEN( rbMode ) == 3, Error, ,
+                  "Each video mode must be an array with color coding, width, and "
+                  "height" );
+      dc1394color_coding_t coding =
+        (dc1394color_coding_t)NUM2INT( rb_ary_entry( rbMode, 0 ) );
+      uint32_t width = NUM2UINT( rb_ary_entry( rbMode, 1 ) ),
+        height = NUM2UINT( rb_ary_entry( rbMode, 2 ) );
+      unsigned int j = 0;
+      while ( j < NUM_FIXED_MODES &&
+              ( FIXED_MODES[j].coding != coding || FIXED_MODES[j].width != width ||
+                FIXED_MODES[j].height != height ) )
+        j++;
+      ERRORMACRO( j < NUM_FIXED_MODES, Error, , "There is no fixed video mode with "
+                  "color coding " << coding << " and size " << width << 'x'
+                  << height << ". Use :format7_width and :format7_height for "
+                  "other image sizes" );
+      retVal.modes.push_back( (dc1394video_mode_t)( DC1394_VIDEO_MODE_MIN + j ) );
+    };
+  };
+  if ( !NIL_P( rbFrameRates ) ) {
+    ERRORMACRO( TYPE( rbFrameRates ) == T_ARRAY, Error, , "Value of :frame_rates "
+                "must be an array" );
+    retVal.frameRates.clear();
+    for ( int i=0; i<RARRAY_LEN( rbFrameRates ); i++ ) {
+      int frameRate = NUM2INT( rb_ary_entry( rbFrameRates, i ) );
+      ERRORMACRO( frameRate >= DC1394_FRAMERATE_MIN &&
+                  frameRate <= DC1394_FRAMERATE_MAX, Error, , "Unknown frame rate "
+                  << frameRate );
+      retVal.frameRates.push_back( (dc1394framerate_t)frameRate );
+    };
+    // Cameras report frame rates in ascending order.
+    sort( retVal.frameRates.begin(), retVal.frameRates.end() );
+    retVal.frameRates.erase( unique( retVal.frameRates.begin(),
+                                     retVal.frameRates.end() ),
+                             retVal.frameRates.end() );
+  };
+  ERRORMACRO( !retVal.frameRates.empty() || retVal.modes.empty(), Error, ,
+              "Fixed video modes require at least one frame rate" );
+  if ( !NIL_P( rbFormat7Width ) ) retVal.format7Width = NUM2UINT( rbFormat7Width );
+  if ( !NIL_P( rbFormat7Height ) ) retVal.format7Height = NUM2UINT( rbFormat7Height );
+  ERRORMACRO( retVal.format7Width % 8 == 0 && retVal.format7Height % 2 == 0 &&
+              ( retVal.format7Width > 0 ) == ( retVal.format7Height > 0 ), Error, ,
+              "Format7 image size must be a multiple of 8x2 (but was "
+              << retVal.format7Width << 'x' << retVal.format7Height << ")" );
+  if ( !NIL_P( rbFormat7Codings ) ) {
+    ERRORMACRO( TYPE( rbFormat7Codings ) == T_ARRAY, Error, , "Value of "
+                ":format7_codings must be an array" );
+    retVal.format7Codings.clear();
+    for ( int i=0; i<RARRAY_LEN( rbFormat7Codings ); i++ ) {
+      int coding = NUM2INT( rb_ary_entry( rbFormat7Codings, i ) );
+      ERRORMACRO( coding >= DC1394_COLOR_CODING_MONO8 &&
+                  coding < DC1394_COLOR_CODING_MONO8 + DC1394_COLOR_CODING_NUM,
+                  Error, , "Unknown color coding " << coding );
+      retVal.format7Codings.push_back( (dc1394color_coding_t)coding );
+    };
+    ERRORMACRO( !retVal.format7Codings.empty(), Error, , "Value of "
+                ":format7_codings must not be empty" );
+  };
+  if ( !NIL_P( rbBayer ) ) {
+    int filter = NUM2INT( rbBayer );
+    ERRORMACRO( filter >= DC1394_COLOR_FILTER_RGGB &&
+                filter <= DC1394_COLOR_FILTER_BGGR, Error, , "Unknown Bayer pattern "
+                << filter );
+    retVal.filter = (dc1394color_filter_t)filter;
+  };
+  retVal.bmode = RTEST( rbBMode );
+  if ( !NIL_P( rbDropRate ) ) retVal.dropRate = NUM2DBL( rbDropRate );
+  ERRORMACRO( retVal.dropRate >= 0 && retVal.dropRate < 1, Error, , "Drop rate must "
+              "be in [ 0; 1 ) (but was " << retVal.dropRate << ")" );
+  if ( !NIL_P( rbResetAfter ) ) retVal.resetAfter = NUM2UINT( rbResetAfter );
+  return retVal;
+}
+
+bool DC1394Simulator::simulated(void) const
+{
+  return true;
+}
+
+DC1394Simulator::Camera *DC1394Simulator::get( dc1394camera_t *camera ) const
+{
+  for ( vector< Camera * >::const_iterator i = m_cameras.begin();
+        i != m_cameras.end(); i++ )
+    if ( &(*i)->camera == camera ) return *i;
+  return NULL;
+}
+
+void DC1394Simulator::defaults( Camera *camera )
+{
+  // Fastest frame rate of the first video mode at S400.
+  camera->mode = m_config.modes.empty() ? DC1394_VIDEO_MODE_FORMAT7_0 :
+    m_config.modes.front();
+  camera->frameRate = m_config.frameRates.empty() ? DC1394_FRAMERATE_MAX :
+    m_config.frameRates.back();
+  camera->speed = DC1394_ISO_SPEED_400;
+  camera->operationMode = DC1394_OPERATION_MODE_LEGACY;
+  camera->transmission = false;
+  camera->coding = m_config.format7Codings.front();
+  camera->left = 0;
+  camera->top = 0;
+  camera->width = m_config.format7Width;
+  camera->height = m_config.format7Height;
+  camera->packetSize = maxBytes( camera->speed );
+  memset( &camera->features, 0, sizeof(camera->features) );
+  for ( int i=0; i<DC1394_FEATURE_NUM; i++ ) {
+    dc1394feature_info_t &feature = camera->features.feature[i];
+    feature.id = (dc1394feature_t)( DC1394_FEATURE_MIN + i );
+    feature.current_mode = DC1394_FEATURE_MODE_MANUAL;
+    feature.trigger_mode = DC1394_TRIGGER_MODE_0;
+    feature.trigger_polarity = DC1394_TRIGGER_ACTIVE_LOW;
+    feature.trigger_source = DC1394_TRIGGER_SOURCE_0;
+  };
+  for ( unsigned int i=0; i<NUM_FEATURES; i++ ) {
+    dc1394feature_info_t &feature =
+      camera->features.feature[ FEATURES[i].id - DC1394_FEATURE_MIN ];
+    feature.available = DC1394_TRUE;
+    feature.readout_capable = DC1394_TRUE;
+    feature.on_off_capable = DC1394_TRUE;
+    feature.is_on = DC1394_ON;
+    feature.modes.num = 3;
+    feature.modes.modes[0] = DC1394_FEATURE_MODE_MANUAL;
+    feature.modes.modes[1] = DC1394_FEATURE_MODE_AUTO;
+    feature.modes.modes[2] = DC1394_FEATURE_MODE_ONE_PUSH_AUTO;
+    feature.min = FEATURES[i].min;
+    feature.max = FEATURES[i].max;
+    feature.value = FEATURES[i].value;
+    feature.BU_value = FEATURES[i].value;
+    feature.RV_value = FEATURES[i].value;
+  };
+  dc1394feature_info_t &trigger =
+    camera->features.feature[ DC1394_FEATURE_TRIGGER - DC1394_FEATURE_MIN ];
+  trigger.available = DC1394_TRUE;
+  trigger.on_off_capable = DC1394_TRUE;
+  trigger.polarity_capable = DC1394_TRUE;
+  trigger.is_on = DC1394_OFF;
+  trigger.trigger_modes.num = 4;
+  trigger.trigger_modes.modes[0] = DC1394_TRIGGER_MODE_0;
+  trigger.trigger_modes.modes[1] = DC1394_TRIGGER_MODE_1;
+  trigger.trigger_modes.modes[2] = DC1394_TRIGGER_MODE_14;
+  trigger.trigger_modes.modes[3] = DC1394_TRIGGER_MODE_15;
+  trigger.trigger_sources.num = 2;
+  trigger.trigger_sources.sources[0] = DC1394_TRIGGER_SOURCE_0;
+  trigger.trigger_sources.sources[1] = DC1394_TRIGGER_SOURCE_SOFTWARE;
+}
+
+uint32_t DC1394Simulator::maxBytes( dc1394speed_t speed )
+{
+  // Largest isochronous payload at the given speed.
+  return 1024 << speed;
+}
+
+dc1394error_t DC1394Simulator::geometry( Camera *camera, dc1394color_coding_t *coding,
+                                         uint32_t *width, uint32_t *height,
+                                         uint32_t *packetSize )
+{
+  uint32_t bits;
+  if ( camera->mode == DC1394_VIDEO_MODE_FORMAT7_0 ) {
+    *coding = camera->coding;
+    *width = camera->width;
+    *height = camera->height;
+    *packetSize = camera->packetSize;
+  } else {
+    unsigned int index = camera->mode - DC1394_VIDEO_MODE_MIN;
+    float fps;
+    if ( index >= NUM_FIXED_MODES ||
+         dc1394_get_color_coding_bit_size( FIXED_MODES[ index ].coding, &bits ) !=
+         DC1394_SUCCESS ||
+         dc1394_framerate_as_float( camera->frameRate, &fps ) != DC1394_SUCCESS )
+      return DC1394_FAILURE;
+    *coding = FIXED_MODES[ index ].coding;
+    *width = FIXED_MODES[ index ].width;
+    *height = FIXED_MODES[ index ].height;
+    // Fixed modes send one packet per isochronous cycle.
+    uint64_t frameBytes = (uint64_t)*width * *height * bits / 8;
+    *packetSize = (uint32_t)( ( frameBytes * fps / 8000 + 3 ) / 4 ) * 4;
+  };
+  return DC1394_SUCCESS;
+}
+
+void DC1394Simulator::fill( Camera *camera )
+{
+  for ( unsigned int n=0; n<camera->frames.size(); n++ ) {
+    dc1394video_frame_t &frame = camera->frames[n];
+    uint32_t width = frame.size[0], height = frame.size[1];
+    // The bars move by 8 pixels from one buffer to the next.
+    unsigned int shift = n * 8;
+    for ( uint32_t y=0; y<height; y++ ) {
+      uint8_t *p = frame.image + (size_t)y * frame.stride;
+      for ( uint32_t x=0; x<width; x++ ) {
+        const uint8_t *rgb = BARS[ ( ( x + shift ) * 8 / width ) % 8 ];
+        uint8_t r = rgb[0], g = rgb[1], b = rgb[2];
+        int luma = ( 77 * r + 150 * g + 29 * b ) >> 8;
+        int u = ( ( -43 * r - 85 * g + 128 * b ) >> 8 ) + 128;
+        int v = ( ( 128 * r - 107 * g - 21 * b ) >> 8 ) + 128;
+        uint8_t sample;
+        switch ( frame.color_filter ) {
+        case DC1394_COLOR_FILTER_GBRG:
+          sample = ( y & 1 ) == ( x & 1 ) ? g : ( y & 1 ) ? r : b;
+          break;
+        case DC1394_COLOR_FILTER_GRBG:
+          sample = ( y & 1 ) == ( x & 1 ) ? g : ( y & 1 ) ? b : r;
+          break;
+        case DC1394_COLOR_FILTER_BGGR:
+          sample = ( y & 1 ) != ( x & 1 ) ? g : ( y & 1 ) ? r : b;
+          break;
+        default:
+          sample = ( y & 1 ) != ( x & 1 ) ? g : ( y & 1 ) ? b : r;
+        };
+        switch ( frame.color_coding ) {
+        case DC1394_COLOR_CODING_MONO8:
+          *p++ = luma;
+          break;
+        case DC1394_COLOR_CODING_RAW8:
+          *p++ = sample;
+          break;
+        case DC1394_COLOR_CODING_RGB8:
+          *p++ = r; *p++ = g; *p++ = b;
+          break;
+        case DC1394_COLOR_CODING_YUV444:
+          *p++ = u; *p++ = luma; *p++ = v;
+          break;
+        case DC1394_COLOR_CODING_YUV422:
+          // UYVY with the chroma of the even pixel.
+          if ( ( x & 1 ) == 0 ) *p++ = u; else *p++ = v;
+          *p++ = luma;
+          break;
+        case DC1394_COLOR_CODING_YUV411:
+          // UYYVYY with the chroma of the first pixel.
+          if ( ( x & 3 ) == 0 ) *p++ = u;
+          if ( ( x & 3 ) == 2 ) *p++ = v;
+          *p++ = luma;
+          break;
+        default: {
+          // 16 bit codings are delivered in network byte order.
+          uint16_t values[3];
+          int channels = 1;
+          switch ( frame.color_coding ) {
+          case DC1394_COLOR_CODING_RGB16:
+          case DC1394_COLOR_CODING_RGB16S:
+            values[0] = r << 8; values[1] = g << 8; values[2] = b << 8;
+            channels = 3;
+            break;
+          case DC1394_COLOR_CODING_RAW16:
+            values[0] = sample << 8;
+            break;
+          default:
+            values[0] = luma << 8;
+          };
+          for ( int c=0; c<channels; c++ ) {
+            *p++ = values[c] >> 8; *p++ = values[c] & 0xFF;
+          };
+        }};
+      };
+    };
+  };
+}
+
+bool DC1394Simulator::start( Camera *camera )
+{
+  if ( !camera->running && !camera->frames.empty() ) {
+    camera->quit = false;
+    camera->running =
+      pthread_create( &camera->thread, NULL, produceThread, camera ) == 0;
+  };
+  return camera->running;
+}
+
+void DC1394Simulator::stop( Camera *camera )
+{
+  if ( camera->running ) {
+    pthread_mutex_lock( &camera->mutex );
+    camera->quit = true;
+    pthread_cond_signal( &camera->cond );
+    pthread_mutex_unlock( &camera->mutex );
+    pthread_join( camera->thread, NULL );
+    camera->running = false;
+  };
+}
+
+void DC1394Simulator::produce( Camera *camera )
+{
+  pthread_mutex_lock( &camera->mutex );
+  uint64_t next = monotonic() + camera->period;
+  while ( !camera->quit && !camera->busReset ) {
+    const dc1394feature_info_t &trigger =
+      camera->features.feature[ DC1394_FEATURE_TRIGGER - DC1394_FEATURE_MIN ];
+    if ( trigger.is_on != DC1394_OFF ) {
+      // Only software triggers are simulated.
+      if ( camera->triggers == 0 ) {
+        pthread_cond_wait( &camera->cond, &camera->mutex );
+        continue;
+      };
+      camera->triggers--;
+      next = monotonic() + camera->period;
+    } else {
+      uint64_t now = monotonic();
+      if ( now < next ) {
+        struct timespec t;
+        t.tv_sec = next / 1000000;
+        t.tv_nsec = ( next % 1000000 ) * 1000;
+        pthread_cond_timedwait( &camera->cond, &camera->mutex, &t );
+        continue;
+      };
+      // Frames are not caught up if the thread was not scheduled in time.
+      next += camera->period;
+      if ( next <= now ) next = now + camera->period;
+    };
+    deliver( camera );
+  };
+  pthread_mutex_unlock( &camera->mutex );
+}
+
+void DC1394Simulator::deliver( Camera *camera )
+{
+  camera->produced++;
+  if ( m_config.resetAfter > 0 && camera->produced > m_config.resetAfter ) {
+    // A bus reset stops the isochronous transmission.
+    camera->busReset = true;
+    camera->transmission = false;
+    signalPipe( camera->pipe[1] );
+    return;
+  };
+  // The frame gets lost on the bus or there is no free DMA buffer.
+  if ( m_config.dropRate > 0 &&
+       rand_r( &camera->seed ) < m_config.dropRate * RAND_MAX )
+    return;
+  if ( camera->free.empty() ) return;
+  unsigned int index = camera->free.front();
+  camera->free.pop_front();
+  dc1394video_frame_t &frame = camera->frames[ index ];
+  memcpy( frame.image, &camera->pattern[0] + ( frame.image - &camera->memory[0] ),
+          frame.image_bytes );
+  frame.timestamp = realtime();
+  camera->ready.push_back( index );
+  signalPipe( camera->pipe[1] );
+}
+
+void *DC1394Simulator::produceThread( void *ptr )
+{
+  Camera *camera = (Camera *)ptr;
+  camera->simulator->produce( camera );
+  return NULL;
+}
+
+dc1394error_t DC1394Simulator::cameraEnumerate( dc1394camera_list_t **list )
+{
+  dc1394camera_list_t *retVal =
+    (dc1394camera_list_t *)calloc( 1, sizeof(dc1394camera_list_t) );
+  if ( retVal == NULL ) return DC1394_FAILURE;
+  retVal->num = m_cameras.size();
+  retVal->ids = (dc1394camera_id_t *)calloc( retVal->num + 1,
+                                             sizeof(dc1394camera_id_t) );
+  if ( retVal->ids == NULL ) {
+    free( retVal );
+    return DC1394_FAILURE;
+  };
+  for ( unsigned int i=0; i<retVal->num; i++ ) {
+    retVal->ids[i].guid = m_cameras[i]->camera.guid;
+    retVal->ids[i].unit = m_cameras[i]->camera.unit;
+  };
+  *list = retVal;
+  return DC1394_SUCCESS;
+}
+
+void DC1394Simulator::cameraFreeList( dc1394camera_list_t *list )
+{
+  if ( list != NULL ) {
+    free( list->ids );
+    free( list );
+  };
+}
+
+dc1394camera_t *DC1394Simulator::cameraNewUnit( uint64_t guid, int unit )
+{
+  for ( vector< Camera * >::iterator i = m_cameras.begin(); i != m_cameras.end();
+        i++ )
+    if ( (*i)->camera.guid == guid && ( unit < 0 || (*i)->camera.unit == unit ) ) {
+      // A camera can only be used by one handle at a time.
+      if ( (*i)->open ) return NULL;
+      (*i)->open = true;
+      return &(*i)->camera;
+    };
+  return NULL;
+}
+
+void DC1394Simulator::cameraFree( dc1394camera_t *camera )
+{
+  Camera *c = get( camera );
+  captureStop( camera );
+  c->open = false;
+}
+
+dc1394error_t DC1394Simulator::cameraSetPower( dc1394camera_t *camera,
+                                               dc1394switch_t power )
+{
+  Camera *c = get( camera );
+  if ( power == DC1394_OFF ) {
+    stop( c );
+    pthread_mutex_lock( &c->mutex );
+    defaults( c );
+    pthread_mutex_unlock( &c->mutex );
+  };
+  return DC1394_SUCCESS;
+}
+
+dc1394error_t DC1394Simulator::videoGetSupportedModes( dc1394camera_t *camera,
+                                                       dc1394video_modes_t *modes )
+{
+  modes->num = 0;
+  for ( vector< dc1394video_mode_t >::const_iterator i = m_config.modes.begin();
+        i != m_config.modes.end() && modes->num < DC1394_VIDEO_MODE_NUM; i++ )
+    modes->modes[ modes->num++ ] = *i;
+  if ( m_config.format7Width > 0 && modes->num < DC1394_VIDEO_MODE_NUM )
+    modes->modes[ modes->num++ ] = DC1394_VIDEO_MODE_FORMAT7_0;
+  return DC1394_SUCCESS;
+}
+
+dc1394error_t DC1394Simulator::videoGetSupportedFramerates( dc1394camera_t *camera,
+                                                            dc1394video_mode_t mode,
+                                                            dc1394framerates_t *rates )
+{
+  if ( find( m_config.modes.begin(), m_config.modes.end(), mode ) ==
+       m_config.modes.end() )
+    return DC1394_FAILURE;
+  rates->num = 0;
+  for ( vector< dc1394framerate_t >::const_iterator i = m_config.frameRates.begin();
+        i != m_config.frameRates.end() && rates->num < DC1394_FRAMERATE_NUM; i++ )
+    rates->framerates[ rates->num++ ] = *i;
+  return DC1394_SUCCESS;
+}
+
+dc1394error_t DC1394Simulator::videoSetMode( dc1394camera_t *camera,
+                                             dc1394video_mode_t mode )
+{
+  Camera *c = get( camera );
+  if ( !c->frames.empty() ) return DC1394_FAILURE;
+  if ( find( m_config.modes.begin(), m_config.modes.end(), mode ) ==
+       m_config.modes.end() &&
+       ( mode != DC1394_VIDEO_MODE_FORMAT7_0 || m_config.format7Width == 0 ) )
+    return DC1394_FAILURE;
+  c->mode = mode;
+  return DC1394_SUCCESS;
+}
+
+dc1394error_t DC1394Simulator::videoGetMode( dc1394camera_t *camera,
+                                             dc1394video_mode_t *mode )
+{
+  *mode = get( camera )->mode;
+  return DC1394_SUCCESS;
+}
+
+dc1394error_t DC1394Simulator::videoSetFramerate( dc1394camera_t *camera,
+                                                  dc1394framerate_t rate )
+{
+  Camera *c = get( camera );
+  if ( !c->frames.empty() || c->mode == DC1394_VIDEO_MODE_FORMAT7_0 ||
+       find( m_config.frameRates.begin(), m_config.frameRates.end(), rate ) ==
+       m_config.frameRates.end() )
+    return DC1394_FAILURE;
+  c->frameRate = rate;
+  return DC1394_SUCCESS;
+}
+
+dc1394error_t DC1394Simulator::videoGetFramerate( dc1394camera_t *camera,
+                                                  dc1394framerate_t *rate )
+{
+  Camera *c = get( camera );
+  if ( c->mode == DC1394_VIDEO_MODE_FORMAT7_0 ) return DC1394_FAILURE;
+  *rate = c->frameRate;
+  return DC1394_SUCCESS;
+}
+
+dc1394error_t DC1394Simulator::videoSetIsoSpeed( dc1394camera_t *camera,
+                                                 dc1394speed_t speed )
+{
+  Camera *c = get( camera );
+  // Simulated 1394b cameras support up to S800.
+  if ( !c->frames.empty() || speed < DC1394_ISO_SPEED_MIN ||
+       speed > DC1394_ISO_SPEED_800 ||
+       ( speed > DC1394_ISO_SPEED_400 &&
+         c->operationMode != DC1394_OPERATION_MODE_1394B ) )
+    return DC1394_FAILURE;
+  c->speed = speed;
+  c->packetSize = min( c->packetSize, maxBytes( speed ) );
+  return DC1394_SUCCESS;
+}
+
+dc1394error_t DC1394Simulator::videoGetIsoSpeed( dc1394camera_t *camera,
+                                                 dc1394speed_t *speed )
+{
+  *speed = get( camera )->speed;
+  return DC1394_SUCCESS;
+}
+
+dc1394error_t DC1394Simulator::videoSetOperationMode( dc1394camera_t *camera,
+                                                      dc1394operation_mode_t mode )
+{
+  Camera *c = get( camera );
+  if ( !c->frames.empty() ) return DC1394_FAILURE;
+  if ( mode == DC1394_OPERATION_MODE_1394B ) {
+    if ( !m_config.bmode ) return DC1394_FAILURE;
+  } else if ( mode == DC1394_OPERATION_MODE_LEGACY ) {
+    if ( c->speed > DC1394_ISO_SPEED_400 ) videoSetIsoSpeed( camera,
+                                                             DC1394_ISO_SPEED_400 );
+  } else
+    return DC1394_INVALID_ARGUMENT_VALUE;
+  c->operationMode = mode;
+  return DC1394_SUCCESS;
+}
+
+dc1394error_t DC1394Simulator::videoGetOperationMode( dc1394camera_t *camera,
+                                                      dc1394operation_mode_t *mode )
+{
+  *mode = get( camera )->operationMode;
+  return DC1394_SUCCESS;
+}
+
+dc1394error_t DC1394Simulator::videoSetTransmission( dc1394camera_t *camera,
+                                                     dc1394switch_t power )
+{
+  Camera *c = get( camera );
+  if ( power != DC1394_OFF ) {
+    c->transmission = true;
+    if ( !c->frames.empty() && !start( c ) ) return DC1394_FAILURE;
+  } else {
+    stop( c );
+    c->transmission = false;
+  };
+  return DC1394_SUCCESS;
+}
+
+dc1394error_t DC1394Simulator::videoGetBandwidthUsage( dc1394camera_t *camera,
+                                                       uint32_t *units )
+{
+  Camera *c = get( camera );
+  dc1394color_coding_t coding;
+  uint32_t width, height, packetSize;
+  dc1394error_t err = geometry( c, &coding, &width, &height, &packetSize );
+  if ( err != DC1394_SUCCESS ) return err;
+  *units = DC1394Plan::bandwidth( packetSize, c->speed );
+  return DC1394_SUCCESS;
+}
+
+dc1394error_t DC1394Simulator::getColorCodingFromVideoMode
+  ( dc1394camera_t *camera, dc1394video_mode_t mode, dc1394color_coding_t *coding )
+{
+  if ( mode == DC1394_VIDEO_MODE_FORMAT7_0 && m_config.format7Width > 0 ) {
+    *coding = get( camera )->coding;
+    return DC1394_SUCCESS;
+  };
+  unsigned int index = mode - DC1394_VIDEO_MODE_MIN;
+  if ( index >= NUM_FIXED_MODES ) return DC1394_FAILURE;
+  *coding = FIXED_MODES[ index ].coding;
+  return DC1394_SUCCESS;
+}
+
+dc1394error_t DC1394Simulator::getImageSizeFromVideoMode( dc1394camera_t *camera,
+                                                          dc1394video_mode_t mode,
+                                                          uint32_t *width,
+                                                          uint32_t *height )
+{
+  if ( mode == DC1394_VIDEO_MODE_FORMAT7_0 && m_config.format7Width > 0 ) {
+    *width = get( camera )->width;
+    *height = get( camera )->height;
+    return DC1394_SUCCESS;
+  };
+  unsigned int index = mode - DC1394_VIDEO_MODE_MIN;
+  if ( index >= NUM_FIXED_MODES ) return DC1394_FAILURE;
+  *width = FIXED_MODES[ index ].width;
+  *height = FIXED_MODES[ index ].height;
+  return DC1394_SUCCESS;
+}
+
+dc1394error_t DC1394Simulator::format7GetMaxImageSize( dc1394camera_t *camera,
+                                                       dc1394video_mode_t mode,
+                                                       uint32_t *width,
+                                                       uint32_t *height )
+{
+  if ( mode != DC1394_VIDEO_MODE_FORMAT7_0 || m_config.format7Width == 0 )
+    return DC1394_FAILURE;
+  *width = m_config.format7Width;
+  *height = m_config.format7Height;
+  return DC1394_SUCCESS;
+}
+
+dc1394error_t DC1394Simulator::format7GetUnitSize( dc1394camera_t *camera,
+                                                   dc1394video_mode_t mode,
+                                                   uint32_t *width, uint32_t *height )
+{
+  if ( mode != DC1394_VIDEO_MODE_FORMAT7_0 || m_config.format7Width == 0 )
+    return DC1394_FAILURE;
+  *width = 8;
+  *height = 2;
+  return DC1394_SUCCESS;
+}
+
+dc1394error_t DC1394Simulator::format7GetUnitPosition( dc1394camera_t *camera,
+                                                       dc1394video_mode_t mode,
+                                                       uint32_t *left, uint32_t *top )
+{
+  if ( mode != DC1394_VIDEO_MODE_FORMAT7_0 || m_config.format7Width == 0 )
+    return DC1394_FAILURE;
+  // Like many cameras there is no separate unit for the position.
+  *left = 0;
+  *top = 0;
+  return DC1394_SUCCESS;
+}
+
+dc1394error_t DC1394Simulator::format7GetPacketParameters( dc1394camera_t *camera,
+                                                           dc1394video_mode_t mode,
+                                                           uint32_t *unitBytes,
+                                                           uint32_t *maxBytes )
+{
+  if ( mode != DC1394_VIDEO_MODE_FORMAT7_0 || m_config.format7Width == 0 )
+    return DC1394_FAILURE;
+  *unitBytes = 4;
+  *maxBytes = DC1394Simulator::maxBytes( get( camera )->speed );
+  return DC1394_SUCCESS;
+}
+
+dc1394error_t DC1394Simulator::format7GetPacketSize( dc1394camera_t *camera,
+                                                     dc1394video_mode_t mode,
+                                                     uint32_t *packetSize )
+{
+  if ( mode != DC1394_VIDEO_MODE_FORMAT7_0 || m_config.format7Width == 0 )
+    return DC1394_FAILURE;
+  *packetSize = get( camera )->packetSize;
+  return DC1394_SUCCESS;
+}
+
+dc1394error_t DC1394Simulator::format7SetPacketSize( dc1394camera_t *camera,
+                                                     dc1394video_mode_t mode,
+                                                     uint32_t packetSize )
+{
+  Camera *c = get( camera );
+  if ( mode != DC1394_VIDEO_MODE_FORMAT7_0 || m_config.format7Width == 0 ||
+       !c->frames.empty() )
+    return DC1394_FAILURE;
+  if ( packetSize == 0 || packetSize % 4 != 0 || packetSize > maxBytes( c->speed ) )
+    return DC1394_INVALID_ARGUMENT_VALUE;
+  c->packetSize = packetSize;
+  return DC1394_SUCCESS;
+}
+
+dc1394error_t DC1394Simulator::format7GetTotalBytes( dc1394camera_t *camera,
+                                                     dc1394video_mode_t mode,
+                                                     uint64_t *totalBytes )
+{
+  Camera *c = get( camera );
+  uint32_t bits;
+  if ( mode != DC1394_VIDEO_MODE_FORMAT7_0 || m_config.format7Width == 0 ||
+       dc1394_get_color_coding_bit_size( c->coding, &bits ) != DC1394_SUCCESS )
+    return DC1394_FAILURE;
+  *totalBytes = (uint64_t)c->width * c->height * bits / 8;
+  return DC1394_SUCCESS;
+}
+
+dc1394error_t DC1394Simulator::format7GetColorCodings( dc1394camera_t *camera,
+                                                       dc1394video_mode_t mode,
+                                                       dc1394color_codings_t *codings )
+{
+  if ( mode != DC1394_VIDEO_MODE_FORMAT7_0 || m_config.format7Width == 0 )
+    return DC1394_FAILURE;
+  codings->num = 0;
+  for ( vector< dc1394color_coding_t >::const_iterator i =
+          m_config.format7Codings.begin();
+        i != m_config.format7Codings.end() && codings->num < DC1394_COLOR_CODING_NUM;
+        i++ )
+    codings->codings[ codings->num++ ] = *i;
+  return DC1394_SUCCESS;
+}
+
+dc1394error_t DC1394Simulator::format7GetColorFilter( dc1394camera_t *camera,
+                                                      dc1394video_mode_t mode,
+                                                      dc1394color_filter_t *filter )
+{
+  if ( mode != DC1394_VIDEO_MODE_FORMAT7_0 || m_config.format7Width == 0 )
+    return DC1394_FAILURE;
+  *filter = m_config.filter;
+  return DC1394_SUCCESS;
+}
+
+dc1394error_t DC1394Simulator::format7GetFrameInterval( dc1394camera_t *camera,
+                                                        dc1394video_mode_t mode,
+                                                        float *interval )
+{
+  Camera *c = get( camera );
+  uint64_t totalBytes;
+  dc1394error_t err = format7GetTotalBytes( camera, mode, &totalBytes );
+  if ( err != DC1394_SUCCESS ) return err;
+  // One packet is sent per isochronous cycle.
+  uint64_t packets = ( totalBytes + c->packetSize - 1 ) / c->packetSize;
+  *interval = packets * CYCLE * 1e-6f;
+  return DC1394_SUCCESS;
+}
+
+dc1394error_t DC1394Simulator::format7GetRoi( dc1394camera_t *camera,
+                                              dc1394video_mode_t mode,
+                                              dc1394color_coding_t *coding,
+                                              uint32_t *packetSize, uint32_t *left,
+                                              uint32_t *top, uint32_t *width,
+                                              uint32_t *height )
+{
+  Camera *c = get( camera );
+  if ( mode != DC1394_VIDEO_MODE_FORMAT7_0 || m_config.format7Width == 0 )
+    return DC1394_FAILURE;
+  *coding = c->coding;
+  *packetSize = c->packetSize;
+  *left = c->left;
+  *top = c->top;
+  *width = c->width;
+  *height = c->height;
+  return DC1394_SUCCESS;
+}
+
+dc1394error_t DC1394Simulator::format7SetRoi( dc1394camera_t *camera,
+                                              dc1394video_mode_t mode,
+                                              dc1394color_coding_t coding,
+                                              int32_t packetSize, int32_t left,
+                                              int32_t top, int32_t width,
+                                              int32_t height )
+{
+  Camera *c = get( camera );
+  if ( mode != DC1394_VIDEO_MODE_FORMAT7_0 || m_config.format7Width == 0 ||
+       !c->frames.empty() )
+    return DC1394_FAILURE;
+  if ( find( m_config.format7Codings.begin(), m_config.format7Codings.end(),
+             coding ) == m_config.format7Codings.end() )
+    return DC1394_INVALID_ARGUMENT_VALUE;
+  uint32_t l = left == DC1394_QUERY_FROM_CAMERA ? c->left : (uint32_t)left,
+    t = top == DC1394_QUERY_FROM_CAMERA ? c->top : (uint32_t)top;
+  uint32_t w = width == DC1394_QUERY_FROM_CAMERA ? c->width :
+    width == DC1394_USE_MAX_AVAIL ? m_config.format7Width - l : (uint32_t)width,
+    h = height == DC1394_QUERY_FROM_CAMERA ? c->height :
+    height == DC1394_USE_MAX_AVAIL ? m_config.format7Height - t : (uint32_t)height;
+  if ( l % 8 != 0 || t % 2 != 0 || w == 0 || h == 0 || w % 8 != 0 || h % 2 != 0 ||
+       l + w > m_config.format7Width || t + h > m_config.format7Height )
+    return DC1394_INVALID_ARGUMENT_VALUE;
+  uint32_t p = c->packetSize;
+  if ( packetSize == DC1394_USE_RECOMMENDED || packetSize == DC1394_USE_MAX_AVAIL )
+    p = maxBytes( c->speed );
+  else if ( packetSize != DC1394_QUERY_FROM_CAMERA ) {
+    if ( packetSize <= 0 || packetSize % 4 != 0 ||
+         (uint32_t)packetSize > maxBytes( c->speed ) )
+      return DC1394_INVALID_ARGUMENT_VALUE;
+    p = packetSize;
+  };
+  c->coding = coding;
+  c->packetSize = p;
+  c->left = l;
+  c->top = t;
+  c->width = w;
+  c->height = h;
+  return DC1394_SUCCESS;
+}
+
+dc1394error_t DC1394Simulator::captureSetup( dc1394camera_t *camera,
+                                             uint32_t numBuffers, uint32_t flags )
+{
+  Camera *c = get( camera );
+  if ( !c->frames.empty() ) return DC1394_FAILURE;
+  if ( numBuffers == 0 ) return DC1394_INVALID_ARGUMENT_VALUE;
+  dc1394color_coding_t coding;
+  uint32_t width, height, packetSize, bits;
+  dc1394error_t err = geometry( c, &coding, &width, &height, &packetSize );
+  if ( err != DC1394_SUCCESS ) return err;
+  err = dc1394_get_color_coding_bit_size( coding, &bits );
+  if ( err != DC1394_SUCCESS ) return err;
+  if ( packetSize == 0 ) return DC1394_FAILURE;
+  // All simulated cameras share one bus.
+  uint32_t bandwidth = DC1394Plan::bandwidth( packetSize, c->speed );
+  if ( m_bandwidth + bandwidth > DC1394Plan::BUS_BANDWIDTH ) return DC1394_FAILURE;
+  if ( pipe( c->pipe ) != 0 ) return DC1394_FAILURE;
+  fcntl( c->pipe[0], F_SETFL, O_NONBLOCK );
+  fcntl( c->pipe[1], F_SETFL, O_NONBLOCK );
+  uint64_t frameBytes = (uint64_t)width * height * bits / 8;
+  uint32_t packets = ( frameBytes + packetSize - 1 ) / packetSize;
+  c->memory.assign( frameBytes * numBuffers, 0 );
+  c->frames.resize( numBuffers );
+  for ( unsigned int i=0; i<numBuffers; i++ ) {
+    dc1394video_frame_t &frame = c->frames[i];
+    memset( &frame, 0, sizeof(frame) );
+    frame.image = &c->memory[0] + i * frameBytes;
+    frame.size[0] = width;
+    frame.size[1] = height;
+    frame.position[0] = c->mode == DC1394_VIDEO_MODE_FORMAT7_0 ? c->left : 0;
+    frame.position[1] = c->mode == DC1394_VIDEO_MODE_FORMAT7_0 ? c->top : 0;
+    frame.color_coding = coding;
+    frame.color_filter = m_config.filter;
+    frame.data_depth = coding == DC1394_COLOR_CODING_MONO16 ||
+      coding == DC1394_COLOR_CODING_RGB16 || coding == DC1394_COLOR_CODING_MONO16S ||
+      coding == DC1394_COLOR_CODING_RGB16S || coding == DC1394_COLOR_CODING_RAW16 ?
+      16 : 8;
+    frame.stride = width * bits / 8;
+    frame.video_mode = c->mode;
+    frame.total_bytes = frameBytes;
+    frame.image_bytes = frameBytes;
+    frame.packet_size = packetSize;
+    frame.packets_per_frame = packets;
+    frame.camera = camera;
+    frame.id = i;
+    frame.allocated_image_bytes = frameBytes;
+    frame.little_endian = DC1394_FALSE;
+    frame.data_in_padding = DC1394_FALSE;
+    c->free.push_back( i );
+  };
+  fill( c );
+  c->pattern = c->memory;
+  c->ready.clear();
+  c->triggers = 0;
+  c->produced = 0;
+  c->busReset = false;
+  c->bandwidth = bandwidth;
+  m_bandwidth += bandwidth;
+  if ( c->mode == DC1394_VIDEO_MODE_FORMAT7_0 )
+    c->period = packets * CYCLE;
+  else {
+    float fps;
+    dc1394_framerate_as_float( c->frameRate, &fps );
+    c->period = (uint64_t)( 1e6 / fps );
+  };
+  if ( c->transmission && !start( c ) ) {
+    captureStop( camera );
+    return DC1394_FAILURE;
+  };
+  return DC1394_SUCCESS;
+}
+
+dc1394error_t DC1394Simulator::captureStop( dc1394camera_t *camera )
+{
+  Camera *c = get( camera );
+  if ( c->frames.empty() ) return DC1394_FAILURE;
+  stop( c );
+  c->frames.clear();
+  vector< unsigned char >().swap( c->memory );
+  vector< unsigned char >().swap( c->pattern );
+  c->free.clear();
+  c->ready.clear();
+  closePipe( c->pipe );
+  m_bandwidth -= c->bandwidth;
+  c->bandwidth = 0;
+  return DC1394_SUCCESS;
+}
+
+int DC1394Simulator::captureGetFileno( dc1394camera_t *camera )
+{
+  return get( camera )->pipe[0];
+}
+
+dc1394error_t DC1394Simulator::captureDequeue( dc1394camera_t *camera,
+                                               dc1394capture_policy_t policy,
+                                               dc1394video_frame_t **frame )
+{
+  Camera *c = get( camera );
+  *frame = NULL;
+  if ( c->frames.empty() ) return DC1394_FAILURE;
+  while ( true ) {
+    pthread_mutex_lock( &c->mutex );
+    if ( c->busReset ) {
+      pthread_mutex_unlock( &c->mutex );
+      return DC1394_FAILURE;
+    };
+    if ( !c->ready.empty() ) {
+      unsigned int index = c->ready.front();
+      c->ready.pop_front();
+      // The pipe holds one byte for each frame ready.
+      char buffer;
+      if ( read( c->pipe[0], &buffer, 1 ) < 0 && errno != EAGAIN ) {
+        pthread_mutex_unlock( &c->mutex );
+        return DC1394_FAILURE;
+      };
+      c->frames[ index ].frames_behind = c->ready.size();
+      *frame = &c->frames[ index ];
+    };
+    pthread_mutex_unlock( &c->mutex );
+    if ( *frame != NULL || policy == DC1394_CAPTURE_POLICY_POLL ) break;
+    struct pollfd fds;
+    fds.fd = c->pipe[0];
+    fds.events = POLLIN;
+    if ( poll( &fds, 1, -1 ) < 0 && errno != EINTR ) return DC1394_FAILURE;
+  };
+  return DC1394_SUCCESS;
+}
+
+dc1394error_t DC1394Simulator::captureEnqueue( dc1394camera_t *camera,
+                                               dc1394video_frame_t *frame )
+{
+  Camera *c = get( camera );
+  if ( frame->camera != camera || frame->id >= c->frames.size() )
+    return DC1394_INVALID_ARGUMENT_VALUE;
+  pthread_mutex_lock( &c->mutex );
+  c->free.push_back( frame->id );
+  pthread_mutex_unlock( &c->mutex );
+  return DC1394_SUCCESS;
+}
+
+dc1394bool_t DC1394Simulator::captureIsFrameCorrupt( dc1394camera_t *camera,
+                                                     dc1394video_frame_t *frame )
+{
+  return DC1394_FALSE;
+}
+
+dc1394error_t DC1394Simulator::featureGet( dc1394camera_t *camera,
+                                           dc1394feature_info_t *feature )
+{
+  Camera *c = get( camera );
+  if ( feature->id < DC1394_FEATURE_MIN || feature->id > DC1394_FEATURE_MAX )
+    return DC1394_INVALID_ARGUMENT_VALUE;
+  pthread_mutex_lock( &c->mutex );
+  *feature = c->features.feature[ feature->id - DC1394_FEATURE_MIN ];
+  pthread_mutex_unlock( &c->mutex );
+  return DC1394_SUCCESS;
+}
+
+dc1394error_t DC1394Simulator::featureGetAll( dc1394camera_t *camera,
+                                              dc1394featureset_t *features )
+{
+  Camera *c = get( camera );
+  pthread_mutex_lock( &c->mutex );
+  *features = c->features;
+  pthread_mutex_unlock( &c->mutex );
+  return DC1394_SUCCESS;
+}
+
+dc1394error_t DC1394Simulator::featureGetValue( dc1394camera_t *camera,
+                                                dc1394feature_t feature,
+                                                uint32_t *value )
+{
+  dc1394feature_info_t info;
+  info.id = feature;
+  dc1394error_t err = featureGet( camera, &info );
+  if ( err != DC1394_SUCCESS ) return err;
+  if ( info.available == DC1394_FALSE ) return DC1394_FUNCTION_NOT_SUPPORTED;
+  *value = info.value;
+  return DC1394_SUCCESS;
+}
+
+dc1394error_t DC1394Simulator::featureSetValue( dc1394camera_t *camera,
+                                                dc1394feature_t feature,
+                                                uint32_t value )
+{
+  Camera *c = get( camera );
+  if ( feature < DC1394_FEATURE_MIN || feature > DC1394_FEATURE_MAX )
+    return DC1394_INVALID_ARGUMENT_VALUE;
+  dc1394error_t retVal = DC1394_SUCCESS;
+  pthread_mutex_lock( &c->mutex );
+  dc1394feature_info_t &info = c->features.feature[ feature - DC1394_FEATURE_MIN ];
+  if ( info.available == DC1394_FALSE || feature == DC1394_FEATURE_TRIGGER )
+    retVal = DC1394_FUNCTION_NOT_SUPPORTED;
+  else if ( value < info.min || value > info.max )
+    retVal = DC1394_INVALID_ARGUMENT_VALUE;
+  else
+    info.value = value;
+  pthread_mutex_unlock( &c->mutex );
+  return retVal;
+}
+
+dc1394error_t DC1394Simulator::featureIsPresent( dc1394camera_t *camera,
+                                                 dc1394feature_t feature,
+                                                 dc1394bool_t *value )
+{
+  dc1394feature_info_t info;
+  info.id = feature;
+  dc1394error_t err = featureGet( camera, &info );
+  if ( err != DC1394_SUCCESS ) return err;
+  *value = info.available;
+  return DC1394_SUCCESS;
+}
+
+dc1394error_t DC1394Simulator::featureIsReadable( dc1394camera_t *camera,
+                                                  dc1394feature_t feature,
+                                                  dc1394bool_t *value )
+{
+  dc1394feature_info_t info;
+  info.id = feature;
+  dc1394error_t err = featureGet( camera, &info );
+  if ( err != DC1394_SUCCESS ) return err;
+  *value = info.readout_capable;
+  return DC1394_SUCCESS;
+}
+
+dc1394error_t DC1394Simulator::featureIsSwitchable( dc1394camera_t *camera,
+                                                    dc1394feature_t feature,
+                                                    dc1394bool_t *value )
+{
+  dc1394feature_info_t info;
+  info.id = feature;
+  dc1394error_t err = featureGet( camera, &info );
+  if ( err != DC1394_SUCCESS ) return err;
+  *value = info.on_off_capable;
+  return DC1394_SUCCESS;
+}
+
+dc1394error_t DC1394Simulator::featureGetPower( dc1394camera_t *camera,
+                                                dc1394feature_t feature,
+                                                dc1394switch_t *value )
+{
+  dc1394feature_info_t info;
+  info.id = feature;
+  dc1394error_t err = featureGet( camera, &info );
+  if ( err != DC1394_SUCCESS ) return err;
+  if ( info.available == DC1394_FALSE ) return DC1394_FUNCTION_NOT_SUPPORTED;
+  *value = info.is_on;
+  return DC1394_SUCCESS;
+}
+
+dc1394error_t DC1394Simulator::featureSetPower( dc1394camera_t *camera,
+                                                dc1394feature_t feature,
+                                                dc1394switch_t value )
+{
+  Camera *c = get( camera );
+  if ( feature < DC1394_FEATURE_MIN || feature > DC1394_FEATURE_MAX )
+    return DC1394_INVALID_ARGUMENT_VALUE;
+  dc1394error_t retVal = DC1394_SUCCESS;
+  pthread_mutex_lock( &c->mutex );
+  dc1394feature_info_t &info = c->features.feature[ feature - DC1394_FEATURE_MIN ];
+  if ( info.available == DC1394_FALSE || info.on_off_capable == DC1394_FALSE )
+    retVal = DC1394_FUNCTION_NOT_SUPPORTED;
+  else {
+    info.is_on = value;
+    // Switching the trigger changes the behaviour of the capture thread.
+    if ( feature == DC1394_FEATURE_TRIGGER ) {
+      c->triggers = 0;
+      pthread_cond_signal( &c->cond );
+    };
+  };
+  pthread_mutex_unlock( &c->mutex );
+  return retVal;
+}
+
+dc1394error_t DC1394Simulator::featureGetModes( dc1394camera_t *camera,
+                                                dc1394feature_t feature,
+                                                dc1394feature_modes_t *modes )
+{
+  dc1394feature_info_t info;
+  info.id = feature;
+  dc1394error_t err = featureGet( camera, &info );
+  if ( err != DC1394_SUCCESS ) return err;
+  *modes = info.modes;
+  return DC1394_SUCCESS;
+}
+
+dc1394error_t DC1394Simulator::featureGetMode( dc1394camera_t *camera,
+                                               dc1394feature_t feature,
+                                               dc1394feature_mode_t *mode )
+{
+  dc1394feature_info_t info;
+  info.id = feature;
+  dc1394error_t err = featureGet( camera, &info );
+  if ( err != DC1394_SUCCESS ) return err;
+  if ( info.available == DC1394_FALSE ) return DC1394_FUNCTION_NOT_SUPPORTED;
+  *mode = info.current_mode;
+  return DC1394_SUCCESS;
+}
+
+dc1394error_t DC1394Simulator::featureSetMode( dc1394camera_t *camera,
+                                               dc1394feature_t feature,
+                                               dc1394feature_mode_t mode )
+{
+  Camera *c = get( camera );
+  if ( feature < DC1394_FEATURE_MIN || feature > DC1394_FEATURE_MAX )
+    return DC1394_INVALID_ARGUMENT_VALUE;
+  dc1394error_t retVal = DC1394_INVALID_ARGUMENT_VALUE;
+  pthread_mutex_lock( &c->mutex );
+  dc1394feature_info_t &info = c->features.feature[ feature - DC1394_FEATURE_MIN ];
+  for ( unsigned int i=0; i<info.modes.num; i++ )
+    if ( info.modes.modes[i] == mode ) {
+      // One-push adjustment completes immediately.
+      info.current_mode = mode == DC1394_FEATURE_MODE_ONE_PUSH_AUTO ?
+        DC1394_FEATURE_MODE_MANUAL : mode;
+      retVal = DC1394_SUCCESS;
+    };
+  pthread_mutex_unlock( &c->mutex );
+  return retVal;
+}
+
+dc1394error_t DC1394Simulator::externalTriggerSetMode( dc1394camera_t *camera,
+                                                       dc1394trigger_mode_t mode )
+{
+  Camera *c = get( camera );
+  dc1394error_t retVal = DC1394_INVALID_ARGUMENT_VALUE;
+  pthread_mutex_lock( &c->mutex );
+  dc1394feature_info_t &info =
+    c->features.feature[ DC1394_FEATURE_TRIGGER - DC1394_FEATURE_MIN ];
+  for ( unsigned int i=0; i<info.trigger_modes.num; i++ )
+    if ( info.trigger_modes.modes[i] == mode ) {
+      info.trigger_mode = mode;
+      retVal = DC1394_SUCCESS;
+    };
+  pthread_mutex_unlock( &c->mutex );
+  return retVal;
+}
+
+dc1394error_t DC1394Simulator::externalTriggerSetSource( dc1394camera_t *camera,
+                                                         dc1394trigger_source_t source )
+{
+  Camera *c = get( camera );
+  dc1394error_t retVal = DC1394_INVALID_ARGUMENT_VALUE;
+  pthread_mutex_lock( &c->mutex );
+  dc1394feature_info_t &info =
+    c->features.feature[ DC1394_FEATURE_TRIGGER - DC1394_FEATURE_MIN ];
+  for ( unsigned int i=0; i<info.trigger_sources.num; i++ )
+    if ( info.trigger_sources.sources[i] == source ) {
+      info.trigger_source = source;
+      retVal = DC1394_SUCCESS;
+    };
+  pthread_mutex_unlock( &c->mutex );
+  return retVal;
+}
+
+dc1394error_t DC1394Simulator::externalTriggerSetPolarity( dc1394camera_t *camera,
+                                                           dc1394trigger_polarity_t
+                                                           polarity )
+{
+  Camera *c = get( camera );
+  pthread_mutex_lock( &c->mutex );
+  c->features.feature[ DC1394_FEATURE_TRIGGER - DC1394_FEATURE_MIN ].trigger_polarity =
+    polarity;
+  pthread_mutex_unlock( &c->mutex );
+  return DC1394_SUCCESS;
+}
+
+dc1394error_t DC1394Simulator::externalTriggerSetPower( dc1394camera_t *camera,
+                                                        dc1394switch_t power )
+{
+  return featureSetPower( camera, DC1394_FEATURE_TRIGGER, power );
+}
+
+dc1394error_t DC1394Simulator::softwareTriggerSetPower( dc1394camera_t *camera,
+                                                        dc1394switch_t power )
+{
+  Camera *c = get( camera );
+  pthread_mutex_lock( &c->mutex );
+  const dc1394feature_info_t &info =
+    c->features.feature[ DC1394_FEATURE_TRIGGER - DC1394_FEATURE_MIN ];
+  // Other trigger sources would require a signal at the trigger input.
+  if ( power != DC1394_OFF && info.is_on != DC1394_OFF &&
+       info.trigger_source == DC1394_TRIGGER_SOURCE_SOFTWARE ) {
+    c->triggers++;
+    pthread_cond_signal( &c->cond );
+  };
+  pthread_mutex_unlock( &c->mutex );
+  return DC1394_SUCCESS;
+}
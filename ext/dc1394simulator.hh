@@ -0,0 +1,250 @@
+/* HornetsEye - Computer Vision with Ruby
+   Copyright (C) 2006, 2007, 2008, 2009, 2010 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef HORNETSEYE_DC1394SIMULATOR_HH
+#define HORNETSEYE_DC1394SIMULATOR_HH
+
+#include <deque>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include <dc1394/dc1394.h>
+#include "error.hh"
+#include "dc1394backend.hh"
+
+// Backend emulating firewire cameras so that the capture path can be used
+// without hardware. Each camera produces colour bars (or the corresponding
+// Bayer mosaic) at the selected frame rate in a thread of its own. Frames
+// are dropped when the DMA ring is full just like with a real camera.
+class DC1394Simulator: public DC1394Backend
+{
+public:
+  struct Config
+  {
+    unsigned int cameras;
+    // Fixed video modes. The frame rates are the same for all modes.
+    std::vector< dc1394video_mode_t > modes;
+    std::vector< dc1394framerate_t > frameRates;
+    // Maximum image size of format7 mode 0 (not available if zero).
+    unsigned int format7Width;
+    unsigned int format7Height;
+    std::vector< dc1394color_coding_t > format7Codings;
+    dc1394color_filter_t filter;
+    bool bmode;
+    // Probability of a frame getting lost on the bus.
+    double dropRate;
+    // Number of frames after which a bus reset stops the transmission (never if
+    // zero).
+    unsigned int resetAfter;
+  };
+  struct Camera
+  {
+    dc1394camera_t camera;
+    DC1394Simulator *simulator;
+    bool open;
+    dc1394video_mode_t mode;
+    dc1394framerate_t frameRate;
+    dc1394speed_t speed;
+    dc1394operation_mode_t operationMode;
+    bool transmission;
+    dc1394color_coding_t coding;
+    uint32_t packetSize;
+    uint32_t left;
+    uint32_t top;
+    uint32_t width;
+    uint32_t height;
+    dc1394featureset_t features;
+    // DMA ring. "free" buffers are filled by the thread, "ready" buffers wait
+    // for being dequeued.
+    std::vector< dc1394video_frame_t > frames;
+    std::vector< unsigned char > memory;
+    // Content of each buffer. It is copied like a DMA transfer when a frame
+    // is delivered because readers modify the buffers (e.g. byte swapping).
+    std::vector< unsigned char > pattern;
+    std::deque< unsigned int > free;
+    std::deque< unsigned int > ready;
+    uint32_t bandwidth;
+    uint64_t period;
+    unsigned int triggers;
+    unsigned int produced;
+    bool busReset;
+    unsigned int seed;
+    int pipe[2];
+    bool running;
+    bool quit;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+  };
+  DC1394Simulator( const Config &config ) throw (Error);
+  virtual ~DC1394Simulator(void);
+  static Config config( VALUE rbOptions ) throw (Error);
+  virtual bool simulated(void) const;
+  virtual dc1394error_t cameraEnumerate( dc1394camera_list_t **list );
+  virtual void cameraFreeList( dc1394camera_list_t *list );
+  virtual dc1394camera_t *cameraNewUnit( uint64_t guid, int unit );
+  virtual void cameraFree( dc1394camera_t *camera );
+  virtual dc1394error_t cameraSetPower( dc1394camera_t *camera,
+                                        dc1394switch_t power );
+  virtual dc1394error_t videoGetSupportedModes( dc1394camera_t *camera,
+                                                dc1394video_modes_t *modes );
+  virtual dc1394error_t videoGetSupportedFramerates( dc1394camera_t *camera,
+                                                     dc1394video_mode_t mode,
+                                                     dc1394framerates_t *rates );
+  virtual dc1394error_t videoSetMode( dc1394camera_t *camera,
+                                      dc1394video_mode_t mode );
+  virtual dc1394error_t videoGetMode( dc1394camera_t *camera,
+                                      dc1394video_mode_t *mode );
+  virtual dc1394error_t videoSetFramerate( dc1394camera_t *camera,
+                                           dc1394framerate_t rate );
+  virtual dc1394error_t videoGetFramerate( dc1394camera_t *camera,
+                                           dc1394framerate_t *rate );
+  virtual dc1394error_t videoSetIsoSpeed( dc1394camera_t *camera,
+                                          dc1394speed_t speed );
+  virtual dc1394error_t videoGetIsoSpeed( dc1394camera_t *camera,
+                                          dc1394speed_t *speed );
+  virtual dc1394error_t videoSetOperationMode( dc1394camera_t *camera,
+                                               dc1394operation_mode_t mode );
+  virtual dc1394error_t videoGetOperationMode( dc1394camera_t *camera,
+                                               dc1394operation_mode_t *mode );
+  virtual dc1394error_t videoSetTransmission( dc1394camera_t *camera,
+                                              dc1394switch_t power );
+  virtual dc1394error_t videoGetBandwidthUsage( dc1394camera_t *camera,
+                                                uint32_t *units );
+  virtual dc1394error_t getColorCodingFromVideoMode( dc1394camera_t *camera,
+                                                     dc1394video_mode_t mode,
+                                                     dc1394color_coding_t *coding );
+  virtual dc1394error_t getImageSizeFromVideoMode( dc1394camera_t *camera,
+                                                   dc1394video_mode_t mode,
+                                                   uint32_t *width,
+                                                   uint32_t *height );
+  virtual dc1394error_t format7GetMaxImageSize( dc1394camera_t *camera,
+                                                dc1394video_mode_t mode,
+                                                uint32_t *width,
+                                                uint32_t *height );
+  virtual dc1394error_t format7GetUnitSize( dc1394camera_t *camera,
+                                            dc1394video_mode_t mode,
+                                            uint32_t *width, uint32_t *height );
+  virtual dc1394error_t format7GetUnitPosition( dc1394camera_t *camera,
+                                                dc1394video_mode_t mode,
+                                                uint32_t *left, uint32_t *top );
+  virtual dc1394error_t format7GetPacketParameters( dc1394camera_t *camera,
+                                                    dc1394video_mode_t mode,
+                                                    uint32_t *unitBytes,
+                                                    uint32_t *maxBytes );
+  virtual dc1394error_t format7GetPacketSize( dc1394camera_t *camera,
+                                              dc1394video_mode_t mode,
+                                              uint32_t *packetSize );
+  virtual dc1394error_t format7SetPacketSize( dc1394camera_t *camera,
+                                              dc1394video_mode_t mode,
+                                              uint32_t packetSize );
+  virtual dc1394error_t format7GetTotalBytes( dc1394camera_t *camera,
+                                              dc1394video_mode_t mode,
+                                              uint64_t *totalBytes );
+  virtual dc1394error_t format7GetColorCodings( dc1394camera_t *camera,
+                                                dc1394video_mode_t mode,
+                                                dc1394color_codings_t *codings );
+  virtual dc1394error_t format7GetColorFilter( dc1394camera_t *camera,
+                                               dc1394video_mode_t mode,
+                                               dc1394color_filter_t *filter );
+  virtual dc1394error_t format7GetFrameInterval( dc1394camera_t *camera,
+                                                 dc1394video_mode_t mode,
+                                                 float *interval );
+  virtual dc1394error_t format7GetRoi( dc1394camera_t *camera,
+                                       dc1394video_mode_t mode,
+                                       dc1394color_coding_t *coding,
+                                       uint32_t *packetSize, uint32_t *left,
+                                       uint32_t *top, uint32_t *width,
+                                       uint32_t *height );
+  virtual dc1394error_t format7SetRoi( dc1394camera_t *camera,
+                                       dc1394video_mode_t mode,
+                                       dc1394color_coding_t coding,
+                                       int32_t packetSize, int32_t left, int32_t top,
+                                       int32_t width, int32_t height );
+  virtual dc1394error_t captureSetup( dc1394camera_t *camera, uint32_t numBuffers,
+                                      uint32_t flags );
+  virtual dc1394error_t captureStop( dc1394camera_t *camera );
+  virtual int captureGetFileno( dc1394camera_t *camera );
+  virtual dc1394error_t captureDequeue( dc1394camera_t *camera,
+                                        dc1394capture_policy_t policy,
+                                        dc1394video_frame_t **frame );
+  virtual dc1394error_t captureEnqueue( dc1394camera_t *camera,
+                                        dc1394video_frame_t *frame );
+  virtual dc1394bool_t captureIsFrameCorrupt( dc1394camera_t *camera,
+                                              dc1394video_frame_t *frame );
+  virtual dc1394error_t featureGet( dc1394camera_t *camera,
+                                    dc1394feature_info_t *feature );
+  virtual dc1394error_t featureGetAll( dc1394camera_t *camera,
+                                       dc1394featureset_t *features );
+  virtual dc1394error_t featureGetValue( dc1394camera_t *camera,
+                                         dc1394feature_t feature,
+                                         uint32_t *value );
+  virtual dc1394error_t featureSetValue( dc1394camera_t *camera,
+                                         dc1394feature_t feature,
+                                         uint32_t value );
+  virtual dc1394error_t featureIsPresent( dc1394camera_t *camera,
+                                          dc1394feature_t feature,
+                                          dc1394bool_t *value );
+  virtual dc1394error_t featureIsReadable( dc1394camera_t *camera,
+                                           dc1394feature_t feature,
+                                           dc1394bool_t *value );
+  virtual dc1394error_t featureIsSwitchable( dc1394camera_t *camera,
+                                             dc1394feature_t feature,
+                                             dc1394bool_t *value );
+  virtual dc1394error_t featureGetPower( dc1394camera_t *camera,
+                                         dc1394feature_t feature,
+                                         dc1394switch_t *value );
+  virtual dc1394error_t featureSetPower( dc1394camera_t *camera,
+                                         dc1394feature_t feature,
+                                         dc1394switch_t value );
+  virtual dc1394error_t featureGetModes( dc1394camera_t *camera,
+                                         dc1394feature_t feature,
+                                         dc1394feature_modes_t *modes );
+  virtual dc1394error_t featureGetMode( dc1394camera_t *camera,
+                                        dc1394feature_t feature,
+                                        dc1394feature_mode_t *mode );
+  virtual dc1394error_t featureSetMode( dc1394camera_t *camera,
+                                        dc1394feature_t feature,
+                                        dc1394feature_mode_t mode );
+  virtual dc1394error_t externalTriggerSetMode( dc1394camera_t *camera,
+                                                dc1394trigger_mode_t mode );
+  virtual dc1394error_t externalTriggerSetSource( dc1394camera_t *camera,
+                                                  dc1394trigger_source_t source );
+  virtual dc1394error_t externalTriggerSetPolarity( dc1394camera_t *camera,
+                                                    dc1394trigger_polarity_t
+                                                    polarity );
+  virtual dc1394error_t externalTriggerSetPower( dc1394camera_t *camera,
+                                                 dc1394switch_t power );
+  virtual dc1394error_t softwareTriggerSetPower( dc1394camera_t *camera,
+                                                 dc1394switch_t power );
+protected:
+  Camera *get( dc1394camera_t *camera ) const;
+  dc1394error_t geometry( Camera *camera, dc1394color_coding_t *coding,
+                          uint32_t *width, uint32_t *height, uint32_t *packetSize );
+  void defaults( Camera *camera );
+  void fill( Camera *camera );
+  bool start( Camera *camera );
+  void stop( Camera *camera );
+  void produce( Camera *camera );
+  void deliver( Camera *camera );
+  static uint32_t maxBytes( dc1394speed_t speed );
+  static void *produceThread( void *ptr );
+  Config m_config;
+  std::vector< Camera * > m_cameras;
+  // Bandwidth units allocated by cameras capturing at the moment.
+  uint32_t m_bandwidth;
+};
+
+#endif
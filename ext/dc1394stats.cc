@@ -0,0 +1,134 @@
+/* HornetsEye - Computer Vision with Ruby
+ Copyright (C) 2006, 2007, 2008, 2009, 2010 Jan Wedekind
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include <time.h>
+#include "dc1394stats.hh"
+
+using namespace boost;
+
+DC1394Histogram::DC1394Histogram(void):
+  m_count( 0 ), m_sum( 0 ), m_max( 0 )
+{
+  for ( int i=0; i<NUM_BUCKETS; i++ )
+    m_buckets[i] = 0;
+}
+
+void DC1394Histogram::add( uint64_t usecs )
+{
+  int bucket = 0;
+  while ( bucket < NUM_BUCKETS - 1 && ( usecs >> bucket ) > 0 ) bucket++;
+  m_buckets[ bucket ].fetch_add( 1, memory_order_relaxed );
+  m_count.fetch_add( 1, memory_order_relaxed );
+  m_sum.fetch_add( usecs, memory_order_relaxed );
+  uint64_t max = m_max.load( memory_order_relaxed );
+  while ( usecs > max &&
+          !m_max.compare_exchange_weak( max, usecs, memory_order_relaxed ) );
+}
+
+void DC1394Histogram::reset(void)
+{
+  for ( int i=0; i<NUM_BUCKETS; i++ )
+    m_buckets[i] = 0;
+  m_count = 0;
+  m_sum = 0;
+  m_max = 0;
+}
+
+VALUE DC1394Histogram::toRuby(void) const
+{
+  VALUE rbRetVal = rb_hash_new();
+  uint64_t count = m_count;
+  rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "count" ) ), ULL2NUM( count ) );
+  rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "mean" ) ),
+                rb_float_new( count > 0 ? (double)m_sum / count : 0.0 ) );
+  rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "max" ) ), ULL2NUM( m_max ) );
+  VALUE rbBuckets = rb_ary_new();
+  for ( int i=0; i<NUM_BUCKETS; i++ )
+    rb_ary_push( rbBuckets, ULL2NUM( m_buckets[i] ) );
+  rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "buckets" ) ), rbBuckets );
+  return rbRetVal;
+}
+
+DC1394Stats::DC1394Stats(void):
+  m_framePeriod( 0 ), m_lastTimestamp( 0 ), m_read( 0 ), m_copied( 0 ),
+  m_skipped( 0 ), m_dropped( 0 ), m_corrupt( 0 ),
+  m_exposureErrors( 0 )
+{
+}
+
+uint64_t DC1394Stats::now(void)
+{
+  struct timespec t;
+  clock_gettime( CLOCK_MONOTONIC, &t );
+  return (uint64_t)t.tv_sec * 1000000 + t.tv_nsec / 1000;
+}
+
+void DC1394Stats::captured( uint64_t timestamp )
+{
+  uint64_t last = m_lastTimestamp.exchange( timestamp, memory_order_relaxed );
+  if ( last != 0 && timestamp > last ) {
+    uint64_t interval = timestamp - last;
+    m_interval.add( interval );
+    // Estimate the number of frames lost between two consecutive frames.
+    uint64_t period = m_framePeriod;
+    if ( period > 0 && 2 * interval > 3 * period )
+      m_dropped.fetch_add( ( interval + period / 2 ) / period - 1,
+                           memory_order_relaxed );
+  };
+}
+
+void DC1394Stats::delivered( bool copied, bool corrupt, uint64_t usecs )
+{
+  m_read.fetch_add( 1, memory_order_relaxed );
+  if ( copied ) m_copied.fetch_add( 1, memory_order_relaxed );
+  if ( corrupt ) m_corrupt.fetch_add( 1, memory_order_relaxed );
+  m_conversion.add( usecs );
+}
+
+void DC1394Stats::reset(void)
+{
+  m_lastTimestamp = 0;
+  m_read = 0;
+  m_copied = 0;
+  m_skipped = 0;
+  m_dropped = 0;
+  m_corrupt = 0;
+  m_exposureErrors = 0;
+  m_wait.reset();
+  m_interval.reset();
+  m_conversion.reset();
+}
+
+VALUE DC1394Stats::toRuby(void) const
+{
+  VALUE rbRetVal = rb_hash_new();
+  rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "frames_read" ) ), ULL2NUM( m_read ) );
+  rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "frames_copied" ) ),
+                ULL2NUM( m_copied ) );
+  rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "frames_skipped" ) ),
+                ULL2NUM( m_skipped ) );
+  rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "frames_dropped" ) ),
+                ULL2NUM( m_dropped ) );
+  rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "frames_corrupt" ) ),
+                ULL2NUM( m_corrupt ) );
+  rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "exposure_errors" ) ),
+                ULL2NUM( m_exposureErrors ) );
+  rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "wait" ) ), m_wait.toRuby() );
+  rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "interval" ) ), m_interval.toRuby() );
+  rb_hash_aset( rbRetVal, ID2SYM( rb_intern( "conversion" ) ),
+                m_conversion.toRuby() );
+  return rbRetVal;
+}
+
@@ -0,0 +1,72 @@
+/* HornetsEye - Computer Vision with Ruby
+   Copyright (C) 2006, 2007, 2008, 2009, 2010 Jan Wedekind
+   
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef HORNETSEYE_DC1394STATS_HH
+#define HORNETSEYE_DC1394STATS_HH
+
+#include <stdint.h>
+#include <boost/atomic.hpp>
+#include "rubyinc.hh"
+
+// Histogram with buckets of exponentially growing size. Bucket i counts
+// durations below 2^i microseconds which did not fit into bucket i - 1.
+class DC1394Histogram
+{
+public:
+  static const int NUM_BUCKETS = 24;
+  DC1394Histogram(void);
+  void add( uint64_t usecs );
+  void reset(void);
+  VALUE toRuby(void) const;
+protected:
+  boost::atomic< uint64_t > m_buckets[ NUM_BUCKETS ];
+  boost::atomic< uint64_t > m_count;
+  boost::atomic< uint64_t > m_sum;
+  boost::atomic< uint64_t > m_max;
+};
+
+// Capture counters which can be updated from the capture thread and read from
+// Ruby at the same time.
+class DC1394Stats
+{
+public:
+  DC1394Stats(void);
+  static uint64_t now(void);
+  void setFramePeriod( uint64_t usecs ) { m_framePeriod = usecs; }
+  uint64_t framePeriod(void) const { return m_framePeriod; }
+  void captured( uint64_t timestamp );
+  void waited( uint64_t usecs ) { m_wait.add( usecs ); }
+  void skipped(void) { m_skipped.fetch_add( 1, boost::memory_order_relaxed ); }
+  void delivered( bool copied, bool corrupt, uint64_t usecs );
+  void exposureFailed(void)
+    { m_exposureErrors.fetch_add( 1, boost::memory_order_relaxed ); }
+  void reset(void);
+  VALUE toRuby(void) const;
+protected:
+  boost::atomic< uint64_t > m_framePeriod;
+  boost::atomic< uint64_t > m_lastTimestamp;
+  boost::atomic< uint64_t > m_read;
+  boost::atomic< uint64_t > m_copied;
+  boost::atomic< uint64_t > m_skipped;
+  boost::atomic< uint64_t > m_dropped;
+  boost::atomic< uint64_t > m_corrupt;
+  boost::atomic< uint64_t > m_exposureErrors;
+  DC1394Histogram m_wait;
+  DC1394Histogram m_interval;
+  DC1394Histogram m_conversion;
+};
+
+#endif
+
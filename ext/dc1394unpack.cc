@@ -0,0 +1,462 @@
+/* HornetsEye - Computer Vision with Ruby
+   Copyright (C) 2006, 2007, 2008, 2009, 2010 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "dc1394unpack.hh"
+#ifdef DC1394_X86
+#include <immintrin.h>
+// The kernels are compiled for SSSE3 and AVX2 independent of the compiler
+// flags. They are selected at runtime if the processor supports them.
+#define TARGET_SSSE3 __attribute__((target("ssse3")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+// YUV to RGB conversion (ITU-R BT.601) with coefficients scaled by 64 so that
+// the SIMD version can use 16 bit arithmetic.
+static inline uint8_t clip( int value )
+{
+  return value < 0 ? 0 : ( value > 255 ? 255 : value );
+}
+
+static inline void yuvToRGB( int y, int u, int v, uint8_t *rgb )
+{
+  int c = 74 * ( y - 16 ) + 32, d = u - 128, e = v - 128;
+  rgb[0] = clip( ( c + 102 * e ) >> 6 );
+  rgb[1] = clip( ( c - 25 * d - 52 * e ) >> 6 );
+  rgb[2] = clip( ( c + 129 * d ) >> 6 );
+}
+
+// Luma of RGB values (ITU-R BT.601) with coefficients scaled by 256.
+static inline uint8_t rgbToY( int r, int g, int b )
+{
+  return ( 77 * r + 150 * g + 29 * b + 128 ) >> 8;
+}
+
+#ifdef DC1394_X86
+
+// Gather the three channels of eight packed 24 bit pixels into 16 bit lanes.
+// The pixels are read from two overlapping loads at offset 0 and 8. Indices of
+// -1 clear the upper half of each 16 bit lane.
+static inline TARGET_SSSE3 void gather3( const uint8_t *p, __m128i &c0, __m128i &c1,
+                                          __m128i &c2 )
+{
+  const __m128i m00 = _mm_setr_epi8( 0, -1, 3, -1, 6, -1, 9, -1,
+                                     12, -1, -1, -1, -1, -1, -1, -1 ),
+    m01 = _mm_setr_epi8( -1, -1, -1, -1, -1, -1, -1, -1,
+                         -1, -1, 7, -1, 10, -1, 13, -1 ),
+    m10 = _mm_setr_epi8( 1, -1, 4, -1, 7, -1, 10, -1,
+                         13, -1, -1, -1, -1, -1, -1, -1 ),
+    m11 = _mm_setr_epi8( -1, -1, -1, -1, -1, -1, -1, -1,
+                         -1, -1, 8, -1, 11, -1, 14, -1 ),
+    m20 = _mm_setr_epi8( 2, -1, 5, -1, 8, -1, 11, -1,
+                         14, -1, -1, -1, -1, -1, -1, -1 ),
+    m21 = _mm_setr_epi8( -1, -1, -1, -1, -1, -1, -1, -1,
+                         -1, -1, 9, -1, 12, -1, 15, -1 );
+  __m128i a = _mm_loadu_si128( (const __m128i *)p ),
+    b = _mm_loadu_si128( (const __m128i *)( p + 8 ) );
+  c0 = _mm_or_si128( _mm_shuffle_epi8( a, m00 ), _mm_shuffle_epi8( b, m01 ) );
+  c1 = _mm_or_si128( _mm_shuffle_epi8( a, m10 ), _mm_shuffle_epi8( b, m11 ) );
+  c2 = _mm_or_si128( _mm_shuffle_epi8( a, m20 ), _mm_shuffle_epi8( b, m21 ) );
+}
+
+// Saturate eight 16 bit values per channel and store them as 24 bit pixels.
+static inline TARGET_SSSE3 void scatter3( __m128i c0, __m128i c1, __m128i c2,
+                                           uint8_t *q )
+{
+  // The first two channels are packed into one register and the third into
+  // another. The masks interleave them.
+  const __m128i m010 = _mm_setr_epi8( 0, 8, -1, 1, 9, -1, 2, 10,
+                                      -1, 3, 11, -1, 4, 12, -1, 5 ),
+    m20 = _mm_setr_epi8( -1, -1, 0, -1, -1, 1, -1, -1,
+                         2, -1, -1, 3, -1, -1, 4, -1 ),
+    m011 = _mm_setr_epi8( 13, -1, 6, 14, -1, 7, 15, -1,
+                          -1, -1, -1, -1, -1, -1, -1, -1 ),
+    m21 = _mm_setr_epi8( -1, 5, -1, -1, 6, -1, -1, 7,
+                         -1, -1, -1, -1, -1, -1, -1, -1 );
+  __m128i c01 = _mm_packus_epi16( c0, c1 ), c22 = _mm_packus_epi16( c2, c2 );
+  _mm_storeu_si128( (__m128i *)q, _mm_or_si128( _mm_shuffle_epi8( c01, m010 ),
+                                                _mm_shuffle_epi8( c22, m20 ) ) );
+  _mm_storel_epi64( (__m128i *)( q + 16 ),
+                    _mm_or_si128( _mm_shuffle_epi8( c01, m011 ),
+                                  _mm_shuffle_epi8( c22, m21 ) ) );
+}
+
+// Convert eight pixels with YUV values in 16 bit lanes to RGB.
+static inline TARGET_SSSE3 void yuvToRGB( __m128i y, __m128i u, __m128i v,
+                                           uint8_t *q )
+{
+  __m128i c = _mm_add_epi16( _mm_mullo_epi16( _mm_sub_epi16( y, _mm_set1_epi16( 16 ) ),
+                                              _mm_set1_epi16( 74 ) ),
+                             _mm_set1_epi16( 32 ) ),
+    d = _mm_sub_epi16( u, _mm_set1_epi16( 128 ) ),
+    e = _mm_sub_epi16( v, _mm_set1_epi16( 128 ) );
+  // Saturation only affects values which are clipped anyway.
+  __m128i r = _mm_adds_epi16( c, _mm_mullo_epi16( e, _mm_set1_epi16( 102 ) ) ),
+    g = _mm_subs_epi16( _mm_subs_epi16( c, _mm_mullo_epi16( d, _mm_set1_epi16( 25 ) ) ),
+                        _mm_mullo_epi16( e, _mm_set1_epi16( 52 ) ) ),
+    b = _mm_adds_epi16( c, _mm_mullo_epi16( d, _mm_set1_epi16( 129 ) ) );
+  scatter3( _mm_srai_epi16( r, 6 ), _mm_srai_epi16( g, 6 ), _mm_srai_epi16( b, 6 ), q );
+}
+
+#endif
+
+#ifdef DC1394_X86
+
+static TARGET_SSSE3 int yuv411ToUYVYSSSE3( const uint8_t *src, uint8_t *dst,
+                                           int size )
+{
+  int i = 0;
+  const __m128i shuffle = _mm_setr_epi8( 0, 1, 3, 2, 0, 4, 3, 5,
+                                         6, 7, 9, 8, 6, 10, 9, 11 );
+  // Each iteration reads 16 bytes of which 12 are used.
+  for ( ; ( i + 8 ) * 3 / 2 + 4 <= size * 3 / 2; i += 8 ) {
+    __m128i v = _mm_loadu_si128( (const __m128i *)( src + i * 3 / 2 ) );
+    _mm_storeu_si128( (__m128i *)( dst + i * 2 ), _mm_shuffle_epi8( v, shuffle ) );
+  };
+  return i;
+}
+
+#endif
+
+void DC1394Unpack::yuv411ToUYVY( const uint8_t *src, uint8_t *dst, int size )
+{
+  // Four pixels U Y0 Y1 V Y2 Y3 become U Y0 V Y1 U Y2 V Y3.
+  int i = 0;
+#ifdef DC1394_X86
+  if ( ssse3() ) i = yuv411ToUYVYSSSE3( src, dst, size );
+#endif
+  for ( ; i + 4 <= size; i += 4 ) {
+    const uint8_t *p = src + i * 3 / 2;
+    uint8_t *q = dst + i * 2;
+    q[0] = p[0]; q[1] = p[1]; q[2] = p[3]; q[3] = p[2];
+    q[4] = p[0]; q[5] = p[4]; q[6] = p[3]; q[7] = p[5];
+  };
+}
+
+#ifdef DC1394_X86
+
+static TARGET_SSSE3 int yuv411ToRGBSSSE3( const uint8_t *src, uint8_t *dst,
+                                          int size )
+{
+  int i = 0;
+  const __m128i ys = _mm_setr_epi8( 1, -1, 2, -1, 4, -1, 5, -1,
+                                    7, -1, 8, -1, 10, -1, 11, -1 ),
+    us = _mm_setr_epi8( 0, -1, 0, -1, 0, -1, 0, -1, 6, -1, 6, -1, 6, -1, 6, -1 ),
+    vs = _mm_setr_epi8( 3, -1, 3, -1, 3, -1, 3, -1, 9, -1, 9, -1, 9, -1, 9, -1 );
+  for ( ; ( i + 8 ) * 3 / 2 + 4 <= size * 3 / 2; i += 8 ) {
+    __m128i v = _mm_loadu_si128( (const __m128i *)( src + i * 3 / 2 ) );
+    yuvToRGB( _mm_shuffle_epi8( v, ys ), _mm_shuffle_epi8( v, us ),
+              _mm_shuffle_epi8( v, vs ), dst + i * 3 );
+  };
+  return i;
+}
+
+#endif
+
+void DC1394Unpack::yuv411ToRGB( const uint8_t *src, uint8_t *dst, int size )
+{
+  int i = 0;
+#ifdef DC1394_X86
+  if ( ssse3() ) i = yuv411ToRGBSSSE3( src, dst, size );
+#endif
+  for ( ; i + 4 <= size; i += 4 ) {
+    const uint8_t *p = src + i * 3 / 2;
+    uint8_t *q = dst + i * 3;
+    yuvToRGB( p[1], p[0], p[3], q );
+    yuvToRGB( p[2], p[0], p[3], q + 3 );
+    yuvToRGB( p[4], p[0], p[3], q + 6 );
+    yuvToRGB( p[5], p[0], p[3], q + 9 );
+  };
+}
+
+#ifdef DC1394_X86
+
+static TARGET_SSSE3 int yuv411ToGreySSSE3( const uint8_t *src, uint8_t *dst,
+                                           int size )
+{
+  int i = 0;
+  const __m128i ys = _mm_setr_epi8( 1, 2, 4, 5, 7, 8, 10, 11,
+                                    -1, -1, -1, -1, -1, -1, -1, -1 );
+  for ( ; ( i + 8 ) * 3 / 2 + 4 <= size * 3 / 2; i += 8 ) {
+    __m128i v = _mm_loadu_si128( (const __m128i *)( src + i * 3 / 2 ) );
+    _mm_storel_epi64( (__m128i *)( dst + i ), _mm_shuffle_epi8( v, ys ) );
+  };
+  return i;
+}
+
+#endif
+
+void DC1394Unpack::yuv411ToGrey( const uint8_t *src, uint8_t *dst, int size )
+{
+  int i = 0;
+#ifdef DC1394_X86
+  if ( ssse3() ) i = yuv411ToGreySSSE3( src, dst, size );
+#endif
+  for ( ; i + 4 <= size; i += 4 ) {
+    const uint8_t *p = src + i * 3 / 2;
+    dst[ i ] = p[1]; dst[ i + 1 ] = p[2]; dst[ i + 2 ] = p[4]; dst[ i + 3 ] = p[5];
+  };
+}
+
+#ifdef DC1394_X86
+
+static TARGET_SSSE3 int uyvyToRGBSSSE3( const uint8_t *src, uint8_t *dst,
+                                        int size )
+{
+  int i = 0;
+  const __m128i us = _mm_setr_epi8( 0, -1, 0, -1, 4, -1, 4, -1,
+                                    8, -1, 8, -1, 12, -1, 12, -1 ),
+    vs = _mm_setr_epi8( 2, -1, 2, -1, 6, -1, 6, -1, 10, -1, 10, -1, 14, -1, 14, -1 );
+  for ( ; i + 8 <= size; i += 8 ) {
+    __m128i v = _mm_loadu_si128( (const __m128i *)( src + i * 2 ) );
+    yuvToRGB( _mm_srli_epi16( v, 8 ), _mm_shuffle_epi8( v, us ),
+              _mm_shuffle_epi8( v, vs ), dst + i * 3 );
+  };
+  return i;
+}
+
+#endif
+
+void DC1394Unpack::uyvyToRGB( const uint8_t *src, uint8_t *dst, int size )
+{
+  int i = 0;
+#ifdef DC1394_X86
+  if ( ssse3() ) i = uyvyToRGBSSSE3( src, dst, size );
+#endif
+  for ( ; i + 2 <= size; i += 2 ) {
+    const uint8_t *p = src + i * 2;
+    yuvToRGB( p[1], p[0], p[2], dst + i * 3 );
+    yuvToRGB( p[3], p[0], p[2], dst + i * 3 + 3 );
+  };
+}
+
+void DC1394Unpack::uyvyToGrey( const uint8_t *src, uint8_t *dst, int size )
+{
+  int i = 0;
+#if defined(DC1394_X86) && defined(__SSE2__)
+  for ( ; i + 16 <= size; i += 16 ) {
+    __m128i a = _mm_loadu_si128( (const __m128i *)( src + i * 2 ) ),
+      b = _mm_loadu_si128( (const __m128i *)( src + i * 2 + 16 ) );
+    _mm_storeu_si128( (__m128i *)( dst + i ),
+                      _mm_packus_epi16( _mm_srli_epi16( a, 8 ), _mm_srli_epi16( b, 8 ) ) );
+  };
+#endif
+  for ( ; i < size; i++ )
+    dst[ i ] = src[ i * 2 + 1 ];
+}
+
+#ifdef DC1394_X86
+
+static TARGET_SSSE3 int yuv444ToRGBSSSE3( const uint8_t *src, uint8_t *dst,
+                                          int size )
+{
+  int i = 0;
+  for ( ; i + 8 <= size; i += 8 ) {
+    __m128i u, y, v;
+    gather3( src + i * 3, u, y, v );
+    yuvToRGB( y, u, v, dst + i * 3 );
+  };
+  return i;
+}
+
+#endif
+
+void DC1394Unpack::yuv444ToRGB( const uint8_t *src, uint8_t *dst, int size )
+{
+  int i = 0;
+#ifdef DC1394_X86
+  if ( ssse3() ) i = yuv444ToRGBSSSE3( src, dst, size );
+#endif
+  for ( ; i < size; i++ )
+    yuvToRGB( src[ 3 * i + 1 ], src[ 3 * i ], src[ 3 * i + 2 ], dst + 3 * i );
+}
+
+#ifdef DC1394_X86
+
+static TARGET_SSSE3 int yuv444ToGreySSSE3( const uint8_t *src, uint8_t *dst,
+                                           int size )
+{
+  int i = 0;
+  const __m128i y0 = _mm_setr_epi8( 1, 4, 7, 10, 13, -1, -1, -1,
+                                    -1, -1, -1, -1, -1, -1, -1, -1 ),
+    y1 = _mm_setr_epi8( -1, -1, -1, -1, -1, 8, 11, 14,
+                        -1, -1, -1, -1, -1, -1, -1, -1 );
+  for ( ; i + 8 <= size; i += 8 ) {
+    const uint8_t *p = src + i * 3;
+    __m128i a = _mm_loadu_si128( (const __m128i *)p ),
+      b = _mm_loadu_si128( (const __m128i *)( p + 8 ) );
+    _mm_storel_epi64( (__m128i *)( dst + i ),
+                      _mm_or_si128( _mm_shuffle_epi8( a, y0 ), _mm_shuffle_epi8( b, y1 ) ) );
+  };
+  return i;
+}
+
+#endif
+
+void DC1394Unpack::yuv444ToGrey( const uint8_t *src, uint8_t *dst, int size )
+{
+  int i = 0;
+#ifdef DC1394_X86
+  if ( ssse3() ) i = yuv444ToGreySSSE3( src, dst, size );
+#endif
+  for ( ; i < size; i++ )
+    dst[ i ] = src[ 3 * i + 1 ];
+}
+
+#ifdef DC1394_X86
+
+static TARGET_SSSE3 int rgbToGreySSSE3( const uint8_t *src, uint8_t *dst,
+                                        int size )
+{
+  int i = 0;
+  for ( ; i + 8 <= size; i += 8 ) {
+    __m128i r, g, b;
+    gather3( src + i * 3, r, g, b );
+    // The sum is below 65536 so that wrap-around of the signed products does
+    // not matter.
+    __m128i y = _mm_add_epi16( _mm_add_epi16( _mm_mullo_epi16( r, _mm_set1_epi16( 77 ) ),
+                                              _mm_mullo_epi16( g, _mm_set1_epi16( 150 ) ) ),
+                               _mm_add_epi16( _mm_mullo_epi16( b, _mm_set1_epi16( 29 ) ),
+                                              _mm_set1_epi16( 128 ) ) );
+    y = _mm_srli_epi16( y, 8 );
+    _mm_storel_epi64( (__m128i *)( dst + i ), _mm_packus_epi16( y, y ) );
+  };
+  return i;
+}
+
+#endif
+
+void DC1394Unpack::rgbToGrey( const uint8_t *src, uint8_t *dst, int size )
+{
+  int i = 0;
+#ifdef DC1394_X86
+  if ( ssse3() ) i = rgbToGreySSSE3( src, dst, size );
+#endif
+  for ( ; i < size; i++ )
+    dst[ i ] = rgbToY( src[ 3 * i ], src[ 3 * i + 1 ], src[ 3 * i + 2 ] );
+}
+
+#ifdef DC1394_X86
+
+static TARGET_SSSE3 int greyToRGBSSSE3( const uint8_t *src, uint8_t *dst,
+                                        int size )
+{
+  int i = 0;
+  const __m128i m0 = _mm_setr_epi8( 0, 0, 0, 1, 1, 1, 2, 2, 2, 3, 3, 3, 4, 4, 4, 5 ),
+    m1 = _mm_setr_epi8( 5, 5, 6, 6, 6, 7, 7, 7, 8, 8, 8, 9, 9, 9, 10, 10 ),
+    m2 = _mm_setr_epi8( 10, 11, 11, 11, 12, 12, 12, 13, 13, 13, 14, 14, 14, 15, 15, 15 );
+  for ( ; i + 16 <= size; i += 16 ) {
+    __m128i v = _mm_loadu_si128( (const __m128i *)( src + i ) );
+    __m128i *q = (__m128i *)( dst + i * 3 );
+    _mm_storeu_si128( q, _mm_shuffle_epi8( v, m0 ) );
+    _mm_storeu_si128( q + 1, _mm_shuffle_epi8( v, m1 ) );
+    _mm_storeu_si128( q + 2, _mm_shuffle_epi8( v, m2 ) );
+  };
+  return i;
+}
+
+#endif
+
+void DC1394Unpack::greyToRGB( const uint8_t *src, uint8_t *dst, int size )
+{
+  int i = 0;
+#ifdef DC1394_X86
+  if ( ssse3() ) i = greyToRGBSSSE3( src, dst, size );
+#endif
+  for ( ; i < size; i++ )
+    dst[ 3 * i ] = dst[ 3 * i + 1 ] = dst[ 3 * i + 2 ] = src[ i ];
+}
+
+void DC1394Unpack::shortToGrey( const uint16_t *src, uint8_t *dst, int size,
+                                int shift )
+{
+  int i = 0;
+#if defined(DC1394_X86) && defined(__SSE2__)
+  // Values are shifted below 256 so that signed saturation does not occur.
+  const __m128i count = _mm_cvtsi32_si128( shift );
+  for ( ; i + 16 <= size; i += 16 ) {
+    __m128i a = _mm_loadu_si128( (const __m128i *)( src + i ) ),
+      b = _mm_loadu_si128( (const __m128i *)( src + i + 8 ) );
+    _mm_storeu_si128( (__m128i *)( dst + i ),
+                      _mm_packus_epi16( _mm_srl_epi16( a, count ),
+                                        _mm_srl_epi16( b, count ) ) );
+  };
+#endif
+  for ( ; i < size; i++ ) {
+    int value = src[ i ] >> shift;
+    dst[ i ] = value > 255 ? 255 : value;
+  };
+}
+
+#ifdef DC1394_X86
+
+static TARGET_AVX2 int swapBytesAVX2( uint16_t *data, int size )
+{
+  int i = 0;
+  const __m256i shuffle = _mm256_setr_epi8( 1, 0, 3, 2, 5, 4, 7, 6,
+                                            9, 8, 11, 10, 13, 12, 15, 14,
+                                            1, 0, 3, 2, 5, 4, 7, 6,
+                                            9, 8, 11, 10, 13, 12, 15, 14 );
+  for ( ; i + 16 <= size; i += 16 ) {
+    __m256i v = _mm256_loadu_si256( (const __m256i *)( data + i ) );
+    _mm256_storeu_si256( (__m256i *)( data + i ), _mm256_shuffle_epi8( v, shuffle ) );
+  };
+  return i;
+}
+
+#endif
+
+void DC1394Unpack::swapBytes( uint16_t *data, int size )
+{
+  int i = 0;
+#ifdef DC1394_X86
+  if ( avx2() ) i = swapBytesAVX2( data, size );
+#endif
+#if defined(DC1394_X86) && defined(__SSE2__)
+  for ( ; i + 8 <= size; i += 8 ) {
+    __m128i v = _mm_loadu_si128( (const __m128i *)( data + i ) );
+    _mm_storeu_si128( (__m128i *)( data + i ),
+                      _mm_or_si128( _mm_slli_epi16( v, 8 ), _mm_srli_epi16( v, 8 ) ) );
+  };
+#endif
+  for ( ; i < size; i++ )
+    data[ i ] = (uint16_t)( ( data[ i ] >> 8 ) | ( data[ i ] << 8 ) );
+}
+
+bool DC1394Unpack::ssse3(void)
+{
+#ifdef DC1394_X86
+  static const bool retVal = __builtin_cpu_supports( "ssse3" );
+  return retVal;
+#else
+  return false;
+#endif
+}
+
+bool DC1394Unpack::avx2(void)
+{
+#ifdef DC1394_X86
+  static const bool retVal = __builtin_cpu_supports( "avx2" );
+  return retVal;
+#else
+  return false;
+#endif
+}
+
+bool DC1394Unpack::littleEndian(void)
+{
+  static const uint16_t one = 1;
+  return *(const uint8_t *)&one == 1;
+}
+
@@ -0,0 +1,48 @@
+/* HornetsEye - Computer Vision with Ruby
+   Copyright (C) 2006, 2007, 2008, 2009, 2010 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef HORNETSEYE_DC1394UNPACK_HH
+#define HORNETSEYE_DC1394UNPACK_HH
+
+#include <stdint.h>
+
+#if defined(__GNUC__) && ( defined(__x86_64__) || defined(__i386__) )
+#define DC1394_X86
+#endif
+
+// Conversion of packed pixels between DC1394 colour codings and Hornetseye
+// typecodes. The byte shuffles use SSSE3 (and AVX2 for swapping bytes) if the
+// processor supports it.
+class DC1394Unpack
+{
+public:
+  static void yuv411ToUYVY( const uint8_t *src, uint8_t *dst, int size );
+  static void yuv411ToRGB( const uint8_t *src, uint8_t *dst, int size );
+  static void yuv411ToGrey( const uint8_t *src, uint8_t *dst, int size );
+  static void uyvyToRGB( const uint8_t *src, uint8_t *dst, int size );
+  static void uyvyToGrey( const uint8_t *src, uint8_t *dst, int size );
+  static void yuv444ToRGB( const uint8_t *src, uint8_t *dst, int size );
+  static void yuv444ToGrey( const uint8_t *src, uint8_t *dst, int size );
+  static void rgbToGrey( const uint8_t *src, uint8_t *dst, int size );
+  static void greyToRGB( const uint8_t *src, uint8_t *dst, int size );
+  static void shortToGrey( const uint16_t *src, uint8_t *dst, int size, int shift );
+  static void swapBytes( uint16_t *data, int size );
+  static bool ssse3(void);
+  static bool avx2(void);
+  static bool littleEndian(void);
+};
+
+#endif
+
@@ -17,52 +17,98 @@
 
 using namespace std;
 
-Frame::Frame( const string &typecode, int width, int height, char *data ):
-  m_frame( Qnil )
+// Classes are looked up once and kept for constructing frames.
+static VALUE mModule = Qnil;
+static VALUE cMalloc = Qnil;
+static VALUE cFrame = Qnil;
+
+static void lookupClasses(void)
+{
+  if ( cFrame == Qnil ) {
+    rb_global_variable( &mModule );
+    rb_global_variable( &cMalloc );
+    rb_global_variable( &cFrame );
+    mModule = rb_define_module( "Hornetseye" );
+    cMalloc = rb_define_class_under( mModule, "Malloc", rb_cObject );
+    cFrame = rb_define_class_under( mModule, "Frame", rb_cObject );
+  };
+}
+
+Frame::Frame( const string &typecode, int width, int height, char *data,
+              VALUE rbOwner ):
+  m_frame( Qnil ), m_width( width ), m_height( height ), m_data( data )
+{
+  VALUE rbTypecode = rubyTypecode( typecode );
+  init( rbTypecode, width, height, storageSize( rbTypecode, width, height ), data,
+        rbOwner );
+}
+
+Frame::Frame( VALUE rbTypecode, int width, int height, int size, char *data,
+              VALUE rbOwner ):
+  m_frame( Qnil ), m_width( width ), m_height( height ), m_data( data )
+{
+  init( rbTypecode, width, height, size, data, rbOwner );
+}
+
+void Frame::init( VALUE rbTypecode, int width, int height, int size, char *data,
+                  VALUE rbOwner )
 {
-  VALUE mModule = rb_define_module( "Hornetseye" );
-  VALUE cMalloc = rb_define_class_under( mModule, "Malloc", rb_cObject );
-  VALUE cFrame = rb_define_class_under( mModule, "Frame", rb_cObject );
-  VALUE rbSize = INT2NUM( storageSize( typecode, width, height ) );
+  static ID idSize = rb_intern( "@size" );
+  static ID idOwner = rb_intern( "@owner" );
+  static ID idNew = rb_intern( "new" );
+  static ID idImport = rb_intern( "import" );
+  lookupClasses();
+  VALUE rbSize = INT2NUM( size );
   VALUE rbMemory;
   if ( data != NULL ) {
     rbMemory = Data_Wrap_Struct( cMalloc, 0, 0, (void *)data );
-    rb_ivar_set( rbMemory, rb_intern( "@size" ), rbSize );
-  } else
-    rbMemory = rb_funcall( cMalloc, rb_intern( "new" ), 1, rbSize );
-  m_frame = rb_funcall( cFrame, rb_intern( "import" ), 4,
-                        rb_const_get( mModule, rb_intern( typecode.c_str() ) ),
+    rb_ivar_set( rbMemory, idSize, rbSize );
+    // The owner keeps the external memory valid as long as it is referenced.
+    if ( rbOwner != Qnil ) rb_ivar_set( rbMemory, idOwner, rbOwner );
+  } else {
+    rbMemory = rb_funcall( cMalloc, idNew, 1, rbSize );
+    Data_Get_Struct( rbMemory, char, m_data );
+  };
+  m_frame = rb_funcall( cFrame, idImport, 4, rbTypecode,
                         INT2NUM( width ), INT2NUM( height ), rbMemory );
 }
 
 string Frame::typecode(void)
 {
-  VALUE rbString = rb_funcall( rb_funcall( m_frame, rb_intern( "typecode" ), 0 ),
-                               rb_intern( "to_s" ), 0 );
+  static ID idTypecode = rb_intern( "typecode" );
+  static ID idToS = rb_intern( "to_s" );
+  VALUE rbString = rb_funcall( rb_funcall( m_frame, idTypecode, 0 ), idToS, 0 );
   return StringValuePtr( rbString );
 }
 
 int Frame::width(void)
 {
-  return NUM2INT( rb_funcall( m_frame, rb_intern( "width" ), 0 ) );
+  static ID idWidth = rb_intern( "width" );
+  if ( m_width < 0 ) m_width = NUM2INT( rb_funcall( m_frame, idWidth, 0 ) );
+  return m_width;
 }
 
 int Frame::height(void)
 {
-  return NUM2INT( rb_funcall( m_frame, rb_intern( "height" ), 0 ) );
+  static ID idHeight = rb_intern( "height" );
+  if ( m_height < 0 ) m_height = NUM2INT( rb_funcall( m_frame, idHeight, 0 ) );
+  return m_height;
 }
 
 char *Frame::data(void)
 {
-  VALUE rbMemory = rb_funcall( m_frame, rb_intern( "memory" ), 0 );
-  char *ptr;
-  Data_Get_Struct( rbMemory, char, ptr );
-  return ptr;
+  static ID idMemory = rb_intern( "memory" );
+  if ( m_data == NULL ) {
+    VALUE rbMemory = rb_funcall( m_frame, idMemory, 0 );
+    Data_Get_Struct( rbMemory, char, m_data );
+  };
+  return m_data;
 }
 
 bool Frame::rgb(void)
 {
-  return rb_funcall( m_frame, rb_intern( "rgb?" ), 0 ) != Qfalse;
+  static ID idRGB = rb_intern( "rgb?" );
+  return rb_funcall( m_frame, idRGB, 0 ) != Qfalse;
 }
 
 void Frame::markRubyMember(void)
@@ -72,10 +118,19 @@ void Frame::markRubyMember(void)
 
 int Frame::storageSize( const std::string &typecode, int width, int height )
 {
-  VALUE mModule = rb_define_module( "Hornetseye" );
-  VALUE cFrame = rb_define_class_under( mModule, "Frame", rb_cObject );
-  return NUM2INT( rb_funcall( cFrame, rb_intern( "storage_size" ), 3,
-                              rb_const_get( mModule, rb_intern( typecode.c_str() ) ),
+  return storageSize( rubyTypecode( typecode ), width, height );
+}
+
+int Frame::storageSize( VALUE rbTypecode, int width, int height )
+{
+  static ID idStorageSize = rb_intern( "storage_size" );
+  lookupClasses();
+  return NUM2INT( rb_funcall( cFrame, idStorageSize, 3, rbTypecode,
                               INT2NUM( width ), INT2NUM( height ) ) );
 }
- 
+
+VALUE Frame::rubyTypecode( const std::string &typecode )
+{
+  lookupClasses();
+  return rb_const_get( mModule, rb_intern( typecode.c_str() ) );
+}
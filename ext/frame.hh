@@ -23,8 +23,12 @@
 class Frame
 {
 public:
-  Frame( const std::string &typecode, int width, int height, char *data = NULL );
-  Frame( VALUE rbFrame ): m_frame( rbFrame ) {}
+  Frame( const std::string &typecode, int width, int height, char *data = NULL,
+         VALUE rbOwner = Qnil );
+  Frame( VALUE rbTypecode, int width, int height, int size, char *data = NULL,
+         VALUE rbOwner = Qnil );
+  Frame( VALUE rbFrame ): m_frame( rbFrame ), m_width( -1 ), m_height( -1 ),
+    m_data( NULL ) {}
   virtual ~Frame(void) {}
   std::string typecode(void);
   int width(void);
@@ -34,8 +38,16 @@ public:
   VALUE rubyObject(void) { return m_frame; }
   void markRubyMember(void);
   static int storageSize( const std::string &typecode, int width, int height );
+  static int storageSize( VALUE rbTypecode, int width, int height );
+  static VALUE rubyTypecode( const std::string &typecode );
 protected:
+  void init( VALUE rbTypecode, int width, int height, int size, char *data,
+             VALUE rbOwner );
   VALUE m_frame;
+  // Known when the frame was constructed here and looked up lazily otherwise.
+  int m_width;
+  int m_height;
+  char *m_data;
 };
 
 typedef boost::shared_ptr< Frame > FramePtr;
@@ -16,6 +16,10 @@
 #include "rubyinc.hh"
 #include "dc1394.hh"
 #include "dc1394input.hh"
+#include "dc1394lease.hh"
+#include "dc1394group.hh"
+#include "dc1394bench.hh"
+#include "dc1394pool.hh"
 
 #ifdef WIN32
 #define DLLEXPORT __declspec(dllexport)
@@ -27,6 +31,12 @@
 
 extern "C" DLLEXPORT void Init_hornetseye_dc1394(void);
 
+static void stopPool( VALUE )
+{
+  DC1394Input::freeDeferred( true );
+  DC1394Pool::shutdown();
+}
+
 extern "C" {
 
   void Init_hornetseye_dc1394(void)
@@ -35,6 +45,12 @@ extern "C" {
     VALUE rbHornetseye = rb_define_module( "Hornetseye" );
     DC1394::registerRubyClass( rbHornetseye );
     DC1394Input::registerRubyClass( rbHornetseye );
+    DC1394Lease::registerRubyClass( rbHornetseye );
+    DC1394Group::registerRubyClass( rbHornetseye );
+    DC1394Bench::registerRubyClass( rbHornetseye );
+    // The worker pool is shared by all handles and stopped at process exit.
+    // Cameras released by the garbage collector are freed before that.
+    rb_set_end_proc( stopPool, Qnil );
     rb_require( "hornetseye_dc1394_ext.rb" );
   }
 
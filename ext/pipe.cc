@@ -0,0 +1,49 @@
+/* HornetsEye - Computer Vision with Ruby
+   Copyright (C) 2006, 2007, 2008, 2009, 2010   Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include "pipe.hh"
+
+void openPipe( int fds[2] ) throw (Error)
+{
+  ERRORMACRO( pipe( fds ) == 0, Error, , "Error creating pipe: "
+              << strerror( errno ) );
+  fcntl( fds[0], F_SETFL, O_NONBLOCK );
+  fcntl( fds[1], F_SETFL, O_NONBLOCK );
+}
+
+void closePipe( int fds[2] )
+{
+  for ( int i=0; i<2; i++ )
+    if ( fds[i] != -1 ) {
+      close( fds[i] );
+      fds[i] = -1;
+    };
+}
+
+void drainPipe( int fd )
+{
+  char buffer[16];
+  while ( read( fd, buffer, sizeof(buffer) ) > 0 );
+}
+
+void signalPipe( int fd )
+{
+  char c = 0;
+  write( fd, &c, 1 );
+}
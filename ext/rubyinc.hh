@@ -23,7 +23,7 @@
 #define gettimeofday rubygettimeofday
 #define timezone rubygettimezone
 #include <ruby.h>
-// #include <version.h>
+#include <ruby/version.h>
 #undef timezone
 #undef gettimeofday
 #ifdef read
@@ -46,6 +46,13 @@
 #define RUBY_METHOD_FUNC(func) ((VALUE (*)(ANYARGS))func)
 #endif
 
+#if RUBY_API_VERSION_MAJOR >= 2
+#include <ruby/thread.h>
+#else
+#define rb_thread_call_without_gvl( func, data1, ubf, data2 ) \
+  rb_thread_blocking_region( (VALUE (*)(void *))( func ), data1, ubf, data2 )
+#endif
+
 #ifndef xfree
 #define xfree free
 #endif
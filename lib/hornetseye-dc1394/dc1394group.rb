@@ -0,0 +1,142 @@
+# hornetseye-dc1394 - Capture from DC1394 compatible firewire camera
+# Copyright (C) 2010 Jan Wedekind
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# Namespace of Hornetseye computer vision library
+module Hornetseye
+
+  # Class for capturing from several DC1394-compatible firewire cameras
+  #
+  # The group waits on all cameras at once and returns frames as they arrive or
+  # returns sets of frames with matching timestamps.
+  class DC1394Group
+
+    class << self
+
+      # Alias for overriding native method
+      #
+      # @private
+      alias_method :orig_new, :new
+
+      # Create a group of firewire cameras
+      #
+      # @example Capturing from the first two cameras
+      #   group = DC1394Group.new 0, 1
+      #   group.each { |index, frame| puts "camera #{index}: #{frame.shape.inspect}" }
+      #
+      # @param [Array<DC1394Input,Integer,Hash>] inputs Opened cameras, or camera
+      #        nodes or GUIDs (e.g. +:guid => 0x00b09d01006fb1c2+) to open with
+      #        default settings.
+      #
+      # @return [DC1394Group] An object for accessing the firewire cameras.
+      def new( *inputs )
+        retval = orig_new
+        inputs.each do |input|
+          retval.add input.is_a?( DC1394Input ) ? input : DC1394Input.new( input )
+        end
+        retval
+      end
+
+    end
+
+    # Alias for overriding native method
+    #
+    # @private
+    alias_method :orig_add, :add
+
+    # Alias for overriding native method
+    #
+    # @private
+    alias_method :orig_close, :close
+
+    # Alias for overriding native method
+    #
+    # @private
+    alias_method :orig_read, :read
+
+    # Alias for overriding native method
+    #
+    # @private
+    alias_method :orig_read_set, :read_set
+
+    # Add a camera to the group
+    #
+    # All cameras of a group must share the same DC1394 handle.
+    #
+    # @param [DC1394Input] input Camera to add.
+    #
+    # @return [DC1394Group] Returns +self+.
+    def add( input )
+      orig_add input
+      inputs.push input
+      self
+    end
+
+    # Cameras of this group
+    #
+    # @return [Array<DC1394Input>] The cameras in the order they were added.
+    def inputs
+      @inputs ||= []
+    end
+
+    # Close the group and all its cameras
+    #
+    # @return [DC1394Group] Returns +self+.
+    def close
+      orig_close
+      inputs.each { |input| input.close }
+      self
+    end
+
+    # Read the next frame from whichever camera has one ready
+    #
+    # @param [Float,NilClass] timeout Maximum time to wait in seconds or +nil+ to
+    #        wait indefinitely.
+    #
+    # @return [Array,NilClass] Index of camera and video frame or +nil+ if the
+    #         timeout expired.
+    def read( timeout = nil )
+      orig_read timeout ? ( timeout * 1000 ).round : -1
+    end
+
+    # Read a set of frames with matching timestamps
+    #
+    # @param [Float] tolerance Maximum difference of timestamps in seconds.
+    #
+    # @return [Array<Frame_>] One video frame per camera.
+    def read_set( tolerance )
+      orig_read_set ( tolerance * 1000000 ).round
+    end
+
+    # Yield frames as they arrive
+    #
+    # @yield [index, frame] Index of camera and video frame.
+    def each
+      loop { yield *read }
+    end
+
+    # Yield sets of frames with matching timestamps
+    #
+    # @param [Float] tolerance Maximum difference of timestamps in seconds.
+    #
+    # @yield [frames] One video frame per camera.
+    def each_set( tolerance )
+      loop { yield read_set( tolerance ) }
+    end
+
+  end
+
+end
+
@@ -38,47 +38,80 @@ module Hornetseye
 
       # Open the firewire camera
       #
-      # @param [Integer] node Camera node to open.
-      # @param [Integer] speed Firewire bus speed.
+      # @example Opening a camera by its GUID
+      #   input = DC1394Input.new :guid => 0x00b09d01006fb1c2
+      #
+      # @example Opening a colour camera with at least 30 frames per second
+      #   input = DC1394Input.new 0, SPEED_400, nil, 4, CAPTURE_FLAGS_DEFAULT,
+      #                           :min_frame_rate => 30
+      #
+      # @param [Integer,Hash] node Index of camera in the list returned by
+      #        +cameras+ or a hash with the keys +:guid+ and optionally +:unit+.
+      #        The index of a camera can change after a bus reset while the GUID
+      #        stays the same.
+      # @param [Integer] speed Firewire bus speed. Speeds above +SPEED_400+
+      #        switch the camera to 1394b mode. If the camera or the bus does not
+      #        support this, a slower speed is used (see +speed+).
       # @param [Integer,NilClass] frame_rate Desired frame rate.
+      # @param [Integer] buffers Number of DMA buffers. More buffers make capture
+      #        more robust at high frame rates, fewer buffers reduce latency.
+      # @param [Integer] flags Capture flags (see +CAPTURE_FLAGS_DEFAULT+,
+      #        +CAPTURE_FLAGS_CHANNEL_ALLOC+, +CAPTURE_FLAGS_BANDWIDTH_ALLOC+, and
+      #        +CAPTURE_FLAGS_AUTO_ISO+).
+      # @param [Hash] policy Native policy for selecting the video mode and frame
+      #        rate if no block is given. +:codings+ is an array of acceptable
+      #        color codings (e.g. +MODE_RGB8+) in order of preference.
+      #        +:min_width+, +:min_height+, and +:min_frame_rate+ exclude smaller
+      #        or slower modes. +:max_bandwidth+ is a budget in bytes per second.
+      #        If it is given, the mode with the highest data rate within the
+      #        budget is chosen. Otherwise the mode with the highest resolution
+      #        and frame rate is chosen. Without +:codings+ RGB8 is preferred
+      #        over YUV422, MONO16, and MONO8 followed by modes requiring
+      #        conversion. Format7 modes are only chosen as a last resort.
       # @param [Proc] action Optional block for selecting the desired video mode.
+      #        It overrides +policy+.
       #
       # return [DC1394Input] An object for accessing the firewire camera.
-      def new( node = 0, speed = SPEED_400, frame_rate = nil, &action )
+      def new( node = 0, speed = SPEED_400, frame_rate = nil, buffers = 4,
+               flags = CAPTURE_FLAGS_DEFAULT, policy = {}, &action )
         dc1394 = @@dc1394 || DC1394.new
         begin
-          retval = orig_new dc1394, node, speed, frame_rate != nil,
-                   frame_rate || FRAMERATE_240 do |modes|
-            map = { MODE_MONO8  => UBYTE,
-                    MODE_YUV422 => UYVY,
-                    MODE_RGB8   => UBYTERGB,
-                    MODE_MONO16 => USINT }
-            frame_types, index = [], []
-            modes.each do |mode|
-              unless map[mode.first]
-                warn "Unsupported video mode #{"0x%08x" % mode.first} #{mode[1]}x#{mode[2]}"
+          args = [ dc1394, node, speed, frame_rate != nil,
+                   frame_rate || FRAMERATE_240, buffers, flags, policy ]
+          retval = if action
+            orig_new( *args ) do |modes|
+              map = { MODE_MONO8   => UBYTE,
+                      MODE_YUV411  => UYVY,
+                      MODE_YUV422  => UYVY,
+                      MODE_YUV444  => UBYTERGB,
+                      MODE_RGB8    => UBYTERGB,
+                      MODE_MONO16  => USINT,
+                      MODE_RGB16   => USINTRGB,
+                      MODE_MONO16S => SINT,
+                      MODE_RGB16S  => SINTRGB,
+                      MODE_RAW8    => UBYTERGB,
+                      MODE_RAW16   => USINTRGB }
+              frame_types, index = [], []
+              modes.each do |mode|
+                unless map[mode.first]
+                  warn "Unsupported video mode #{"0x%08x" % mode.first} #{mode[1]}x#{mode[2]}"
+                end
               end
-            end
-            modes.collect { |mode| [map[mode.first], *mode[1 .. 2]] }.
-              each_with_index do |mode,i|
-              if mode.first
-                frame_types.push mode
-                index.push i
+              modes.collect { |mode| [map[mode.first], *mode[1 .. 2]] }.
+                each_with_index do |mode,i|
+                if mode.first
+                  frame_types.push mode
+                  index.push i
+                end
               end
-            end
-            if action
               desired = action.call frame_types
-            else
-              preference = [ UBYTERGB, UYVY, USINT, UBYTE ]
-              desired = frame_types.sort_by do |mode|
-                [-preference.index(mode.first), mode[1] * mode[2]]
-              end.last
-              raise "Device does not support a known video mode" unless desired
-            end
-            unless frame_types.member? desired
-              raise "Frame type #{desired.inspect} not supported by camera" 
+              unless frame_types.member? desired
+                raise "Frame type #{desired.inspect} not supported by camera" 
+              end
+              index[frame_types.index(desired)]
             end
-            index[frame_types.index(desired)]
+          else
+            orig_new( *args )
           end
           @@dc1394 = dc1394
           retval
@@ -87,6 +120,294 @@ module Hornetseye
         end
       end
 
+      # List cameras connected to the firewire bus
+      #
+      # The list is cached by the shared DC1394 handle so that opening cameras
+      # does not probe the bus again.
+      #
+      # @return [Array<Hash>] Information about each camera (see +DC1394#cameras+).
+      #
+      # @see refresh
+      def cameras
+        @@dc1394 ||= DC1394.new
+        @@dc1394.cameras
+      end
+
+      # Enumerate cameras again
+      #
+      # This is required after connecting or disconnecting cameras.
+      #
+      # @return [Array<Hash>] Information about each camera (see +DC1394#cameras+).
+      def refresh
+        @@dc1394 ||= DC1394.new
+        @@dc1394.refresh.cameras
+      end
+
+
+      # Replace the firewire bus with simulated cameras
+      #
+      # Cameras opened, listed, or planned afterwards are simulated. This allows
+      # for testing programs without firewire hardware.
+      #
+      # @example Simulating two colour cameras which drop one frame in fifty
+      #   DC1394Input.simulate :cameras => 2, :drop_rate => 0.02
+      #   input = DC1394Input.new 0, SPEED_400, FRAMERATE_30
+      #
+      # @param [Hash] options Simulator configuration.
+      # @option options [Integer] :cameras Number of cameras (default 1).
+      # @option options [Array<Array>] :modes Fixed video modes as triples of
+      #         colour coding (e.g. +MODE_YUV422+), width, and height.
+      # @option options [Array<Integer>] :frame_rates Supported frame rates
+      #         (e.g. +FRAMERATE_30+).
+      # @option options [Integer] :format7_width Sensor width for format7 mode or
+      #         zero to disable format7 mode.
+      # @option options [Integer] :format7_height Sensor height for format7 mode.
+      # @option options [Array<Integer>] :format7_codings Colour codings offered
+      #         in format7 mode.
+      # @option options [Integer] :bayer Bayer pattern of raw format7 frames
+      #         (e.g. +BAYER_RGGB+).
+      # @option options [Boolean] :b_mode Support 1394b operation mode.
+      # @option options [Float] :drop_rate Fraction of frames to drop.
+      # @option options [Integer] :bus_reset_after Number of frames after which
+      #         a bus reset stops the transmission (zero for never).
+      #
+      # @return [DC1394] The simulator handle.
+      def simulate( options = {} )
+        @@dc1394.close if @@dc1394
+        @@dc1394 = DC1394.simulate options
+      end
+
+      # Distribute the bandwidth of a firewire bus among several cameras
+      #
+      # The plan is computed without starting any transmission so that it can be
+      # inspected before opening the cameras with +open_plan+. Cameras which are
+      # capturing already keep their bandwidth and cannot be part of the plan.
+      #
+      # @example Running three cameras at the highest frame rates the bus allows
+      #   plan = DC1394Input.plan [ { :node => 0 }, { :node => 1 },
+      #                             { :node => 2, :min_frame_rate => 15 } ]
+      #   plan.each { |entry| puts "#{entry[ :guid ]}: #{entry[ :fps ]} fps" }
+      #   inputs = DC1394Input.open_plan plan
+      #
+      # @param [Array<Hash>] requests One hash per camera with the keys +:node+ or
+      #        +:guid+ and +:unit+ and optional policy keys (see +new+).
+      # @param [Integer] speed Firewire bus speed.
+      # @param [Integer,NilClass] budget Available bandwidth units or +nil+ for the
+      #        maximum of 4915 units.
+      #
+      # @return [Array<Hash>] Video mode, frame rate, packet size, and bandwidth
+      #         for each camera (see +DC1394#plan+).
+      def plan( requests, speed = SPEED_400, budget = nil )
+        @@dc1394 ||= DC1394.new
+        @@dc1394.plan requests, speed, budget
+      end
+
+      # Open cameras according to a plan
+      #
+      # @param [Array<Hash>] plan Plan returned by +plan+.
+      # @param [Integer] speed Firewire bus speed used for planning.
+      # @param [Integer] buffers Number of DMA buffers for each camera.
+      # @param [Integer] flags Capture flags.
+      #
+      # @return [Array<DC1394Input>] The opened cameras.
+      def open_plan( plan, speed = SPEED_400, buffers = 4,
+                     flags = CAPTURE_FLAGS_DEFAULT )
+        inputs = []
+        begin
+          plan.each do |entry|
+            inputs.push new( { :guid => entry[ :guid ], :unit => entry[ :unit ] },
+                             speed, entry[ :frame_rate ], buffers, flags,
+                             :mode => entry[ :mode ],
+                             :packet_size => entry[ :frame_rate ] ? nil :
+                                             entry[ :packet_size ] )
+          end
+        rescue
+          inputs.each { |input| input.close }
+          raise
+        end
+        inputs
+      end
+
+    end
+
+    # Alias for overriding native method
+    #
+    # @private
+    alias_method :orig_close, :close
+
+    # Close the video device
+    #
+    # @param [Boolean] keep_powered Leave the camera powered and configured.
+    #        Opening it again with the same DC1394 handle is faster then.
+    #
+    # @return [DC1394Input] Returns +self+.
+    def close( keep_powered = false )
+      orig_close keep_powered
+    end
+
+    # Alias for overriding native method
+    #
+    # @private
+    alias_method :orig_auto_exposure_start, :auto_exposure_start
+
+    # Start native exposure control
+    #
+    # The luminance histogram of every frame returned by +read+ is computed from
+    # a subsampled region of interest. Shutter and gain are adjusted towards the
+    # target luminance using asynchronous feature writes (see
+    # +feature_write_async+). The shutter time is raised before the gain and
+    # the gain is lowered before the shutter time. A new correction is only
+    # made once the previous one is visible in the frames.
+    #
+    # @example Keep the centre of a VGA image at medium brightness
+    #   camera.auto_exposure_start :target => 110, :roi => [ 160, 120, 320, 240 ]
+    #
+    # @param [Hash] options Controller settings.
+    # @option options [Float] :target Desired mean luminance (0 to 255,
+    #         default 110).
+    # @option options [Float] :tolerance Deviation of the mean luminance which
+    #         is tolerated without correction (default 8).
+    # @option options [Float] :damping Fraction of the correction withheld in
+    #         each step (0 to 1, default 0.5).
+    # @option options [Integer] :step Only every step-th pixel of every
+    #         step-th row is sampled (default 4).
+    # @option options [Array<Integer>] :roi Region of interest as left, top,
+    #         width, and height (default whole frame).
+    # @option options [Integer] :shutter_min Lower limit of the shutter.
+    # @option options [Integer] :shutter_max Upper limit of the shutter.
+    # @option options [Integer] :gain_min Lower limit of the gain.
+    # @option options [Integer] :gain_max Upper limit of the gain.
+    # @option options [Float] :gain_per_stop Gain units which double the
+    #         brightness (default a quarter of the gain range).
+    #
+    # @return [DC1394Input] Returns +self+.
+    def auto_exposure_start( options = {} )
+      orig_auto_exposure_start options
+    end
+
+    # Alias for overriding native method
+    #
+    # @private
+    alias_method :orig_async_start, :async_start
+
+    # Capture frames in a background thread
+    #
+    # A native thread keeps dequeueing frames from the camera so that DMA buffers
+    # do not run out while the Ruby program is busy. +read+ then returns a frame
+    # from the queue of ready frames.
+    #
+    # @param [Integer] order +READ_NEWEST+ to skip to the most recent frame or
+    #        +READ_OLDEST+ to return frames in the order they were captured.
+    #
+    # @return [DC1394Input] Returns +self+.
+    def async_start( order = READ_NEWEST )
+      orig_async_start order
+    end
+
+    # Alias for overriding native method
+    #
+    # @private
+    alias_method :orig_format7_write, :format7_write
+
+    # Set region of interest, packet size, and color coding in format7 mode
+    #
+    # Cropping the image at the sensor reduces the amount of data transferred
+    # and allows for higher frame rates. Position and size must be multiples of
+    # the unit sizes reported by +format7_read+. Video frames held by the
+    # application must be released before reconfiguring the camera.
+    #
+    # @param [Integer] left Horizontal position of region of interest.
+    # @param [Integer] top Vertical position of region of interest.
+    # @param [Integer] width Width of region of interest.
+    # @param [Integer] height Height of region of interest.
+    # @param [Integer,NilClass] packet_size Bytes per isochronous packet. A
+    #        multiple of +:unit_bytes+ not exceeding +:max_bytes+ or +nil+ to use
+    #        the value recommended by the camera.
+    # @param [Integer,NilClass] coding Color coding (e.g. +MODE_RAW8+) or +nil+
+    #        to keep the current one.
+    #
+    # @return [DC1394Input] Returns +self+.
+    def format7_write( left, top, width, height, packet_size = nil, coding = nil )
+      orig_format7_write coding || format7_read[ :coding ], packet_size || 0,
+                         left, top, width, height
+    end
+
+    # Switch to triggered capture
+    #
+    # The camera only captures a frame when it receives a trigger.
+    #
+    # @example Capturing a frame on demand
+    #   input.trigger_on
+    #   frame = input.snap
+    #
+    # @param [Integer] source Trigger source (e.g. +TRIGGER_SOURCE_0+ for the
+    #        first input line or +TRIGGER_SOURCE_SOFTWARE+).
+    # @param [Integer] mode Trigger mode (e.g. +TRIGGER_MODE_0+ to start the
+    #        exposure at the edge of the trigger signal).
+    # @param [Integer] polarity +TRIGGER_ACTIVE_HIGH+ or +TRIGGER_ACTIVE_LOW+.
+    #        This is ignored if the camera does not support it.
+    #
+    # @return [DC1394Input] Returns +self+.
+    #
+    # @see trigger_read
+    def trigger_on( source = TRIGGER_SOURCE_SOFTWARE, mode = TRIGGER_MODE_0,
+                    polarity = TRIGGER_ACTIVE_HIGH )
+      trigger_write true, source, mode, polarity
+    end
+
+    # Switch back to free-running capture
+    #
+    # @return [DC1394Input] Returns +self+.
+    def trigger_off
+      info = trigger_read
+      trigger_write false, info[ :source ], info[ :mode ], info[ :polarity ]
+    end
+
+    # Fire a software trigger and read the resulting frame
+    #
+    # Frames captured before the trigger are skipped. The method waits until
+    # the frame arrives, so it should only be used with
+    # +TRIGGER_SOURCE_SOFTWARE+.
+    #
+    # @return [MultiArray,Frame_] The video frame.
+    def snap
+      trigger = software_trigger
+      loop do
+        frame = read
+        info = last_frame_info
+        return frame if info[ :trigger ] and info[ :trigger ] >= trigger
+      end
+    end
+
+    # Return the DMA buffer of a video frame to the camera
+    #
+    # Video frames returned by +read+ refer to the DMA buffers of the camera
+    # directly. A buffer is returned to the camera when the video frame is garbage
+    # collected or when it is released using this method. The video frame must not
+    # be used after releasing it.
+    #
+    # @param [Frame_] frame Video frame returned by +read+ or +try_read+.
+    #
+    # @return [Frame_] Returns +frame+.
+    def release( frame )
+      owner = frame.memory.instance_variable_get :@owner
+      owner.release if owner.is_a? DC1394Lease
+      frame
+    end
+
+    # IO object for waiting on frames with +IO.select+
+    #
+    # @example Waiting for the next camera having a frame ready
+    #   ready = IO.select( [ camera1, camera2 ] ).first
+    #   frames = ready.collect { |camera| camera.try_read }.compact
+    #
+    # @return [IO] IO object refering to the file descriptor returned by +fileno+.
+    def to_io
+      unless @io and @io.fileno == fileno
+        @io = IO.for_fd fileno
+        @io.autoclose = false
+      end
+      @io
     end
 
     include ReaderConversion
@@ -204,20 +204,172 @@ module Hornetseye
       # Feature mode
       FEATURE_MODE_ONE_PUSH_AUTO = nil
 
-    end
+      # Capture flag for allocating an isochronous channel
+      CAPTURE_FLAGS_CHANNEL_ALLOC = nil
+
+      # Capture flag for allocating isochronous bandwidth
+      CAPTURE_FLAGS_BANDWIDTH_ALLOC = nil
+
+      # Default capture flags
+      CAPTURE_FLAGS_DEFAULT = nil
+
+      # Capture flag for starting isochronous transmission automatically
+      CAPTURE_FLAGS_AUTO_ISO = nil
+
+      # Return frames of background capture in the order they were captured
+      READ_OLDEST = nil
+
+      # Skip to the most recent frame of background capture
+      READ_NEWEST = nil
+
+      # Bayer pattern with red pixel in the top left corner
+      BAYER_RGGB = nil
+
+      # Bayer pattern with green and blue pixel in the top row
+      BAYER_GBRG = nil
+
+      # Bayer pattern with green and red pixel in the top row
+      BAYER_GRBG = nil
+
+      # Bayer pattern with blue pixel in the top left corner
+      BAYER_BGGR = nil
+
+      # Demosaic by replicating the pixels of each 2x2 block
+      DEMOSAIC_NEAREST = nil
+
+      # Demosaic by averaging neighbouring pixels
+      DEMOSAIC_BILINEAR = nil
+
+      # Demosaic by interpolating green along the direction of the smaller gradient
+      DEMOSAIC_EDGE_AWARE = nil
+
+      # Trigger mode: exposure starts at the edge of the trigger signal
+      TRIGGER_MODE_0 = nil
+
+      # Trigger mode: exposure lasts as long as the trigger signal is active
+      TRIGGER_MODE_1 = nil
+
+      # Trigger mode
+      TRIGGER_MODE_2 = nil
+
+      # Trigger mode
+      TRIGGER_MODE_3 = nil
+
+      # Trigger mode
+      TRIGGER_MODE_4 = nil
+
+      # Trigger mode
+      TRIGGER_MODE_5 = nil
+
+      # Trigger mode (vendor specific)
+      TRIGGER_MODE_14 = nil
+
+      # Trigger mode (vendor specific)
+      TRIGGER_MODE_15 = nil
+
+      # Trigger source: first input line
+      TRIGGER_SOURCE_0 = nil
+
+      # Trigger source: second input line
+      TRIGGER_SOURCE_1 = nil
+
+      # Trigger source: third input line
+      TRIGGER_SOURCE_2 = nil
+
+      # Trigger source: fourth input line
+      TRIGGER_SOURCE_3 = nil
+
+      # Trigger source: +software_trigger+
+      TRIGGER_SOURCE_SOFTWARE = nil
+
+      # Trigger polarity
+      TRIGGER_ACTIVE_LOW = nil
+
+      # Trigger polarity
+      TRIGGER_ACTIVE_HIGH = nil
 
-    # Close the video device
-    #
-    # @return [DC1394Input] Returns +self+.
-    def close
     end
 
     # Read a video frame
     #
+    # Other Ruby threads keep running while this method is waiting for the next
+    # frame. The wait can be interrupted with +Thread#kill+ or +Thread#raise+.
+    #
     # @return [MultiArray,Frame_] The video frame.
     def read
     end
 
+    # Stop capturing frames in a background thread
+    #
+    # @return [DC1394Input] Returns +self+.
+    def async_stop
+    end
+
+    # Check whether frames are captured in a background thread
+    #
+    # @return [Boolean] Returns +true+ if background capture is active.
+    def async?
+    end
+
+    # Information about the frame returned by the last call to +read+
+    #
+    # The hash contains the capture timestamp in microseconds (+:timestamp+), the
+    # position of the frame in the DMA ring buffer (+:id+), the number of frames
+    # the driver had queued behind it (+:frames_behind+), the number of frames
+    # waiting in the queue of the background thread (+:queued+), the number of
+    # isochronous packets per frame (+:packets_per_frame+), whether the frame
+    # is corrupt (+:corrupt+), and the number of the software trigger which
+    # produced the frame (+:trigger+) with the time in microseconds from the
+    # trigger to the arrival of the frame (+:trigger_latency+). Both are +nil+ if
+    # the frame cannot be attributed to a software trigger. +:command+ is the
+    # serial number of the most recent asynchronous feature write which was
+    # completed before the frame was exposed (see +feature_write_async+).
+    #
+    # @return [Hash] Information about the last frame.
+    def last_frame_info
+    end
+
+    # Capture statistics
+    #
+    # The hash contains the number of frames returned (+:frames_read+), copied
+    # because of a lack of spare DMA buffers (+:frames_copied+), skipped by
+    # background capture (+:frames_skipped+), presumably lost judging by the
+    # frame timestamps (+:frames_dropped+), and marked as corrupt
+    # (+:frames_corrupt+). +:exposure_errors+ counts the exposure corrections
+    # which could not be submitted. Furthermore there are histograms of the
+    # time spent waiting for frames (+:wait+), the time between frames
+    # (+:interval+), and the time spent on converting frames
+    # (+:conversion+). Each histogram
+    # provides +:count+, +:mean+, and +:max+ in microseconds and an array of
+    # +:buckets+ where bucket +i+ counts durations below 2**i microseconds.
+    #
+    # @return [Hash] Capture statistics.
+    def stats
+    end
+
+    # Reset capture statistics
+    #
+    # @return [DC1394Input] Returns +self+.
+    def reset_stats
+    end
+
+    # Read a video frame if one is ready
+    #
+    # This method does not wait for the camera.
+    #
+    # @return [MultiArray,Frame_,NilClass] The video frame or +nil+ if no frame is
+    #         ready.
+    def try_read
+    end
+
+    # File descriptor for waiting on frames
+    #
+    # The file descriptor becomes readable when +try_read+ can return a frame.
+    #
+    # @return [Integer] File descriptor for use with +select+, +poll+, or +epoll+.
+    def fileno
+    end
+
     # Check whether device is not closed
     #
     # @return [Boolean] Returns +true+ as long as device is open.
@@ -236,6 +388,209 @@ module Hornetseye
     def height
     end
 
+    # Number of DMA buffers
+    #
+    # @return [Integer] Number of DMA buffers used for capturing.
+    def buffers
+    end
+
+    # Size of a single DMA buffer
+    #
+    # @return [Integer] Size of a video frame in bytes as transferred by the camera.
+    def frame_bytes
+    end
+
+    # Total size of DMA buffers
+    #
+    # @return [Integer] Memory reserved for DMA buffers in bytes.
+    def dma_bytes
+    end
+
+    # Number of DMA buffers to keep available for the camera
+    #
+    # If returning a frame without copying would leave fewer DMA buffers for the
+    # camera, the frame is copied instead and the DMA buffer is returned
+    # immediately.
+    #
+    # @return [Integer] Number of spare DMA buffers.
+    def spare_buffers
+    end
+
+    # Set number of DMA buffers to keep available for the camera
+    #
+    # Setting this to +buffers+ copies every frame. Setting it to zero never copies
+    # frames but +read+ raises an exception when all DMA buffers are held by
+    # video frames.
+    #
+    # @param [Integer] value Number of spare DMA buffers.
+    #
+    # @return [Integer] Returns +value+.
+    def spare_buffers=( value )
+    end
+
+    # Number of DMA buffers held by video frames
+    #
+    # @return [Integer] Number of DMA buffers not yet returned to the camera.
+    def leased
+    end
+
+    # Check whether the camera delivers raw Bayer images
+    #
+    # Raw Bayer images (+MODE_RAW8+ and +MODE_RAW16+) are converted to +UBYTERGB+
+    # or +USINTRGB+ frames.
+    #
+    # @return [Boolean] Returns +true+ if frames are demosaiced.
+    def raw?
+    end
+
+    # Bayer pattern used for demosaicing
+    #
+    # The pattern is queried from the camera in format7 modes and defaults to
+    # +BAYER_RGGB+ otherwise.
+    #
+    # @return [Integer] One of +BAYER_RGGB+, +BAYER_GBRG+, +BAYER_GRBG+, and
+    #         +BAYER_BGGR+.
+    def bayer_pattern
+    end
+
+    # Set Bayer pattern used for demosaicing
+    #
+    # @param [Integer] value One of +BAYER_RGGB+, +BAYER_GBRG+, +BAYER_GRBG+, and
+    #        +BAYER_BGGR+.
+    #
+    # @return [Integer] Returns +value+.
+    def bayer_pattern=( value )
+    end
+
+    # Demosaicing method
+    #
+    # @return [Integer] One of +DEMOSAIC_NEAREST+, +DEMOSAIC_BILINEAR+ (default),
+    #         and +DEMOSAIC_EDGE_AWARE+.
+    def demosaic
+    end
+
+    # Set demosaicing method
+    #
+    # @param [Integer] value One of +DEMOSAIC_NEAREST+, +DEMOSAIC_BILINEAR+, and
+    #        +DEMOSAIC_EDGE_AWARE+.
+    #
+    # @return [Integer] Returns +value+.
+    def demosaic=( value )
+    end
+
+    # Get trigger settings of camera
+    #
+    # The hash contains whether triggered capture is enabled (+:enabled+), the
+    # trigger source (+:source+), mode (+:mode+), and polarity (+:polarity+),
+    # whether the polarity can be changed (+:polarity_capable+), and the
+    # supported sources (+:sources+) and modes (+:modes+).
+    #
+    # @return [Hash] Trigger settings.
+    def trigger_read
+    end
+
+    # Configure triggered capture
+    #
+    # @param [Boolean] enabled Set to +true+ to enable triggered capture.
+    # @param [Integer] source Trigger source (e.g. +TRIGGER_SOURCE_SOFTWARE+).
+    # @param [Integer] mode Trigger mode (e.g. +TRIGGER_MODE_0+).
+    # @param [Integer] polarity +TRIGGER_ACTIVE_HIGH+ or +TRIGGER_ACTIVE_LOW+.
+    #
+    # @return [DC1394Input] Returns +self+.
+    #
+    # @private
+    def trigger_write( enabled, source, mode, polarity )
+    end
+
+    # Fire a software trigger
+    #
+    # The trigger is paired with the first frame captured after it (see
+    # +last_frame_info+).
+    #
+    # @return [Integer] Number of the trigger.
+    def software_trigger
+    end
+
+    # Get globally unique identifier of camera
+    #
+    # @return [Integer] The 64 bit GUID of the camera.
+    def guid
+    end
+
+    # Get unit number of camera
+    #
+    # @return [Integer] Unit of a camera with several units sharing one GUID.
+    def unit
+    end
+
+    # Get effective firewire bus speed
+    #
+    # This can be slower than the speed requested when opening the camera.
+    #
+    # @return [Integer] Bus speed (e.g. +SPEED_800+).
+    def speed
+    end
+
+    # Check whether the camera is in 1394b operation mode
+    #
+    # @return [Boolean] Returns +true+ for 1394b and +false+ for legacy mode.
+    def b_mode?
+    end
+
+    # Get isochronous bandwidth used by the camera
+    #
+    # The bus provides 4915 bandwidth units. One unit is the time needed to
+    # transfer four bytes at 1600 Mb/s.
+    #
+    # @return [Integer] Bandwidth units used by the current video mode.
+    def bandwidth
+    end
+
+    # Check whether the camera is in a scalable (format7) video mode
+    #
+    # @return [Boolean] Returns +true+ if +format7_write+ can be used.
+    def format7?
+    end
+
+    # Query format7 settings
+    #
+    # The hash contains the region of interest (+:left+, +:top+, +:width+,
+    # +:height+), the maximum image size (+:max_width+, +:max_height+), the
+    # units for size (+:unit_width+, +:unit_height+) and position (+:unit_left+,
+    # +:unit_top+), the packet size (+:packet_size+) with its unit
+    # (+:unit_bytes+) and maximum (+:max_bytes+), the number of bytes per frame
+    # (+:total_bytes+), the current and the supported color codings (+:coding+,
+    # +:codings+), and the resulting frame rate (+:frame_rate+) if the camera
+    # reports it.
+    #
+    # @return [Hash] Format7 settings.
+    def format7_read
+    end
+
+    # Typecode of the frames returned by +read+
+    #
+    # @return [Class] Typecode such as +UBYTE+, +UBYTERGB+, or +UYVY+.
+    def output
+    end
+
+    # Convert frames to the specified typecode while reading
+    #
+    # The conversion is performed natively in one pass from the DMA buffer to
+    # the video frame. This is faster than calling +to_ubytergb+ or +to_ubyte+ on
+    # every frame. Converting YUV411, YUV422, YUV444, RGB8, and raw Bayer modes to
+    # +UBYTE+ or +UBYTERGB+ and converting MONO8 to +UBYTERGB+ is supported.
+    #
+    # @example Capture grey scale frames from a colour camera
+    #   camera = DC1394Input.new
+    #   camera.output = UBYTE
+    #   img = camera.read
+    #
+    # @param [Class] typecode Desired typecode.
+    #
+    # @return [Class] Returns +typecode+.
+    def output=( typecode )
+    end
+
     # Get value of feature
     #
     # @param [Integer] id Feature identifier.
@@ -246,6 +601,9 @@ module Hornetseye
 
     # Set value of feature
     #
+    # The value is queued after pending asynchronous writes and the method
+    # waits until all of them have been applied (see +feature_flush+).
+    #
     # @param [Integer] id Feature identifier.
     #
     # @return [Integer] Returns +value+.
@@ -334,7 +692,322 @@ module Hornetseye
     def feature_max( id )
     end
 
+    # Set value of feature without waiting for the camera
+    #
+    # The value is written by a background thread so that the capture loop is
+    # not delayed by register writes. Pending writes to the same feature are
+    # coalesced and only the most recent value is written. The frame returned
+    # by +read+ reflects the change once +last_frame_info[ :command ]+ is not
+    # less than the returned serial number.
+    #
+    # Errors are reported by +feature_flush+ together with the serial number of
+    # the write which failed.
+    #
+    # @example Closed loop control of the shutter
+    #   serial = camera.feature_write_async DC1394Input::FEATURE_SHUTTER, 500
+    #   img = camera.read
+    #   img = camera.read while camera.last_frame_info[ :command ] < serial
+    #
+    # @param [Integer] id Feature identifier.
+    # @param [Integer] value New value of feature.
+    #
+    # @return [Integer] Serial number of the write.
+    def feature_write_async( id, value )
+    end
+
+    # Switch feature on or off without waiting for the camera
+    #
+    # @param [Integer] id Feature identifier.
+    # @param [Boolean] value +true+ to switch the feature on.
+    #
+    # @return [Integer] Serial number of the write (see +feature_write_async+).
+    def feature_on_async( id, value )
+    end
+
+    # Set mode of feature without waiting for the camera
+    #
+    # @param [Integer] id Feature identifier.
+    # @param [Integer] mode Mode of feature.
+    #
+    # @return [Integer] Serial number of the write (see +feature_write_async+).
+    def feature_mode_write_async( id, mode )
+    end
+
+    # Wait until all asynchronous feature writes have been applied
+    #
+    # An exception is raised if a write failed since the last call. The message
+    # contains the serial number of the failed write.
+    #
+    # @return [DC1394Input] Returns +self+.
+    def feature_flush
+    end
+
+    # Stop native exposure control
+    #
+    # Shutter and gain keep their current values.
+    #
+    # @return [DC1394Input] Returns +self+.
+    def auto_exposure_stop
+    end
+
+    # Get state of native exposure control
+    #
+    # @return [Hash,NilClass] +nil+ if exposure control is not active.
+    #         Otherwise a hash with the keys +:target+, +:mean+ (mean
+    #         luminance of the last measured frame), +:shutter+, +:gain+,
+    #         +:histogram+ (256 counts), +:errors+ (number of corrections which
+    #         could not be submitted), and +:last_error+ (message or +nil+).
+    def auto_exposure
+    end
+
+    # Get snapshot of all features
+    #
+    # The snapshot is read from the camera when calling this method for the
+    # first time. Afterwards it is updated by +feature_write+, +feature_on+, and
+    # +feature_mode_write+ without accessing the firewire bus. Asynchronous
+    # writes are visible once the camera has accepted them. Use
+    # +refresh_features+ to read values changed by the camera itself (e.g. in
+    # +FEATURE_MODE_AUTO+). +feature_exist?+, +feature_readable?+,
+    # +feature_switchable?+, +feature_modes+, +feature_min+, +feature_max+,
+    # +feature_on?+, +feature_mode_read+, and +feature_read+ are answered from
+    # the snapshot as well. Only +feature_read+ of a feature not in
+    # +FEATURE_MODE_MANUAL+ accesses the bus. The snapshot is read again after
+    # a capture error such as a bus reset.
+    #
+    # Each present feature is mapped to a hash with the keys +:readable+,
+    # +:switchable+, +:on+, +:modes+, +:mode+, +:min+, +:max+, +:value+, and
+    # +:absolute+. The latter is +nil+ or a hash with the keys +:min+, +:max+,
+    # and +:value+ giving the range and value in physical units.
+    #
+    # @example Poll brightness and gain
+    #   camera.refresh_features
+    #   features = camera.features
+    #   brightness = features[ DC1394Input::FEATURE_BRIGHTNESS ][ :value ]
+    #   gain = features[ DC1394Input::FEATURE_GAIN ][ :value ]
+    #
+    # @return [Hash] Information about each present feature.
+    def features
+    end
+
+    # Read all features from the camera again
+    #
+    # @return [DC1394Input] Returns +self+.
+    def refresh_features
+    end
+
   end
 
-end
+  # Class for capturing from several DC1394-compatible firewire cameras
+  class DC1394Group
+
+    # Close the group
+    #
+    # @return [DC1394Group] Returns +self+.
+    def close
+    end
+
+    # Check whether group is not closed
+    #
+    # @return [Boolean] Returns +true+ as long as group is open.
+    def status?
+    end
+
+    # Add a camera to the group
+    #
+    # @param [DC1394Input] input Camera to add.
+    #
+    # @return [DC1394Group] Returns +self+.
+    def add( input )
+    end
+
+    # Number of cameras
+    #
+    # @return [Integer] Number of cameras in the group.
+    def size
+    end
+
+    # Read the next frame from whichever camera has one ready
+    #
+    # @param [Integer] timeout Maximum time to wait in milliseconds or -1.
+    #
+    # @return [Array,NilClass] Index of camera and video frame or +nil+.
+    def read( timeout )
+    end
+
+    # Read a set of frames with matching timestamps
+    #
+    # @param [Integer] tolerance Maximum difference of timestamps in microseconds.
+    #
+    # @return [Array<Frame_>] One video frame per camera.
+    def read_set( tolerance )
+    end
 
+  end
+
+  # Handle of the DC1394 library
+  #
+  # The worker threads used for converting, byte-swapping, and copying frames
+  # are shared by all handles. They are started on demand and stopped when the
+  # process exits.
+  class DC1394
+
+    class << self
+
+      # Get number of threads used for processing frames
+      #
+      # The calling thread is included in the count.
+      #
+      # @return [Integer] Number of threads.
+      def threads
+      end
+
+      # Set number of threads used for processing frames
+      #
+      # @param [Integer] value Number of threads including the calling thread.
+      #        Zero selects one thread per processor core.
+      #
+      # @return [Integer] Returns +value+.
+      def threads=( value )
+      end
+
+      # Check whether worker threads are pinned to processor cores
+      #
+      # @return [Boolean] Returns +true+ if CPU affinity is enabled.
+      def affinity
+      end
+
+      # Enable or disable pinning of worker threads to processor cores
+      #
+      # @param [Boolean] value Set to +true+ to pin the worker threads.
+      #
+      # @return [Boolean] Returns +value+.
+      def affinity=( value )
+      end
+
+      # Create a handle for simulated cameras
+      #
+      # The simulated cameras behave like real ones but produce colour bars (or
+      # a Bayer mosaic in format7 raw modes) at the configured frame rate. Frame
+      # drops and bus resets can be injected to test error handling.
+      #
+      # @param [Hash] options Simulator configuration (see
+      #        +DC1394Input.simulate+).
+      #
+      # @return [DC1394] The simulator handle.
+      def simulate( options )
+      end
+
+    end
+
+    # Check whether the handle drives simulated cameras
+    #
+    # @return [Boolean] Returns +true+ for handles created with +simulate+.
+    def simulated?
+    end
+
+    # Close the library handle
+    #
+    # Cameras closed with +DC1394Input#close( true )+ are released as well.
+    #
+    # @return [DC1394] Returns +self+.
+    def close
+    end
+
+    # Get cached list of cameras
+    #
+    # The firewire bus is enumerated when calling this method for the first
+    # time. Each entry is a hash with the keys +:guid+, +:unit+, +:vendor+,
+    # +:model+, +:vendor_id+, +:model_id+, and +:modes+. Each mode is a hash
+    # with the keys +:mode+ (video mode), +:coding+ (e.g. +MODE_YUV422+),
+    # +:width+, +:height+, and +:frame_rates+ (e.g. +FRAMERATE_30+). Format7
+    # modes do not report frame rates.
+    #
+    # @return [Array<Hash>] Information about each camera.
+    def cameras
+    end
+
+    # Enumerate cameras again
+    #
+    # @return [DC1394] Returns +self+.
+    def refresh
+    end
+
+    # Distribute the isochronous bandwidth of the bus among several cameras
+    #
+    # Each camera starts with the fastest frame rate (or largest format7 packet
+    # size) allowed by its policy. The camera using the most bandwidth is slowed
+    # down until all cameras fit the budget. The bandwidth of other cameras
+    # capturing with this handle is subtracted from the budget. Planned cameras
+    # must not be capturing. The usage of each option is queried from the
+    # camera and its previous settings are restored afterwards. Each entry of the result is a hash
+    # with the keys +:guid+, +:unit+, +:mode+, +:coding+, +:width+, +:height+,
+    # +:frame_rate+ (+nil+ in format7 modes), +:fps+, +:packet_size+, and
+    # +:bandwidth+ (in the units of +DC1394Input#bandwidth+).
+    #
+    # @param [Array<Hash>] requests One hash per camera (see +DC1394Input.plan+).
+    # @param [Integer] speed Firewire bus speed.
+    # @param [Integer,NilClass] budget Available bandwidth units or +nil+.
+    #
+    # @return [Array<Hash>] The plan.
+    def plan( requests, speed, budget )
+    end
+
+  end
+
+  # Microbenchmarks of the native stages of the capture pipeline
+  #
+  # @private
+  class DC1394Bench
+
+    class << self
+
+      # Get names of the available benchmarks
+      #
+      # @return [Array<String>] Benchmark names.
+      def benchmarks
+      end
+
+      # Time a native stage of the capture pipeline
+      #
+      # @param [String] name Name of the benchmark (see +benchmarks+).
+      # @param [Integer] width Width of the frames.
+      # @param [Integer] height Height of the frames.
+      # @param [Integer] frames Number of frames to process.
+      #
+      # @return [Hash] Result with the keys +:name+, +:width+, +:height+,
+      #         +:frames+, +:fps+, +:ns_per_pixel+, and +:allocations_per_frame+.
+      def run( name, width, height, frames )
+      end
+
+      # Instruction set extensions used by the colour conversions
+      #
+      # The kernels are selected at runtime depending on the processor.
+      #
+      # @return [Array<String>] +"ssse3"+ and +"avx2"+ if they are used.
+      def simd
+      end
+
+    end
+
+  end
+
+  # Reference to a DMA buffer held by a video frame
+  #
+  # @private
+  class DC1394Lease
+
+    # Return the DMA buffer to the camera
+    #
+    # @return [DC1394Lease] Returns +self+.
+    def release
+    end
+
+    # Check whether the DMA buffer was returned to the camera
+    #
+    # @return [Boolean] Returns +true+ if the buffer was released.
+    def released?
+    end
+
+  end
+
+end
@@ -14,3 +14,4 @@
 # You should have received a copy of the GNU General Public License
 # along with this program.  If not, see <http://www.gnu.org/licenses/>.
 require 'hornetseye-dc1394/dc1394input'
+require 'hornetseye-dc1394/dc1394group'
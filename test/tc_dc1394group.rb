@@ -0,0 +1,59 @@
+# hornetseye-dc1394 - Capture from DC1394 compatible firewire camera
+# Copyright (C) 2010 Jan Wedekind
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+require 'test/unit'
+begin
+  require 'rubygems'
+rescue LoadError
+end
+require 'hornetseye_dc1394'
+
+class TC_DC1394Group < Test::Unit::TestCase
+
+  include Hornetseye
+
+  def setup
+    DC1394Input.simulate :cameras => 2
+    @group = DC1394Group.new DC1394Input.new( 0, DC1394Input::SPEED_400,
+                                              DC1394Input::FRAMERATE_15 ),
+                             DC1394Input.new( 1, DC1394Input::SPEED_400,
+                                              DC1394Input::FRAMERATE_15 )
+  end
+
+  def teardown
+    @group.close
+  end
+
+  def test_size
+    assert_equal 2, @group.size
+  end
+
+  def test_read
+    indices = Array.new( 6 ) do
+      index, frame = @group.read 1.0
+      assert_equal [ 640, 480 ], frame.shape
+      @group.inputs[ index ].release frame
+      index
+    end
+    assert_equal [ 0, 1 ], indices.uniq.sort
+  end
+
+  def test_read_set
+    frames = @group.read_set 0.1
+    assert_equal 2, frames.size
+    assert_equal [ [ 640, 480 ] ] * 2, frames.collect { |frame| frame.shape }
+  end
+
+end
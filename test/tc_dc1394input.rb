@@ -0,0 +1,352 @@
+# hornetseye-dc1394 - Capture from DC1394 compatible firewire camera
+# Copyright (C) 2010 Jan Wedekind
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+require 'test/unit'
+begin
+  require 'rubygems'
+rescue LoadError
+end
+require 'hornetseye_dc1394'
+
+class TC_DC1394Input < Test::Unit::TestCase
+
+  include Hornetseye
+
+  # Colour bars of the simulated cameras
+  BARS = [ [ 255, 255, 255 ], [ 255, 255, 0 ], [ 0, 255, 255 ], [ 0, 255, 0 ],
+           [ 255, 0, 255 ], [ 255, 0, 0 ], [ 0, 0, 255 ], [ 0, 0, 0 ] ]
+
+  # Luma of the colour bars
+  BAR_LUMA = BARS.collect { |r, g, b| ( 77 * r + 150 * g + 29 * b ) >> 8 }
+
+  def clip( value )
+    value < 0 ? 0 : ( value > 255 ? 255 : value )
+  end
+
+  def yuv_to_rgb( y, u, v )
+    c, d, e = 74 * ( y - 16 ) + 32, u - 128, v - 128
+    [ clip( ( c + 102 * e ) >> 6 ), clip( ( c - 25 * d - 52 * e ) >> 6 ),
+      clip( ( c + 129 * d ) >> 6 ) ]
+  end
+
+  def rgb_to_y( r, g, b )
+    ( 77 * r + 150 * g + 29 * b + 128 ) >> 8
+  end
+
+  def simulate_format7( options = {} )
+    DC1394Input.simulate( { :modes => [], :format7_width => 640,
+                            :format7_height => 480,
+                            :format7_codings => [ DC1394Input::MODE_MONO8 ] }.
+                          merge( options ) )
+  end
+
+  def open_camera( coding, width, height )
+    DC1394Input.simulate :modes => [ [ coding, width, height ] ],
+                         :format7_width => 0, :format7_height => 0
+    @input = DC1394Input.new 0, DC1394Input::SPEED_400, DC1394Input::FRAMERATE_30
+  end
+
+  def bytes( frame, size )
+    frame.memory.read( size ).unpack 'C*'
+  end
+
+  # Read frames until the one in the specified DMA buffer arrives
+  def read_buffer( id )
+    ( 4 * @input.buffers ).times do
+      frame = @input.read
+      return frame if @input.last_frame_info[ :id ] == id
+      @input.release frame
+    end
+    flunk "Frame from DMA buffer #{id} did not arrive"
+  end
+
+  # Read a frame in the native format and the same DMA buffer in another format
+  def read_pair( typecode, native_size, converted_size )
+    native = @input.read
+    id = @input.last_frame_info[ :id ]
+    source = bytes native, native_size
+    @input.release native
+    @input.output = typecode
+    converted = read_buffer id
+    result = bytes converted, converted_size
+    @input.release converted
+    return source, result
+  end
+
+  def setup
+    @input = nil
+  end
+
+  def teardown
+    @input.close if @input
+  end
+
+  def test_read
+    open_camera DC1394Input::MODE_YUV422, 320, 240
+    frame = @input.read
+    assert_equal UYVY, @input.output
+    assert_equal [ 320, 240 ], frame.shape
+    assert_equal 1, @input.stats[ :frames_read ]
+  end
+
+  def test_try_read
+    open_camera DC1394Input::MODE_YUV422, 320, 240
+    IO.select [ @input ]
+    frame = @input.try_read
+    assert_not_nil frame
+    assert_equal [ 320, 240 ], frame.shape
+  end
+
+  def test_uyvy_to_rgb
+    open_camera DC1394Input::MODE_YUV422, 320, 240
+    source, result = read_pair UBYTERGB, 320 * 240 * 2, 320 * 240 * 3
+    expected = source.each_slice( 4 ).collect do |u, y0, v, y1|
+      yuv_to_rgb( y0, u, v ) + yuv_to_rgb( y1, u, v )
+    end.flatten
+    assert_equal expected, result
+  end
+
+  def test_uyvy_to_grey
+    open_camera DC1394Input::MODE_YUV422, 320, 240
+    source, result = read_pair UBYTE, 320 * 240 * 2, 320 * 240
+    assert_equal source.each_slice( 2 ).collect { |c, y| y }, result
+  end
+
+  def test_rgb_to_grey
+    open_camera DC1394Input::MODE_RGB8, 640, 480
+    source, result = read_pair UBYTE, 640 * 480 * 3, 640 * 480
+    assert_equal source.each_slice( 3 ).collect { |r, g, b| rgb_to_y r, g, b },
+                 result
+  end
+
+  def test_grey_to_rgb
+    open_camera DC1394Input::MODE_MONO8, 640, 480
+    source, result = read_pair UBYTERGB, 640 * 480, 640 * 480 * 3
+    assert_equal source.collect { |y| [ y, y, y ] }.flatten, result
+  end
+
+  def test_mono16
+    open_camera DC1394Input::MODE_MONO16, 640, 480
+    frame = @input.read
+    assert_equal USINT, @input.output
+    # The camera transfers 16 bit values in network byte order.
+    values = frame.memory.read( 640 * 480 * 2 ).unpack( 'S*' ).uniq
+    values.each do |value|
+      assert_equal 0, value & 0xFF
+      assert BAR_LUMA.member?( value >> 8 ), "Unexpected value #{value}"
+    end
+  end
+
+  def test_release
+    open_camera DC1394Input::MODE_YUV422, 320, 240
+    @input.spare_buffers = 0
+    frames = Array.new( @input.buffers ) { @input.read }
+    assert_equal @input.buffers, @input.leased
+    assert_raise( RuntimeError ) { @input.read }
+    frames.each { |frame| @input.release frame }
+    assert_equal 0, @input.leased
+    @input.release @input.read
+    assert_equal 0, @input.stats[ :frames_copied ]
+  end
+
+  def test_spare_buffers
+    open_camera DC1394Input::MODE_YUV422, 320, 240
+    @input.spare_buffers = @input.buffers
+    frames = Array.new( 2 * @input.buffers ) { @input.read }
+    assert_equal 0, @input.leased
+    assert_equal frames.size, @input.stats[ :frames_copied ]
+  end
+
+  def test_drop
+    DC1394Input.simulate :drop_rate => 0.5
+    @input = DC1394Input.new 0, DC1394Input::SPEED_400, DC1394Input::FRAMERATE_30
+    20.times { @input.release @input.read }
+    assert @input.stats[ :frames_dropped ] > 0
+  end
+
+  def test_bus_reset
+    DC1394Input.simulate :bus_reset_after => 3
+    @input = DC1394Input.new 0, DC1394Input::SPEED_400, DC1394Input::FRAMERATE_30
+    3.times { @input.release @input.read }
+    assert_raise( RuntimeError ) { @input.read }
+    @input.close
+    @input = DC1394Input.new 0, DC1394Input::SPEED_400, DC1394Input::FRAMERATE_30
+    assert_not_nil @input.read
+  end
+
+  def test_format7_write
+    simulate_format7
+    @input = DC1394Input.new 0, DC1394Input::SPEED_400
+    assert @input.format7?
+    @input.format7_write 64, 32, 320, 240, 1024
+    info = @input.format7_read
+    assert_equal [ 64, 32, 320, 240, 1024 ],
+                 info.values_at( :left, :top, :width, :height, :packet_size )
+    assert_equal [ 320, 240 ], @input.read.shape
+  end
+
+  def test_format7_write_rejected
+    simulate_format7
+    @input = DC1394Input.new 0, DC1394Input::SPEED_400
+    assert_raise( RuntimeError ) { @input.format7_write 4, 0, 320, 240 }
+    assert_equal [ 0, 0, 640, 480 ],
+                 @input.format7_read.values_at( :left, :top, :width, :height )
+    assert_equal [ 640, 480 ], @input.read.shape
+  end
+
+  def test_format7_write_restore
+    simulate_format7 :cameras => 2
+    @input = DC1394Input.new 0, DC1394Input::SPEED_400, nil, 4,
+                             DC1394Input::CAPTURE_FLAGS_DEFAULT, :packet_size => 512
+    other = DC1394Input.new 1, DC1394Input::SPEED_400
+    begin
+      # The other camera leaves too little bandwidth for larger packets.
+      assert_raise( RuntimeError ) { @input.format7_write 0, 0, 640, 480, 2048 }
+      assert_equal 512, @input.format7_read[ :packet_size ]
+      assert_equal [ 640, 480 ], @input.read.shape
+    ensure
+      other.close
+    end
+  end
+
+  def test_plan
+    DC1394Input.simulate :cameras => 2
+    requests = Array.new( 2 ) do |node|
+      { :node => node, :codings => [ DC1394Input::MODE_YUV422 ] }
+    end
+    plan = DC1394Input.plan requests, DC1394Input::SPEED_400, 3000
+    assert_equal 2, plan.size
+    assert plan.inject( 0 ) { |sum, entry| sum + entry[ :bandwidth ] } <= 3000
+    plan.each do |entry|
+      assert_equal DC1394Input::FRAMERATE_15, entry[ :frame_rate ]
+    end
+    inputs = DC1394Input.open_plan plan
+    begin
+      inputs.zip( plan ).each do |input, entry|
+        assert_equal entry[ :guid ], input.guid
+        assert_equal entry[ :bandwidth ], input.bandwidth
+        assert_equal [ 640, 480 ], input.read.shape
+      end
+    ensure
+      inputs.each { |input| input.close }
+    end
+  end
+
+  def test_plan_running
+    DC1394Input.simulate :cameras => 2
+    @input = DC1394Input.new 0, DC1394Input::SPEED_400, DC1394Input::FRAMERATE_30
+    assert_raise( RuntimeError ) { DC1394Input.plan [ { :node => 0 } ] }
+    plan = DC1394Input.plan [ { :node => 1 } ]
+    assert plan.first[ :bandwidth ] + @input.bandwidth <= 4915
+    assert_equal [ 640, 480 ], @input.read.shape
+  end
+
+  def test_speed
+    DC1394Input.simulate :b_mode => true
+    @input = DC1394Input.new 0, DC1394Input::SPEED_800, DC1394Input::FRAMERATE_30
+    assert_equal DC1394Input::SPEED_800, @input.speed
+    assert @input.b_mode?
+    @input.close
+    # Simulated cameras do not support S1600.
+    @input = DC1394Input.new 0, DC1394Input::SPEED_1600, DC1394Input::FRAMERATE_30
+    assert_equal DC1394Input::SPEED_800, @input.speed
+    assert_not_nil @input.read
+  end
+
+  def test_speed_legacy
+    DC1394Input.simulate
+    @input = DC1394Input.new 0, DC1394Input::SPEED_800, DC1394Input::FRAMERATE_30
+    assert_equal DC1394Input::SPEED_400, @input.speed
+    assert !@input.b_mode?
+  end
+
+  def test_trigger
+    open_camera DC1394Input::MODE_MONO8, 640, 480
+    @input.trigger_on
+    assert @input.trigger_read[ :enabled ]
+    frame = @input.snap
+    assert_equal [ 640, 480 ], frame.shape
+    assert @input.last_frame_info[ :trigger ] >= 1
+    assert_not_nil @input.last_frame_info[ :trigger_latency ]
+    @input.release frame
+    @input.trigger_off
+    assert !@input.trigger_read[ :enabled ]
+    assert_not_nil @input.read
+  end
+
+  def test_feature_write
+    open_camera DC1394Input::MODE_MONO8, 640, 480
+    brightness = @input.features[ DC1394Input::FEATURE_BRIGHTNESS ]
+    assert_equal [ 0, 255 ], brightness.values_at( :min, :max )
+    @input.feature_write DC1394Input::FEATURE_BRIGHTNESS, 100
+    assert_equal 100, @input.features[ DC1394Input::FEATURE_BRIGHTNESS ][ :value ]
+    assert_equal 100, @input.feature_read( DC1394Input::FEATURE_BRIGHTNESS )
+  end
+
+  def test_feature_write_async
+    open_camera DC1394Input::MODE_MONO8, 640, 480
+    serial = @input.feature_write_async DC1394Input::FEATURE_SHUTTER, 500
+    assert serial > 0
+    @input.feature_flush
+    assert_equal 500, @input.features[ DC1394Input::FEATURE_SHUTTER ][ :value ]
+    # Frames exposed before the write report an older command.
+    command = nil
+    20.times do
+      @input.release @input.read
+      command = @input.last_frame_info[ :command ]
+      break if command >= serial
+    end
+    assert command >= serial, "No frame reflects command #{serial}"
+  end
+
+  def test_auto_exposure
+    open_camera DC1394Input::MODE_MONO8, 640, 480
+    @input.auto_exposure_start :target => 60
+    5.times { @input.release @input.read }
+    state = @input.auto_exposure
+    assert_equal 60, state[ :target ]
+    # The colour bars are brighter than the target whatever the shutter.
+    assert state[ :mean ] > 68
+    assert state[ :shutter ] < 1000
+    assert_equal 256, state[ :histogram ].size
+    @input.feature_flush
+    assert_equal state[ :shutter ],
+                 @input.feature_read( DC1394Input::FEATURE_SHUTTER )
+    @input.auto_exposure_stop
+    assert_nil @input.auto_exposure
+  end
+
+  def test_demosaic
+    simulate_format7 :format7_width => 64, :format7_height => 16,
+                 :format7_codings => [ DC1394Input::MODE_RAW8 ],
+                 :bayer => DC1394Input::BAYER_GRBG
+    @input = DC1394Input.new 0, DC1394Input::SPEED_400
+    assert @input.raw?
+    assert_equal DC1394Input::BAYER_GRBG, @input.bayer_pattern
+    assert_equal UBYTERGB, @input.output
+    [ DC1394Input::DEMOSAIC_NEAREST, DC1394Input::DEMOSAIC_BILINEAR,
+      DC1394Input::DEMOSAIC_EDGE_AWARE ].each do |method|
+      @input.demosaic = method
+      assert_equal method, @input.demosaic
+      frame = @input.read
+      rgb = bytes( frame, 64 * 16 * 3 ).each_slice( 3 ).to_a
+      @input.release frame
+      # The centre of each bar is far enough from the edges to be exact.
+      colours = ( 0 ... 8 ).collect { |i| rgb[ 8 * 64 + 8 * i + 4 ] }
+      assert_equal BARS.sort, colours.sort
+    end
+  end
+
+end